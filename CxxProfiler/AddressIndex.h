@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Precompiled.h"
+
+// Sorted array of non-overlapping address ranges. Range starts are kept in
+// separate contiguous array so binary search touches as little memory as possible.
+template <typename T>
+class AddressIndex
+{
+public:
+    typedef typename QVector<T>::iterator iterator;
+    typedef typename QVector<T>::const_iterator const_iterator;
+
+    int count() const
+    {
+        return mAddresses.count();
+    }
+
+    bool isEmpty() const
+    {
+        return mAddresses.isEmpty();
+    }
+
+    uint64_t address(int index) const
+    {
+        return mAddresses[index];
+    }
+
+    uint32_t size(int index) const
+    {
+        return mSizes[index];
+    }
+
+    T& operator [] (int index)
+    {
+        return mValues[index];
+    }
+
+    const T& operator [] (int index) const
+    {
+        return mValues[index];
+    }
+
+    iterator begin() { return mValues.begin(); }
+    iterator end() { return mValues.end(); }
+    const_iterator begin() const { return mValues.begin(); }
+    const_iterator end() const { return mValues.end(); }
+
+    // index of range that contains address, -1 if there is none
+    int find(uint64_t address) const
+    {
+        int index = upperBound(address) - 1;
+        if (index >= 0 && address - mAddresses[index] < mSizes[index])
+        {
+            return index;
+        }
+        return -1;
+    }
+
+    // index of range that starts exactly at address, -1 if there is none
+    int indexOf(uint64_t address) const
+    {
+        int index = upperBound(address) - 1;
+        if (index >= 0 && mAddresses[index] == address)
+        {
+            return index;
+        }
+        return -1;
+    }
+
+    T& insert(uint64_t address, uint32_t size, const T& value)
+    {
+        int index = upperBound(address);
+        if (index > 0 && mAddresses[index - 1] == address)
+        {
+            mSizes[index - 1] = size;
+            mValues[index - 1] = value;
+            return mValues[index - 1];
+        }
+
+        mAddresses.insert(index, address);
+        mSizes.insert(index, size);
+        mValues.insert(index, value);
+        return mValues[index];
+    }
+
+    // inserts range & removes all ranges it overlaps, for code that gets replaced at reused addresses
+    T& replace(uint64_t address, uint32_t size, const T& value)
+    {
+        int first = upperBound(address);
+        if (first > 0 && (mAddresses[first - 1] == address || mAddresses[first - 1] + mSizes[first - 1] > address))
+        {
+            first--;
+        }
+
+        int last = first;
+        while (last < mAddresses.count() && (mAddresses[last] == address || mAddresses[last] < address + size))
+        {
+            last++;
+        }
+
+        mAddresses.remove(first, last - first);
+        mSizes.remove(first, last - first);
+        mValues.remove(first, last - first);
+
+        mAddresses.insert(first, address);
+        mSizes.insert(first, size);
+        mValues.insert(first, value);
+        return mValues[first];
+    }
+
+    void removeAt(int index)
+    {
+        mAddresses.remove(index);
+        mSizes.remove(index);
+        mValues.remove(index);
+    }
+
+    void clear()
+    {
+        mAddresses.clear();
+        mSizes.clear();
+        mValues.clear();
+    }
+
+private:
+    QVector<uint64_t> mAddresses;
+    QVector<uint32_t> mSizes;
+    QVector<T> mValues;
+
+    int upperBound(uint64_t address) const
+    {
+        const uint64_t* begin = mAddresses.constData();
+        return static_cast<int>(std::upper_bound(begin, begin + mAddresses.count(), address) - begin);
+    }
+};
@@ -0,0 +1,318 @@
+#include "AddressIndex.h"
+#include "Symbols.h"
+
+#include <random>
+#include <stdio.h>
+
+#pragma comment (lib, "psapi.lib")
+
+namespace
+{
+    const int BENCHMARK_SYMBOLS = 200000;
+    const int BENCHMARK_LOOKUPS = 10000000;
+    const int BENCHMARK_HOT_ADDRESSES = 1000; // samples of real programs hit few distinct addresses
+    const int LOOKUP_CACHE_BITS = 12;         // same as Profiler::SYMBOL_LOOKUP_BITS
+
+    const int MEMORY_SYMBOLS = 200000;
+    const int MEMORY_SYMBOLS_PER_FILE = 20;
+    const int MEMORY_MODULES = 40;
+
+    // symbol as it was stored before AddressIndex, range size is behind pointer
+    struct LegacySymbol
+    {
+        uint64_t address;
+        uint32_t size;
+    };
+
+    // symbol as it was stored before SymbolTable, each one with its own strings
+    struct LegacySymbolRecord
+    {
+        QString name;
+        QString file;
+        uint64_t address;
+        uint32_t size;
+        uint32_t line;
+        uint32_t lineLast;
+        QString module;
+    };
+
+    size_t CurrentMemoryUsage()
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters = {};
+        counters.cb = sizeof(counters);
+        GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+        return counters.PrivateUsage;
+    }
+
+    // names & files similar to symbols of C++ program, file is shared by few symbols, module by many
+    QString SymbolName(int index)
+    {
+        return QString("Namespace%1::Class%2::function%3(int, const std::string&)").arg(index % 97).arg(index / 16).arg(index);
+    }
+
+    QString SymbolFile(int index)
+    {
+        int file = index / MEMORY_SYMBOLS_PER_FILE;
+        return QString("c:\\projects\\application\\source\\subsystem%1\\file%2.cpp").arg(file % 31).arg(file);
+    }
+
+    struct SyntheticSymbols
+    {
+        QVector<uint64_t> addresses;
+        QVector<uint32_t> sizes;
+    };
+
+    // functions of 16 to 4096 bytes with some padding between them, shuffled like order in which they get resolved
+    SyntheticSymbols CreateSymbols(std::mt19937_64& random, int count)
+    {
+        std::uniform_int_distribution<uint32_t> size(16, 4096);
+        std::uniform_int_distribution<uint32_t> padding(0, 64);
+
+        SyntheticSymbols symbols;
+        uint64_t address = 0x140001000ULL;
+        for (int i = 0; i < count; i++)
+        {
+            symbols.addresses.append(address);
+            symbols.sizes.append(size(random));
+            address += symbols.sizes.last() + padding(random);
+        }
+
+        for (int i = count - 1; i > 0; i--)
+        {
+            int k = std::uniform_int_distribution<int>(0, i)(random);
+            std::swap(symbols.addresses[i], symbols.addresses[k]);
+            std::swap(symbols.sizes[i], symbols.sizes[k]);
+        }
+        return symbols;
+    }
+
+    // addresses inside random symbols, either all symbols or only few hot ones
+    QVector<uint64_t> CreateAddresses(std::mt19937_64& random, const SyntheticSymbols& symbols, int count, int distinct)
+    {
+        std::uniform_int_distribution<int> symbol(0, symbols.addresses.count() - 1);
+
+        QVector<uint64_t> hot;
+        for (int i = 0; i < distinct; i++)
+        {
+            int index = symbol(random);
+            hot.append(symbols.addresses[index] + std::uniform_int_distribution<uint32_t>(0, symbols.sizes[index] - 1)(random));
+        }
+
+        QVector<uint64_t> addresses;
+        addresses.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            if (distinct != 0)
+            {
+                addresses.append(hot[std::uniform_int_distribution<int>(0, distinct - 1)(random)]);
+            }
+            else
+            {
+                int index = symbol(random);
+                addresses.append(symbols.addresses[index] + std::uniform_int_distribution<uint32_t>(0, symbols.sizes[index] - 1)(random));
+            }
+        }
+        return addresses;
+    }
+
+    // returns millions of lookups per second, checksum keeps lookups from being optimized away
+    template <typename Lookup>
+    double MeasureLookups(const QVector<uint64_t>& addresses, Lookup lookup, uint64_t* checksum)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        uint64_t sum = 0;
+        for (uint64_t address : addresses)
+        {
+            sum += lookup(address);
+        }
+
+        qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+        *checksum += sum;
+        return addresses.count() * 1000.0 / elapsed;
+    }
+
+    void BenchmarkAddressIndex()
+    {
+        std::mt19937_64 random(1);
+        SyntheticSymbols symbols = CreateSymbols(random, BENCHMARK_SYMBOLS);
+
+        QMap<uint64_t, QSharedPointer<LegacySymbol>> map;
+        AddressIndex<uint32_t> index;
+        for (int i = 0; i < symbols.addresses.count(); i++)
+        {
+            QSharedPointer<LegacySymbol> symbol(new LegacySymbol());
+            symbol->address = symbols.addresses[i];
+            symbol->size = symbols.sizes[i];
+            map.insert(symbol->address, symbol);
+
+            index.insert(symbols.addresses[i], symbols.sizes[i], i + 1);
+        }
+
+        // same lookups as in Profiler before and after AddressIndex
+        auto mapLookup = [&map](uint64_t address) -> uint64_t
+        {
+            auto it = map.upperBound(address);
+            if (it-- != map.begin() && address - it.key() < it.value()->size)
+            {
+                return it.value()->address;
+            }
+            return 0;
+        };
+
+        auto indexLookup = [&index](uint64_t address) -> uint64_t
+        {
+            int found = index.find(address);
+            return found < 0 ? 0 : index.address(found);
+        };
+
+        struct CachedLookup
+        {
+            uint64_t address;
+            uint64_t result;
+        };
+        QVector<CachedLookup> cache(1 << LOOKUP_CACHE_BITS);
+
+        auto cachedLookup = [&cache, &indexLookup](uint64_t address) -> uint64_t
+        {
+            CachedLookup& cached = cache[static_cast<int>((address * 0x9E3779B97F4A7C15ULL) >> (64 - LOOKUP_CACHE_BITS))];
+            if (cached.address != address || cached.result == 0)
+            {
+                cached.address = address;
+                cached.result = indexLookup(address);
+            }
+            return cached.result;
+        };
+
+        printf("Address lookups, %d symbols, %d lookups, millions of lookups per second\n", BENCHMARK_SYMBOLS, BENCHMARK_LOOKUPS);
+        printf("%-28s %12s %12s %12s\n", "", "QMap", "AddressIndex", "with cache");
+
+        uint64_t checksum = 0;
+        for (int distinct : { 0, BENCHMARK_HOT_ADDRESSES })
+        {
+            QVector<uint64_t> addresses = CreateAddresses(random, symbols, BENCHMARK_LOOKUPS, distinct);
+
+            cache.fill(CachedLookup());
+            double mapRate = MeasureLookups(addresses, mapLookup, &checksum);
+            double indexRate = MeasureLookups(addresses, indexLookup, &checksum);
+            double cachedRate = MeasureLookups(addresses, cachedLookup, &checksum);
+
+            printf("%-28s %12.1f %12.1f %12.1f\n", distinct == 0 ? "uniform over all symbols" : "1000 hot addresses", mapRate, indexRate, cachedRate);
+        }
+        printf("(checksum %llu)\n\n", static_cast<unsigned long long>(checksum));
+    }
+
+    QVector<QString> MemoryModules()
+    {
+        QVector<QString> modules;
+        for (int i = 0; i < MEMORY_MODULES; i++)
+        {
+            modules.append(QString("module%1.dll").arg(i));
+        }
+        return modules;
+    }
+
+    // strings came from dbghelp for each symbol, module name was shared with module
+    size_t MeasureLegacySymbols()
+    {
+        QVector<QString> modules = MemoryModules();
+        size_t before = CurrentMemoryUsage();
+
+        QMap<uint64_t, QSharedPointer<LegacySymbolRecord>> symbols;
+        for (int i = 0; i < MEMORY_SYMBOLS; i++)
+        {
+            QSharedPointer<LegacySymbolRecord> symbol(new LegacySymbolRecord());
+            symbol->name = SymbolName(i);
+            symbol->file = SymbolFile(i);
+            symbol->address = 0x140001000ULL + i * 256ULL;
+            symbol->size = 200;
+            symbol->line = i;
+            symbol->lineLast = i + 10;
+            symbol->module = modules[i % MEMORY_MODULES];
+            symbols.insert(symbol->address, symbol);
+        }
+
+        return CurrentMemoryUsage() - before;
+    }
+
+    // same as Profiler, symbol table with id in address index of module
+    size_t MeasureSymbolTable()
+    {
+        QVector<QString> modules = MemoryModules();
+        size_t before = CurrentMemoryUsage();
+
+        SymbolTable table;
+        AddressIndex<uint32_t> index;
+        for (int i = 0; i < MEMORY_SYMBOLS; i++)
+        {
+            Symbol symbol;
+            symbol.address = 0x140001000ULL + i * 256ULL;
+            symbol.size = 200;
+            symbol.name = table.addString(SymbolName(i));
+            symbol.file = table.addString(SymbolFile(i));
+            symbol.module = table.addString(modules[i % MEMORY_MODULES]);
+            symbol.line = i;
+            symbol.lineLast = i + 10;
+            symbol.flags = 0;
+            index.insert(symbol.address, symbol.size, table.addSymbol(symbol));
+        }
+
+        return CurrentMemoryUsage() - before;
+    }
+
+    // measures one layout, in its own process so memory freed by other layout is not reused
+    int BenchmarkSymbolMemory(const QString& layout)
+    {
+        size_t memory;
+        const char* title;
+        if (layout == "legacy")
+        {
+            memory = MeasureLegacySymbols();
+            title = "QMap of shared Symbol";
+        }
+        else if (layout == "table")
+        {
+            memory = MeasureSymbolTable();
+            title = "SymbolTable";
+        }
+        else
+        {
+            fprintf(stderr, "Unknown symbol layout %s\n", qPrintable(layout));
+            return 1;
+        }
+
+        printf("%-28s %12.1f %12.1f\n", title, memory / 1048576.0, double(memory) / MEMORY_SYMBOLS);
+        return 0;
+    }
+
+    void BenchmarkSymbolMemoryRuns(const QString& program)
+    {
+        printf("Symbol memory, %d symbols, %d symbols per file, %d modules\n", MEMORY_SYMBOLS, MEMORY_SYMBOLS_PER_FILE, MEMORY_MODULES);
+        printf("%-28s %12s %12s\n", "", "total MB", "per symbol");
+        fflush(stdout);
+
+        for (const char* layout : { "legacy", "table" })
+        {
+            QProcess::execute(program, QStringList() << "-memory" << layout);
+        }
+        printf("\n");
+    }
+}
+
+// Standalone microbenchmarks of data structures used while capturing and analyzing profiles.
+// "-memory legacy" or "-memory table" measures memory of one symbol layout only.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments();
+
+    if (arguments.size() == 3 && arguments[1] == "-memory")
+    {
+        return BenchmarkSymbolMemory(arguments[2]);
+    }
+
+    BenchmarkAddressIndex();
+    BenchmarkSymbolMemoryRuns(app.applicationFilePath());
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "Export.h"
+
+namespace
+{
+    const int CALLGRIND_CHUNK_SIZE = 1 << 20;
+
+    struct CallgrindCall
+    {
+        uint64_t samples = 0;
+        uint64_t lastSample = 0; // call is counted once per sample, also in recursion
+    };
+
+    struct CallgrindFunction
+    {
+        // samples per line where function itself was executing
+        QMap<uint32_t, uint64_t> self;
+
+        // (line of call, callee) to samples where call was on stack
+        QMap<QPair<uint32_t, uint32_t>, CallgrindCall> calls;
+    };
+
+    // unknown line is written as 0, which callgrind tools show as no line
+    uint32_t CallgrindLine(uint32_t line)
+    {
+        return line == ~(uint32_t)0 ? 0 : line;
+    }
+
+    // names are written in full only on first use, later only by "(id)", second key is used for callee
+    // keyed by symbol or string id, so different functions with same display name stay apart
+    class CallgrindNames
+    {
+    public:
+        CallgrindNames(const char* firstKey, const char* secondKey)
+            : mFirstKey(firstKey)
+            , mSecondKey(secondKey)
+        {
+        }
+
+        void append(QByteArray& out, uint32_t key, const QString& name, bool second = false)
+        {
+            out.append(second ? mSecondKey : mFirstKey);
+            out.append("=(");
+
+            auto it = mIds.constFind(key);
+            if (it != mIds.constEnd())
+            {
+                out.append(QByteArray::number(it.value()));
+                out.append(")\n");
+                return;
+            }
+
+            uint32_t id = mIds.count() + 1;
+            mIds.insert(key, id);
+
+            QByteArray text = name.toUtf8();
+            text.replace('\n', ' ');
+
+            out.append(QByteArray::number(id));
+            out.append(") ");
+            out.append(text.isEmpty() ? QByteArray("???") : text);
+            out.append('\n');
+        }
+
+    private:
+        const char* mFirstKey;
+        const char* mSecondKey;
+        QHash<uint32_t, uint32_t> mIds;
+    };
+}
+
+bool ExportCallgrind(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    const SymbolTable& symbols = profile.symbols;
+
+    // costs are collected from stacks of all threads, functions are written ordered by id
+    QMap<uint32_t, CallgrindFunction> functions;
+    uint64_t total = 0;
+    uint64_t sample = 0;
+
+    for (const ThreadCallStack& callStack : profile.callStacks)
+    {
+        int first = 0;
+        for (int i = 0; i < callStack.count(); i++)
+        {
+            if (callStack[i].symbol != 0)
+            {
+                continue;
+            }
+            if (i == first)
+            {
+                first = i + 1;
+                continue;
+            }
+
+            const CallStackEntry& leaf = callStack[first];
+            uint32_t weight = SampleWeight(callStack[i]);
+            functions[leaf.symbol].self[CallgrindLine(leaf.line)] += weight;
+            total += weight;
+            sample++;
+
+            for (int k = first + 1; k < i; k++)
+            {
+                const CallStackEntry& caller = callStack[k];
+                CallgrindCall& call = functions[caller.symbol].calls[qMakePair(CallgrindLine(caller.line), callStack[k - 1].symbol)];
+                if (call.lastSample != sample)
+                {
+                    call.lastSample = sample;
+                    call.samples += weight;
+                }
+            }
+
+            first = i + 1;
+        }
+    }
+
+    QByteArray out;
+    out.append("# callgrind format\nversion: 1\ncreator: ");
+    out.append(qApp->applicationName().toUtf8());
+    out.append("\ncmd: ");
+    out.append(QFileInfo(fileName).completeBaseName().toUtf8());
+    out.append("\npositions: line\nevents: Samples\nsummary: ");
+    out.append(QByteArray::number(total));
+    out.append("\n\n");
+
+    CallgrindNames objects("ob", "cob");
+    CallgrindNames files("fl", "cfi");
+    CallgrindNames names("fn", "cfn");
+
+    bool ok = true;
+
+    for (auto it = functions.constBegin(); it != functions.constEnd() && ok; ++it)
+    {
+        uint32_t symbol = it.key();
+        const CallgrindFunction& function = it.value();
+
+        objects.append(out, symbols[symbol].module, symbols.getModule(symbol));
+        files.append(out, symbols[symbol].file, symbols.getFile(symbol));
+        names.append(out, symbol, symbols.getDisplayName(symbol));
+
+        for (auto self = function.self.constBegin(); self != function.self.constEnd(); ++self)
+        {
+            out.append(QByteArray::number(self.key()));
+            out.append(' ');
+            out.append(QByteArray::number(self.value()));
+            out.append('\n');
+        }
+
+        for (auto call = function.calls.constBegin(); call != function.calls.constEnd(); ++call)
+        {
+            uint32_t callee = call.key().second;
+
+            if (symbols[callee].module != symbols[symbol].module)
+            {
+                objects.append(out, symbols[callee].module, symbols.getModule(callee), true);
+            }
+            files.append(out, symbols[callee].file, symbols.getFile(callee), true);
+            names.append(out, callee, symbols.getDisplayName(callee), true);
+
+            // call count is not known from samples, samples with call on stack are used instead
+            out.append("calls=");
+            out.append(QByteArray::number(call.value().samples));
+            out.append(' ');
+            out.append(QByteArray::number(CallgrindLine(symbols[callee].line)));
+            out.append('\n');
+
+            out.append(QByteArray::number(call.key().first));
+            out.append(' ');
+            out.append(QByteArray::number(call.value().samples));
+            out.append('\n');
+        }
+
+        out.append('\n');
+
+        if (out.size() >= CALLGRIND_CHUNK_SIZE)
+        {
+            ok = file.write(out) == out.size();
+            out.clear();
+        }
+    }
+
+    if (ok)
+    {
+        ok = file.write(out) == out.size();
+    }
+
+    if (!ok)
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
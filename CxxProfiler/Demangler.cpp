@@ -0,0 +1,1512 @@
+#include "Demangler.h"
+
+namespace
+{
+    // type is split in two parts so pointers to functions & arrays can be
+    // placed in the middle, for example "void (*)(int)" or "int (*) [4]"
+    struct TypeName
+    {
+        QByteArray left;
+        QByteArray right;
+        bool isPack = false;
+        char reference = 0;
+
+        QByteArray full() const
+        {
+            return left + right;
+        }
+    };
+
+    struct NameInfo
+    {
+        bool isTemplate = false;
+        bool isCtorDtor = false;
+        bool isConversion = false;
+        QByteArray qualifiers;
+    };
+
+    struct Operator
+    {
+        const char* code;
+        const char* name;
+    };
+
+    const Operator gOperators[] =
+    {
+        { "nw", "operator new" }, { "na", "operator new[]" },
+        { "dl", "operator delete" }, { "da", "operator delete[]" },
+        { "ps", "operator+" }, { "ng", "operator-" }, { "ad", "operator&" }, { "de", "operator*" },
+        { "co", "operator~" }, { "pl", "operator+" }, { "mi", "operator-" }, { "ml", "operator*" },
+        { "dv", "operator/" }, { "rm", "operator%" }, { "an", "operator&" }, { "or", "operator|" },
+        { "eo", "operator^" }, { "aS", "operator=" }, { "pL", "operator+=" }, { "mI", "operator-=" },
+        { "mL", "operator*=" }, { "dV", "operator/=" }, { "rM", "operator%=" }, { "aN", "operator&=" },
+        { "oR", "operator|=" }, { "eO", "operator^=" }, { "ls", "operator<<" }, { "rs", "operator>>" },
+        { "lS", "operator<<=" }, { "rS", "operator>>=" }, { "eq", "operator==" }, { "ne", "operator!=" },
+        { "lt", "operator<" }, { "gt", "operator>" }, { "le", "operator<=" }, { "ge", "operator>=" },
+        { "ss", "operator<=>" }, { "nt", "operator!" }, { "aa", "operator&&" }, { "oo", "operator||" },
+        { "pp", "operator++" }, { "mm", "operator--" }, { "cm", "operator," }, { "pm", "operator->*" },
+        { "pt", "operator->" }, { "cl", "operator()" }, { "ix", "operator[]" }, { "qu", "operator?" },
+        { "aw", "operator co_await" },
+    };
+
+    const char* BuiltinType(char c)
+    {
+        switch (c)
+        {
+        case 'v': return "void";
+        case 'w': return "wchar_t";
+        case 'b': return "bool";
+        case 'c': return "char";
+        case 'a': return "signed char";
+        case 'h': return "unsigned char";
+        case 's': return "short";
+        case 't': return "unsigned short";
+        case 'i': return "int";
+        case 'j': return "unsigned int";
+        case 'l': return "long";
+        case 'm': return "unsigned long";
+        case 'x': return "long long";
+        case 'y': return "unsigned long long";
+        case 'n': return "__int128";
+        case 'o': return "unsigned __int128";
+        case 'f': return "float";
+        case 'd': return "double";
+        case 'e': return "long double";
+        case 'g': return "__float128";
+        case 'z': return "...";
+        }
+        return nullptr;
+    }
+
+    const char* BuiltinTypeD(char c)
+    {
+        switch (c)
+        {
+        case 'a': return "auto";
+        case 'c': return "decltype(auto)";
+        case 'n': return "decltype(nullptr)";
+        case 's': return "char16_t";
+        case 'i': return "char32_t";
+        case 'u': return "char8_t";
+        case 'd': return "decimal64";
+        case 'e': return "decimal128";
+        case 'f': return "decimal32";
+        case 'h': return "half";
+        }
+        return nullptr;
+    }
+
+    // name without template arguments & scope, used for constructors & destructors
+    QByteArray BaseName(const QByteArray& name)
+    {
+        int end = name.size();
+        while (end != 0 && name.at(end - 1) == ']')
+        {
+            int tag = name.lastIndexOf("[abi:", end - 1);
+            if (tag < 0)
+            {
+                break;
+            }
+            end = tag;
+        }
+        if (end != 0 && name.at(end - 1) == '>')
+        {
+            int depth = 0;
+            for (int i = end - 1; i >= 0; i--)
+            {
+                if (name.at(i) == '>')
+                {
+                    depth++;
+                }
+                else if (name.at(i) == '<' && --depth == 0)
+                {
+                    end = i;
+                    break;
+                }
+            }
+        }
+
+        int start = end < 2 ? -1 : name.lastIndexOf("::", end - 2);
+        start = start < 0 ? 0 : start + 2;
+        return name.mid(start, end - start);
+    }
+
+    // Itanium C++ ABI demangler, handles everything compilers emit for functions
+    // and data except expressions in template arguments & decltype
+    class ItaniumDemangler
+    {
+    public:
+        ItaniumDemangler(const char* begin, const char* end) : mCur(begin), mEnd(end)
+        {
+        }
+
+        bool demangle(QByteArray* result)
+        {
+            if (!consume('_') || !consume('Z'))
+            {
+                return false;
+            }
+
+            if (!parseEncoding(result))
+            {
+                return false;
+            }
+
+            // clones made by optimizer, like "foo.isra.0" or "foo.cold"
+            while (peek() == '.')
+            {
+                const char* start = mCur++;
+                while (isalpha(peek()) || peek() == '_')
+                {
+                    mCur++;
+                }
+                while (peek() == '.' && isdigit(peek(1)))
+                {
+                    mCur++;
+                    while (isdigit(peek()))
+                    {
+                        mCur++;
+                    }
+                }
+                if (mCur == start + 1)
+                {
+                    return false;
+                }
+                *result += " [clone " + QByteArray(start, int(mCur - start)) + "]";
+            }
+
+            return mCur == mEnd;
+        }
+
+    private:
+        enum
+        {
+            MAX_DEPTH = 256,
+        };
+
+        const char* mCur;
+        const char* mEnd;
+        int mDepth = 0;
+
+        QVector<TypeName> mSubstitutions;
+        QVector<TypeName> mTemplateArgs;
+
+        // elements of argument packs, parallel to mTemplateArgs
+        QVector<QVector<TypeName>> mTemplatePacks;
+
+        // element of pack currently expanded, -1 outside of pack expansion
+        int mPackIndex = -1;
+        int mPackSize = -1;
+
+        char peek(int offset = 0) const
+        {
+            return mCur + offset < mEnd ? mCur[offset] : 0;
+        }
+
+        bool consume(char c)
+        {
+            if (peek() == c)
+            {
+                mCur++;
+                return true;
+            }
+            return false;
+        }
+
+        bool atEnd() const
+        {
+            return mCur == mEnd;
+        }
+
+        bool parseNumber(uint64_t* number)
+        {
+            if (!isdigit(peek()))
+            {
+                return false;
+            }
+            uint64_t value = 0;
+            while (isdigit(peek()))
+            {
+                value = value * 10 + (*mCur++ - '0');
+            }
+            *number = value;
+            return true;
+        }
+
+        // <seq-id> in base 36, empty means first
+        bool parseSequence(uint32_t* index)
+        {
+            uint32_t value = 0;
+            bool hasValue = false;
+            for (;;)
+            {
+                char c = peek();
+                if (isdigit(c))
+                {
+                    value = value * 36 + (c - '0');
+                }
+                else if (c >= 'A' && c <= 'Z')
+                {
+                    value = value * 36 + (c - 'A' + 10);
+                }
+                else
+                {
+                    break;
+                }
+                mCur++;
+                hasValue = true;
+            }
+            if (!consume('_'))
+            {
+                return false;
+            }
+            *index = hasValue ? value + 1 : 0;
+            return true;
+        }
+
+        // <discriminator> ::= _ <digit> | __ <number> _
+        void skipDiscriminator()
+        {
+            if (peek() == '_' && isdigit(peek(1)))
+            {
+                mCur += 2;
+            }
+            else if (peek() == '_' && peek(1) == '_' && isdigit(peek(2)))
+            {
+                mCur += 2;
+                uint64_t number;
+                parseNumber(&number);
+                consume('_');
+            }
+        }
+
+        void addSubstitution(const TypeName& type)
+        {
+            mSubstitutions.append(type);
+        }
+
+        void addSubstitution(const QByteArray& name)
+        {
+            TypeName type;
+            type.left = name;
+            mSubstitutions.append(type);
+        }
+
+        bool parseEncoding(QByteArray* out, bool withResult = true)
+        {
+            if (peek() == 'T' || (peek() == 'G' && (peek(1) == 'V' || peek(1) == 'R' || peek(1) == 'T')))
+            {
+                return parseSpecialName(out);
+            }
+
+            NameInfo info;
+            QByteArray name;
+            if (!parseName(&name, &info))
+            {
+                return false;
+            }
+
+            // data has no function parameters
+            if (atEnd() || peek() == 'E' || peek() == '.')
+            {
+                *out = name;
+                return true;
+            }
+
+            TypeName result;
+            if (info.isTemplate && !info.isCtorDtor && !info.isConversion)
+            {
+                if (!parseType(&result))
+                {
+                    return false;
+                }
+                result.left += ' ';
+
+                if (!withResult)
+                {
+                    result = TypeName();
+                }
+            }
+
+            QByteArray params;
+            if (!parseParameters(&params))
+            {
+                return false;
+            }
+
+            *out = result.left + name + '(' + params + ')' + info.qualifiers + result.right;
+            return true;
+        }
+
+        bool parseSpecialName(QByteArray* out)
+        {
+            char c = peek(1);
+            mCur += 2;
+
+            const char* prefix = nullptr;
+            if (mCur[-2] == 'G')
+            {
+                QByteArray name;
+                NameInfo info;
+                switch (c)
+                {
+                case 'V':
+                    if (!parseName(&name, &info))
+                    {
+                        return false;
+                    }
+                    *out = "guard variable for " + name;
+                    return true;
+                case 'R':
+                    if (!parseName(&name, &info))
+                    {
+                        return false;
+                    }
+                    if (peek() == '_' || isalnum(peek()))
+                    {
+                        uint32_t index;
+                        if (!parseSequence(&index))
+                        {
+                            return false;
+                        }
+                    }
+                    *out = "reference temporary for " + name;
+                    return true;
+                case 'T':
+                    if (!consume('t') && !consume('n'))
+                    {
+                        return false;
+                    }
+                    if (!parseEncoding(&name))
+                    {
+                        return false;
+                    }
+                    *out = "transaction clone for " + name;
+                    return true;
+                }
+                return false;
+            }
+
+            switch (c)
+            {
+            case 'V': prefix = "vtable for "; break;
+            case 'T': prefix = "VTT for "; break;
+            case 'I': prefix = "typeinfo for "; break;
+            case 'S': prefix = "typeinfo name for "; break;
+            case 'W': prefix = "TLS wrapper function for "; break;
+            case 'H': prefix = "TLS init function for "; break;
+            case 'h':
+            case 'v':
+                {
+                    // call offsets are not shown
+                    int offsets = (c == 'h' ? 1 : 2);
+                    for (int i = 0; i < offsets; i++)
+                    {
+                        consume('n');
+                        uint64_t offset;
+                        if (!parseNumber(&offset) || !consume('_'))
+                        {
+                            return false;
+                        }
+                    }
+                    QByteArray name;
+                    if (!parseEncoding(&name))
+                    {
+                        return false;
+                    }
+                    *out = (c == 'h' ? "non-virtual thunk to " : "virtual thunk to ") + name;
+                    return true;
+                }
+            default:
+                return false;
+            }
+
+            if (c == 'W' || c == 'H')
+            {
+                QByteArray name;
+                NameInfo info;
+                if (!parseName(&name, &info))
+                {
+                    return false;
+                }
+                *out = prefix + name;
+                return true;
+            }
+
+            TypeName type;
+            if (!parseType(&type))
+            {
+                return false;
+            }
+            *out = prefix + type.full();
+            return true;
+        }
+
+        bool parseParameters(QByteArray* out)
+        {
+            if (peek() == 'v')
+            {
+                char next = peek(1);
+                if (next == 0 || next == 'E' || next == '.')
+                {
+                    mCur++;
+                    return true;
+                }
+            }
+
+            bool first = true;
+            while (!atEnd() && peek() != 'E' && peek() != '.')
+            {
+                TypeName type;
+                if (!parseType(&type))
+                {
+                    return false;
+                }
+                if (!type.full().isEmpty())
+                {
+                    if (!out->isEmpty())
+                    {
+                        *out += ", ";
+                    }
+                    *out += type.full();
+                }
+                first = false;
+            }
+            return !first;
+        }
+
+        bool parseName(QByteArray* out, NameInfo* info)
+        {
+            if (peek() == 'N')
+            {
+                return parseNestedName(out, info);
+            }
+            if (peek() == 'Z')
+            {
+                return parseLocalName(out, info);
+            }
+
+            QByteArray name;
+            if (peek() == 'S' && peek(1) == 't')
+            {
+                mCur += 2;
+                name = "std::";
+            }
+            else if (peek() == 'S')
+            {
+                // <unscoped-template-name> from substitution must have template arguments
+                TypeName type;
+                if (!parseSubstitution(&type) || peek() != 'I')
+                {
+                    return false;
+                }
+                QByteArray args;
+                if (!parseTemplateArgs(&args))
+                {
+                    return false;
+                }
+                *out = type.full() + args;
+                info->isTemplate = true;
+                return true;
+            }
+
+            QByteArray unqualified;
+            if (!parseUnqualifiedName(&unqualified, QByteArray(), info))
+            {
+                return false;
+            }
+            name += unqualified;
+
+            if (peek() == 'I')
+            {
+                addSubstitution(name);
+
+                QByteArray args;
+                if (!parseTemplateArgs(&args))
+                {
+                    return false;
+                }
+                if (name.endsWith('<'))
+                {
+                    name += ' ';
+                }
+                name += args;
+                info->isTemplate = true;
+            }
+
+            *out = name;
+            return true;
+        }
+
+        bool parseNestedName(QByteArray* out, NameInfo* info)
+        {
+            mCur++;
+
+            // qualifiers of member function
+            bool isRestrict = consume('r');
+            bool isVolatile = consume('V');
+            bool isConst = consume('K');
+
+            QByteArray qualifiers;
+            if (isConst)
+            {
+                qualifiers += " const";
+            }
+            if (isVolatile)
+            {
+                qualifiers += " volatile";
+            }
+            if (isRestrict)
+            {
+                qualifiers += " restrict";
+            }
+            if (consume('R'))
+            {
+                qualifiers += " &";
+            }
+            else if (consume('O'))
+            {
+                qualifiers += " &&";
+            }
+
+            QByteArray name;
+            bool first = true;
+            for (;;)
+            {
+                if (consume('E'))
+                {
+                    break;
+                }
+                if (atEnd())
+                {
+                    return false;
+                }
+
+                bool substitutable = true;
+                char c = peek();
+
+                if (c == 'I')
+                {
+                    if (first)
+                    {
+                        return false;
+                    }
+                    QByteArray args;
+                    if (!parseTemplateArgs(&args))
+                    {
+                        return false;
+                    }
+                    if (name.endsWith('<'))
+                    {
+                        name += ' ';
+                    }
+                    name += args;
+                    info->isTemplate = true;
+                }
+                else
+                {
+                    info->isTemplate = false;
+                    info->isCtorDtor = false;
+                    info->isConversion = false;
+
+                    if (c == 'S' && peek(1) == 't')
+                    {
+                        if (!first)
+                        {
+                            return false;
+                        }
+                        mCur += 2;
+                        name = "std";
+                        substitutable = false;
+                    }
+                    else if (c == 'S')
+                    {
+                        if (!first)
+                        {
+                            return false;
+                        }
+                        TypeName type;
+                        if (!parseSubstitution(&type))
+                        {
+                            return false;
+                        }
+                        name = type.full();
+                        substitutable = false;
+                    }
+                    else if (c == 'T')
+                    {
+                        if (!first)
+                        {
+                            return false;
+                        }
+                        TypeName type;
+                        if (!parseTemplateParam(&type))
+                        {
+                            return false;
+                        }
+                        name = type.full();
+                    }
+                    else
+                    {
+                        QByteArray unqualified;
+                        if (!parseUnqualifiedName(&unqualified, name, info))
+                        {
+                            return false;
+                        }
+                        name = first ? unqualified : name + "::" + unqualified;
+                    }
+                }
+
+                first = false;
+                if (substitutable && peek() != 'E')
+                {
+                    addSubstitution(name);
+                }
+            }
+
+            if (first)
+            {
+                return false;
+            }
+
+            info->qualifiers = qualifiers;
+            *out = name;
+            return true;
+        }
+
+        bool parseLocalName(QByteArray* out, NameInfo* info)
+        {
+            mCur++;
+
+            // enclosing function is shown without result type
+            QByteArray function;
+            if (!parseEncoding(&function, false) || !consume('E'))
+            {
+                return false;
+            }
+
+            if (consume('s'))
+            {
+                skipDiscriminator();
+                *out = function + "::string literal";
+                return true;
+            }
+
+            // default argument scope is not shown
+            if (consume('d'))
+            {
+                uint64_t number;
+                parseNumber(&number);
+                if (!consume('_'))
+                {
+                    return false;
+                }
+            }
+
+            QByteArray name;
+            if (!parseName(&name, info))
+            {
+                return false;
+            }
+            skipDiscriminator();
+
+            *out = function + "::" + name;
+            return true;
+        }
+
+        bool parseSourceName(QByteArray* out)
+        {
+            uint64_t length;
+            if (!parseNumber(&length) || length == 0 || length > uint64_t(mEnd - mCur))
+            {
+                return false;
+            }
+
+            QByteArray name(mCur, int(length));
+            mCur += int(length);
+
+            if (name.startsWith("_GLOBAL__N"))
+            {
+                name = "(anonymous namespace)";
+            }
+            *out = name;
+            return true;
+        }
+
+        bool parseUnqualifiedName(QByteArray* out, const QByteArray& scope, NameInfo* info)
+        {
+            // internal linkage
+            consume('L');
+
+            char c = peek();
+            if (isdigit(c))
+            {
+                if (!parseSourceName(out))
+                {
+                    return false;
+                }
+            }
+            else if (c == 'C' && (isdigit(peek(1)) || peek(1) == 'I'))
+            {
+                mCur++;
+                if (consume('I'))
+                {
+                    // inheriting constructor
+                    mCur++;
+                    TypeName type;
+                    if (!parseType(&type))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    mCur++;
+                }
+                *out = BaseName(scope);
+                info->isCtorDtor = true;
+            }
+            else if (c == 'D' && isdigit(peek(1)))
+            {
+                mCur += 2;
+                *out = '~' + BaseName(scope);
+                info->isCtorDtor = true;
+            }
+            else if (c == 'U' && peek(1) == 't')
+            {
+                mCur += 2;
+                uint64_t number = 0;
+                bool hasNumber = parseNumber(&number);
+                if (!consume('_'))
+                {
+                    return false;
+                }
+                *out = "{unnamed type#" + QByteArray::number(qulonglong(hasNumber ? number + 2 : 1)) + '}';
+            }
+            else if (c == 'U' && peek(1) == 'l')
+            {
+                mCur += 2;
+                QByteArray params;
+                if (!parseParameters(&params) || !consume('E'))
+                {
+                    return false;
+                }
+                uint64_t number = 0;
+                bool hasNumber = parseNumber(&number);
+                if (!consume('_'))
+                {
+                    return false;
+                }
+                *out = "{lambda(" + params + ")#" + QByteArray::number(qulonglong(hasNumber ? number + 2 : 1)) + '}';
+            }
+            else if (islower(c))
+            {
+                if (!parseOperatorName(out, info))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            // abi tags
+            while (consume('B'))
+            {
+                QByteArray tag;
+                if (!parseSourceName(&tag))
+                {
+                    return false;
+                }
+                *out += "[abi:" + tag + ']';
+            }
+            return true;
+        }
+
+        bool parseOperatorName(QByteArray* out, NameInfo* info)
+        {
+            char c0 = peek();
+            char c1 = peek(1);
+
+            if (c0 == 'c' && c1 == 'v')
+            {
+                mCur += 2;
+                TypeName type;
+                if (!parseType(&type))
+                {
+                    return false;
+                }
+                *out = "operator " + type.full();
+                info->isConversion = true;
+                return true;
+            }
+
+            if (c0 == 'l' && c1 == 'i')
+            {
+                mCur += 2;
+                QByteArray name;
+                if (!parseSourceName(&name))
+                {
+                    return false;
+                }
+                *out = "operator\"\" " + name;
+                return true;
+            }
+
+            if (c0 == 'v' && isdigit(c1))
+            {
+                mCur += 2;
+                QByteArray name;
+                if (!parseSourceName(&name))
+                {
+                    return false;
+                }
+                *out = "operator " + name;
+                return true;
+            }
+
+            for (const Operator& op : gOperators)
+            {
+                if (op.code[0] == c0 && op.code[1] == c1)
+                {
+                    mCur += 2;
+                    *out = op.name;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool parseSubstitution(TypeName* out)
+        {
+            mCur++;
+
+            // abbreviations are expanded same as c++filt does
+            const char* name = nullptr;
+            switch (peek())
+            {
+            case 'a': name = "std::allocator"; break;
+            case 'b': name = "std::basic_string"; break;
+            case 's': name = "std::basic_string<char, std::char_traits<char>, std::allocator<char> >"; break;
+            case 'i': name = "std::basic_istream<char, std::char_traits<char> >"; break;
+            case 'o': name = "std::basic_ostream<char, std::char_traits<char> >"; break;
+            case 'd': name = "std::basic_iostream<char, std::char_traits<char> >"; break;
+            }
+            if (name)
+            {
+                mCur++;
+                out->left = name;
+                out->right.clear();
+                return true;
+            }
+
+            uint32_t index;
+            if (!parseSequence(&index) || index >= uint32_t(mSubstitutions.count()))
+            {
+                return false;
+            }
+            *out = mSubstitutions[index];
+            return true;
+        }
+
+        bool parseTemplateParam(TypeName* out)
+        {
+            mCur++;
+
+            uint32_t index;
+            if (!parseSequence(&index) || index >= uint32_t(mTemplateArgs.count()))
+            {
+                return false;
+            }
+            const QVector<TypeName>& pack = mTemplatePacks[index];
+            if (mPackIndex < 0 || pack.isEmpty())
+            {
+                *out = mTemplateArgs[index];
+            }
+            else if (mPackIndex < pack.count())
+            {
+                *out = pack[mPackIndex];
+            }
+            if (mPackIndex >= 0 && mTemplateArgs[index].isPack)
+            {
+                mPackSize = pack.count();
+            }
+            return true;
+        }
+
+        bool parseTemplateArgs(QByteArray* out)
+        {
+            mCur++;
+
+            // arguments of outermost name are referenced by template parameters
+            bool outermost = (mDepth == 0);
+            if (++mDepth > MAX_DEPTH)
+            {
+                return false;
+            }
+
+            QVector<TypeName> args;
+            QVector<QVector<TypeName>> packs;
+            while (!consume('E'))
+            {
+                TypeName arg;
+                QVector<TypeName> pack;
+                if (atEnd() || !parseTemplateArg(&arg, &pack))
+                {
+                    return false;
+                }
+                args.append(arg);
+                packs.append(pack);
+            }
+            mDepth--;
+
+            QByteArray result = "<";
+            for (int i = 0; i < args.count(); i++)
+            {
+                QByteArray arg = args[i].full();
+                if (arg.isEmpty())
+                {
+                    // empty argument pack
+                    continue;
+                }
+                if (result.size() != 1)
+                {
+                    result += ", ";
+                }
+                result += arg;
+            }
+            if (!args.isEmpty() && args.last().full().endsWith('>'))
+            {
+                result += ' ';
+            }
+            result += '>';
+
+            if (outermost)
+            {
+                mTemplateArgs = args;
+                mTemplatePacks = packs;
+            }
+
+            *out = result;
+            return true;
+        }
+
+        bool parseTemplateArg(TypeName* out, QVector<TypeName>* pack)
+        {
+            char c = peek();
+            if (c == 'L')
+            {
+                return parseLiteral(&out->left);
+            }
+            if (c == 'J')
+            {
+                // argument pack
+                mCur++;
+                QByteArray args;
+                while (!consume('E'))
+                {
+                    TypeName arg;
+                    QVector<TypeName> nested;
+                    if (atEnd() || !parseTemplateArg(&arg, &nested))
+                    {
+                        return false;
+                    }
+                    if (!args.isEmpty())
+                    {
+                        args += ", ";
+                    }
+                    args += arg.full();
+                    pack->append(arg);
+                }
+                out->left = args;
+                out->isPack = true;
+                return true;
+            }
+            if (c == 'X')
+            {
+                // expressions are not supported
+                return false;
+            }
+            return parseType(out);
+        }
+
+        bool parseLiteral(QByteArray* out)
+        {
+            mCur++;
+
+            if (peek() == '_' && peek(1) == 'Z')
+            {
+                mCur += 2;
+                return parseEncoding(out) && consume('E');
+            }
+
+            if (peek() == 'D' && peek(1) == 'n' && peek(2) == 'E')
+            {
+                mCur += 3;
+                *out = "nullptr";
+                return true;
+            }
+
+            char type = peek();
+            QByteArray typeName;
+            if (BuiltinType(type))
+            {
+                typeName = BuiltinType(type);
+                mCur++;
+            }
+            else
+            {
+                // enumeration
+                TypeName enumType;
+                if (!parseType(&enumType))
+                {
+                    return false;
+                }
+                typeName = enumType.full();
+                type = 0;
+            }
+
+            bool negative = consume('n');
+            uint64_t value;
+            if (!parseNumber(&value) || !consume('E'))
+            {
+                return false;
+            }
+
+            QByteArray number = (negative ? "-" : "") + QByteArray::number(qulonglong(value));
+            switch (type)
+            {
+            case 'b':
+                *out = value ? "true" : "false";
+                break;
+            case 'i':
+                *out = number;
+                break;
+            case 'j':
+                *out = number + 'u';
+                break;
+            case 'l':
+                *out = number + 'l';
+                break;
+            case 'm':
+                *out = number + "ul";
+                break;
+            case 'x':
+                *out = number + "ll";
+                break;
+            case 'y':
+                *out = number + "ull";
+                break;
+            default:
+                *out = '(' + typeName + ')' + number;
+                break;
+            }
+            return true;
+        }
+
+        bool parseType(TypeName* out)
+        {
+            if (++mDepth > MAX_DEPTH)
+            {
+                return false;
+            }
+            bool result = parseTypeInner(out);
+            mDepth--;
+            return result;
+        }
+
+        bool parsePackExpansion(TypeName* out)
+        {
+            const char* pattern = mCur;
+            int oldIndex = mPackIndex;
+            int oldSize = mPackSize;
+
+            mPackIndex = 0;
+            mPackSize = -1;
+
+            bool result = parseType(out);
+            if (result && mPackSize >= 0)
+            {
+                // substitutions are added only from first element
+                const char* end = mCur;
+                int substitutions = mSubstitutions.count();
+
+                QByteArray expanded = mPackSize == 0 ? QByteArray() : out->full();
+                for (mPackIndex = 1; mPackIndex < mPackSize && result; mPackIndex++)
+                {
+                    mCur = pattern;
+                    TypeName element;
+                    result = parseType(&element);
+                    expanded += ", " + element.full();
+                    mSubstitutions.resize(substitutions);
+                }
+                mCur = end;
+
+                out->left = expanded;
+                out->right.clear();
+            }
+
+            mPackIndex = oldIndex;
+            mPackSize = oldSize;
+            return result;
+        }
+
+        bool parseTypeInner(TypeName* out)
+        {
+            char c = peek();
+
+            const char* builtin = BuiltinType(c);
+            if (builtin)
+            {
+                mCur++;
+                out->left = builtin;
+                return true;
+            }
+
+            switch (c)
+            {
+            case 'r':
+            case 'V':
+            case 'K':
+                {
+                    bool isRestrict = consume('r');
+                    bool isVolatile = consume('V');
+                    bool isConst = consume('K');
+
+                    if (!parseType(out))
+                    {
+                        return false;
+                    }
+
+                    // qualifiers of function type are placed after parameters
+                    QByteArray& target = out->right.startsWith('(') ? out->right : out->left;
+                    if (isConst && !target.endsWith(" const"))
+                    {
+                        target += " const";
+                    }
+                    if (isVolatile)
+                    {
+                        target += " volatile";
+                    }
+                    if (isRestrict)
+                    {
+                        target += " restrict";
+                    }
+                    break;
+                }
+
+            case 'P':
+            case 'R':
+            case 'O':
+                {
+                    mCur++;
+                    if (!parseType(out))
+                    {
+                        return false;
+                    }
+
+                    if (c != 'P' && out->reference)
+                    {
+                        // reference collapsing, & && is &, && && is &&
+                        if (c == 'R' && out->reference == 'O')
+                        {
+                            int index = out->left.lastIndexOf("&&");
+                            out->left.remove(index, 1);
+                            out->reference = 'R';
+                        }
+                        break;
+                    }
+
+                    out->reference = (c == 'P' ? 0 : c);
+
+                    const char* pointer = (c == 'P' ? "*" : c == 'R' ? "&" : "&&");
+                    if (out->right.isEmpty() || out->right.startsWith(')'))
+                    {
+                        out->left += pointer;
+                    }
+                    else
+                    {
+                        if (!out->left.endsWith(' '))
+                        {
+                            out->left += ' ';
+                        }
+                        out->left += '(' + QByteArray(pointer);
+                        out->right = ')' + out->right;
+                    }
+                    break;
+                }
+
+            case 'C':
+            case 'G':
+                mCur++;
+                if (!parseType(out))
+                {
+                    return false;
+                }
+                out->left += (c == 'C' ? " _Complex" : " _Imaginary");
+                out->reference = 0;
+                break;
+
+            case 'F':
+                {
+                    mCur++;
+                    consume('Y');
+
+                    TypeName result;
+                    if (!parseType(&result))
+                    {
+                        return false;
+                    }
+
+                    QByteArray params;
+                    if (peek() == 'v' && peek(1) == 'E')
+                    {
+                        mCur++;
+                    }
+                    while (peek() != 'E' && !((peek() == 'R' || peek() == 'O') && peek(1) == 'E'))
+                    {
+                        TypeName param;
+                        if (atEnd() || !parseType(&param))
+                        {
+                            return false;
+                        }
+                        if (!params.isEmpty())
+                        {
+                            params += ", ";
+                        }
+                        params += param.full();
+                    }
+
+                    QByteArray qualifiers;
+                    if (consume('R'))
+                    {
+                        qualifiers = " &";
+                    }
+                    else if (consume('O'))
+                    {
+                        qualifiers = " &&";
+                    }
+                    mCur++;
+
+                    out->left = result.left + ' ';
+                    out->right = '(' + params + ')' + qualifiers + result.right;
+                    break;
+                }
+
+            case 'A':
+                {
+                    mCur++;
+                    QByteArray dimension;
+                    uint64_t size;
+                    if (parseNumber(&size))
+                    {
+                        dimension = QByteArray::number(qulonglong(size));
+                    }
+                    if (!consume('_'))
+                    {
+                        return false;
+                    }
+
+                    TypeName element;
+                    if (!parseType(&element))
+                    {
+                        return false;
+                    }
+                    // multidimensional arrays are printed as "int [2][3]"
+                    out->left = element.left;
+                    out->right = " [" + dimension + ']' + (element.right.startsWith(" [") ? element.right.mid(1) : element.right);
+                    break;
+                }
+
+            case 'M':
+                {
+                    mCur++;
+                    TypeName cls;
+                    TypeName member;
+                    if (!parseType(&cls) || !parseType(&member))
+                    {
+                        return false;
+                    }
+                    if (member.right.startsWith('('))
+                    {
+                        out->left = member.left + '(' + cls.full() + "::*";
+                        out->right = ')' + member.right;
+                    }
+                    else
+                    {
+                        out->left = member.left + ' ' + cls.full() + "::*";
+                        out->right.clear();
+                    }
+                    break;
+                }
+
+            case 'T':
+                if (!parseTemplateParam(out))
+                {
+                    return false;
+                }
+                if (peek() == 'I')
+                {
+                    // template template parameter
+                    addSubstitution(*out);
+                    QByteArray args;
+                    if (!parseTemplateArgs(&args))
+                    {
+                        return false;
+                    }
+                    out->left += args;
+                }
+                break;
+
+            case 'S':
+                if (peek(1) != 't')
+                {
+                    if (!parseSubstitution(out))
+                    {
+                        return false;
+                    }
+                    if (peek() != 'I')
+                    {
+                        // plain substitution is not added again
+                        return true;
+                    }
+                    QByteArray args;
+                    if (!parseTemplateArgs(&args))
+                    {
+                        return false;
+                    }
+                    out->left = out->full() + args;
+                    out->right.clear();
+                    break;
+                }
+                // fall through, name in std namespace
+
+            case 'N':
+            case 'Z':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                {
+                    NameInfo info;
+                    if (!parseName(&out->left, &info))
+                    {
+                        return false;
+                    }
+                    break;
+                }
+
+            case 'u':
+                mCur++;
+                if (!parseSourceName(&out->left))
+                {
+                    return false;
+                }
+                break;
+
+            case 'D':
+                {
+                    char d = peek(1);
+                    mCur += 2;
+
+                    const char* name = BuiltinTypeD(d);
+                    if (name)
+                    {
+                        out->left = name;
+                        // builtin types are not substitution candidates
+                        return true;
+                    }
+
+                    if (d == 'p')
+                    {
+                        // pack expansion, pattern is parsed again for each element of pack
+                        return parsePackExpansion(out);
+                    }
+                    else if (d == 'F')
+                    {
+                        uint64_t bits;
+                        if (!parseNumber(&bits) || !consume('_'))
+                        {
+                            return false;
+                        }
+                        out->left = "_Float" + QByteArray::number(qulonglong(bits));
+                        return true;
+                    }
+                    else if (d == 'v')
+                    {
+                        uint64_t count;
+                        if (!parseNumber(&count) || !consume('_'))
+                        {
+                            return false;
+                        }
+                        TypeName element;
+                        if (!parseType(&element))
+                        {
+                            return false;
+                        }
+                        out->left = element.full() + " __vector(" + QByteArray::number(qulonglong(count)) + ')';
+                    }
+                    else if (d == 'x' || d == 'o')
+                    {
+                        // transaction_safe & noexcept function types
+                        return parseTypeInner(out);
+                    }
+                    else
+                    {
+                        // decltype & other expressions are not supported
+                        return false;
+                    }
+                    break;
+                }
+
+            default:
+                return false;
+            }
+
+            addSubstitution(*out);
+            return true;
+        }
+    };
+
+    QString DemangleMsvc(const QString& name)
+    {
+        // same as what SYMOPT_UNDNAME produces
+        wchar_t buffer[4096];
+        DWORD length = UnDecorateSymbolNameW(reinterpret_cast<const wchar_t*>(name.utf16()), buffer, _countof(buffer), UNDNAME_NAME_ONLY);
+        if (length == 0)
+        {
+            return name;
+        }
+        return QString::fromWCharArray(buffer, length);
+    }
+
+    QString DemangleItanium(const QString& name)
+    {
+        QByteArray mangled = name.toLatin1();
+
+        QByteArray result;
+        ItaniumDemangler demangler(mangled.constData(), mangled.constData() + mangled.size());
+        if (!demangler.demangle(&result))
+        {
+            return name;
+        }
+        return QString::fromLatin1(result);
+    }
+}
+
+bool IsMangledName(const QString& name)
+{
+    return name.startsWith('?') || name.startsWith("_Z");
+}
+
+QString DemangleName(const QString& name)
+{
+    if (name.startsWith('?'))
+    {
+        return DemangleMsvc(name);
+    }
+    if (name.startsWith("_Z"))
+    {
+        return DemangleItanium(name);
+    }
+    return name;
+}
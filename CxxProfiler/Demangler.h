@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Precompiled.h"
+
+// returns true if name is decorated by MSVC or Itanium C++ ABI
+bool IsMangledName(const QString& name);
+
+// returns readable name, or name itself if it is not mangled or cannot be demangled
+QString DemangleName(const QString& name);
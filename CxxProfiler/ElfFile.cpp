@@ -0,0 +1,1248 @@
+#include "ElfFile.h"
+
+namespace
+{
+    enum
+    {
+        ELF_PT_LOAD = 1,
+
+        ELF_SHT_NOBITS = 8,
+        ELF_SHF_COMPRESSED = 0x800,
+        ELF_COMPRESS_ZLIB = 1,
+
+        ELF_STT_FUNC = 2,
+        ELF_STT_GNU_IFUNC = 10,
+
+        ELF_NT_GNU_BUILD_ID = 3,
+    };
+
+    enum
+    {
+        DW_LNS_copy = 1,
+        DW_LNS_advance_pc = 2,
+        DW_LNS_advance_line = 3,
+        DW_LNS_set_file = 4,
+        DW_LNS_const_add_pc = 8,
+        DW_LNS_fixed_advance_pc = 9,
+
+        DW_LNE_end_sequence = 1,
+        DW_LNE_set_address = 2,
+
+        DW_LNCT_path = 1,
+        DW_LNCT_directory_index = 2,
+
+        DW_FORM_data2 = 0x05,
+        DW_FORM_data4 = 0x06,
+        DW_FORM_data8 = 0x07,
+        DW_FORM_string = 0x08,
+        DW_FORM_block = 0x09,
+        DW_FORM_data1 = 0x0b,
+        DW_FORM_strp = 0x0e,
+        DW_FORM_udata = 0x0f,
+        DW_FORM_data16 = 0x1e,
+        DW_FORM_line_strp = 0x1f,
+    };
+
+    // bounds checked little endian reader, after overrun all reads return zeros
+    class Reader
+    {
+    public:
+        Reader(const uchar* data, uint64_t size, uint64_t offset = 0)
+            : mData(data)
+            , mSize(size)
+            , mOffset(offset)
+            , mValid(offset <= size)
+        {
+        }
+
+        bool isValid() const { return mValid; }
+        bool atEnd() const { return mOffset >= mSize; }
+        uint64_t offset() const { return mOffset; }
+
+        void seek(uint64_t offset)
+        {
+            mOffset = offset;
+            if (mOffset > mSize)
+            {
+                mValid = false;
+            }
+        }
+
+        void skip(uint64_t count)
+        {
+            seek(mOffset + count);
+        }
+
+        uint8_t u8() { return read<uint8_t>(); }
+        uint16_t u16() { return read<uint16_t>(); }
+        uint32_t u32() { return read<uint32_t>(); }
+        uint64_t u64() { return read<uint64_t>(); }
+
+        uint64_t address(uint64_t size)
+        {
+            return size == sizeof(uint64_t) ? u64() : u32();
+        }
+
+        uint64_t uleb()
+        {
+            uint64_t result = 0;
+            uint32_t shift = 0;
+            for (;;)
+            {
+                uint8_t byte = u8();
+                if (shift < 64)
+                {
+                    result |= uint64_t(byte & 0x7f) << shift;
+                }
+                shift += 7;
+                if ((byte & 0x80) == 0 || !mValid)
+                {
+                    return result;
+                }
+            }
+        }
+
+        int64_t sleb()
+        {
+            int64_t result = 0;
+            uint32_t shift = 0;
+            uint8_t byte;
+            do
+            {
+                byte = u8();
+                if (shift < 64)
+                {
+                    result |= int64_t(byte & 0x7f) << shift;
+                }
+                shift += 7;
+            } while ((byte & 0x80) != 0 && mValid);
+
+            if (shift < 64 && (byte & 0x40) != 0)
+            {
+                result |= -(int64_t(1) << shift);
+            }
+            return result;
+        }
+
+        const char* cstr()
+        {
+            if (mOffset >= mSize)
+            {
+                mValid = false;
+                return "";
+            }
+
+            const char* str = reinterpret_cast<const char*>(mData + mOffset);
+            const void* end = memchr(str, 0, static_cast<size_t>(mSize - mOffset));
+            if (end == nullptr)
+            {
+                mValid = false;
+                mOffset = mSize;
+                return "";
+            }
+
+            mOffset += static_cast<const char*>(end) - str + 1;
+            return str;
+        }
+
+    private:
+        const uchar* mData;
+        uint64_t mSize;
+        uint64_t mOffset;
+        bool mValid;
+
+        template <typename T>
+        T read()
+        {
+            if (mOffset + sizeof(T) > mSize)
+            {
+                mValid = false;
+                mOffset = mSize;
+                return 0;
+            }
+
+            T value;
+            memcpy(&value, mData + mOffset, sizeof(T));
+            mOffset += sizeof(T);
+            return value;
+        }
+    };
+
+    const char* stringAt(const uchar* data, uint64_t size, uint64_t offset)
+    {
+        if (offset >= size || memchr(data + offset, 0, static_cast<size_t>(size - offset)) == nullptr)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<const char*>(data + offset);
+    }
+
+    struct LineHeader
+    {
+        uint64_t unitEnd;
+        uint64_t programBegin;
+        uint64_t standardLengths;
+        uint64_t tables;
+        uint16_t version;
+        uint8_t addressSize;
+        uint8_t minInstLength;
+        int8_t lineBase;
+        uint8_t lineRange;
+        uint8_t opcodeBase;
+        bool dwarf64;
+    };
+
+    bool parseLineHeader(const uchar* data, uint64_t size, uint64_t offset, uint8_t addressSize, LineHeader* header)
+    {
+        Reader in(data, size, offset);
+
+        uint64_t length = in.u32();
+        header->dwarf64 = length == 0xffffffff;
+        if (header->dwarf64)
+        {
+            length = in.u64();
+        }
+        else if (length >= 0xfffffff0)
+        {
+            return false;
+        }
+
+        header->unitEnd = in.offset() + length;
+        if (!in.isValid() || header->unitEnd > size)
+        {
+            return false;
+        }
+
+        header->version = in.u16();
+        if (header->version < 2 || header->version > 5)
+        {
+            return false;
+        }
+
+        header->addressSize = addressSize;
+        if (header->version >= 5)
+        {
+            header->addressSize = in.u8();
+            in.u8(); // segment selector size
+        }
+
+        uint64_t headerLength = header->dwarf64 ? in.u64() : in.u32();
+        header->programBegin = in.offset() + headerLength;
+
+        header->minInstLength = in.u8();
+        if (header->version >= 4)
+        {
+            in.u8(); // maximum operations per instruction
+        }
+        in.u8(); // default is_stmt
+        header->lineBase = static_cast<int8_t>(in.u8());
+        header->lineRange = in.u8();
+        header->opcodeBase = in.u8();
+
+        header->standardLengths = in.offset();
+        in.skip(header->opcodeBase == 0 ? 0 : header->opcodeBase - 1);
+        header->tables = in.offset();
+
+        return in.isValid() && header->lineRange != 0 && header->programBegin <= header->unitEnd;
+    }
+
+    // callback receives every row: (address, file, line, endSequence, offsetAfterRow), returns false to stop
+    template <typename Callback>
+    void runLineProgram(const uchar* data, const LineHeader& header, uint64_t begin, Callback& callback)
+    {
+        Reader in(data, header.unitEnd, begin);
+
+        uint64_t address = 0;
+        uint32_t file = 1;
+        int64_t line = 1;
+
+        while (!in.atEnd() && in.isValid())
+        {
+            uint8_t opcode = in.u8();
+            if (opcode >= header.opcodeBase)
+            {
+                uint8_t adjusted = opcode - header.opcodeBase;
+                address += uint64_t(adjusted / header.lineRange) * header.minInstLength;
+                line += header.lineBase + adjusted % header.lineRange;
+                if (!callback(address, file, static_cast<uint32_t>(line), false, in.offset()))
+                {
+                    return;
+                }
+            }
+            else if (opcode == 0)
+            {
+                uint64_t length = in.uleb();
+                uint64_t next = in.offset() + length;
+                if (length == 0)
+                {
+                    continue;
+                }
+
+                uint8_t extended = in.u8();
+                if (extended == DW_LNE_end_sequence)
+                {
+                    if (!callback(address, file, static_cast<uint32_t>(line), true, next))
+                    {
+                        return;
+                    }
+                    address = 0;
+                    file = 1;
+                    line = 1;
+                }
+                else if (extended == DW_LNE_set_address)
+                {
+                    address = in.address(length - 1);
+                }
+                in.seek(next);
+            }
+            else
+            {
+                switch (opcode)
+                {
+                case DW_LNS_copy:
+                    if (!callback(address, file, static_cast<uint32_t>(line), false, in.offset()))
+                    {
+                        return;
+                    }
+                    break;
+
+                case DW_LNS_advance_pc:
+                    address += in.uleb() * header.minInstLength;
+                    break;
+
+                case DW_LNS_advance_line:
+                    line += in.sleb();
+                    break;
+
+                case DW_LNS_set_file:
+                    file = static_cast<uint32_t>(in.uleb());
+                    break;
+
+                case DW_LNS_const_add_pc:
+                    address += uint64_t((255 - header.opcodeBase) / header.lineRange) * header.minInstLength;
+                    break;
+
+                case DW_LNS_fixed_advance_pc:
+                    address += in.u16();
+                    break;
+
+                default:
+                    for (uint8_t i = 0; i < data[header.standardLengths + opcode - 1]; i++)
+                    {
+                        in.uleb();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    bool readForm(Reader& in, uint64_t form, bool dwarf64, const uchar* lineStr, uint64_t lineStrSize, const uchar* str, uint64_t strSize, QString* string, uint64_t* value)
+    {
+        switch (form)
+        {
+        case DW_FORM_string:
+            *string = QString::fromUtf8(in.cstr());
+            return true;
+
+        case DW_FORM_line_strp:
+        case DW_FORM_strp:
+        {
+            uint64_t offset = dwarf64 ? in.u64() : in.u32();
+            const char* result = form == DW_FORM_line_strp ? stringAt(lineStr, lineStrSize, offset) : stringAt(str, strSize, offset);
+            *string = result == nullptr ? QString() : QString::fromUtf8(result);
+            return true;
+        }
+
+        case DW_FORM_udata:
+            *value = in.uleb();
+            return true;
+
+        case DW_FORM_data1:
+            *value = in.u8();
+            return true;
+
+        case DW_FORM_data2:
+            *value = in.u16();
+            return true;
+
+        case DW_FORM_data4:
+            *value = in.u32();
+            return true;
+
+        case DW_FORM_data8:
+            *value = in.u64();
+            return true;
+
+        case DW_FORM_data16:
+            in.skip(16);
+            return true;
+
+        case DW_FORM_block:
+            in.skip(in.uleb());
+            return true;
+        }
+
+        return false;
+    }
+
+    // DW_EH_PE_* encoded pointer, only absolute and pc relative values are supported
+    bool readEncoded(Reader& in, uint8_t encoding, uint64_t base, uint8_t pointerSize, uint64_t* value)
+    {
+        uint64_t result;
+        switch (encoding & 0x0f)
+        {
+        case 0x00: result = in.address(pointerSize); break;
+        case 0x01: result = in.uleb(); break;
+        case 0x02: result = in.u16(); break;
+        case 0x03: result = in.u32(); break;
+        case 0x04: result = in.u64(); break;
+        case 0x09: result = in.sleb(); break;
+        case 0x0a: result = static_cast<int16_t>(in.u16()); break;
+        case 0x0b: result = static_cast<int32_t>(in.u32()); break;
+        case 0x0c: result = in.u64(); break;
+        default: return false;
+        }
+
+        switch (encoding & 0x70)
+        {
+        case 0x00: break;
+        case 0x10: result += base; break;
+        default: return false;
+        }
+
+        *value = pointerSize == sizeof(uint64_t) ? result : static_cast<uint32_t>(result);
+        return in.isValid();
+    }
+
+    // returns pointer encoding of FDEs that belong to CIE at offset, 0xff if they can not be read
+    uint8_t parseCieEncoding(const uchar* data, uint64_t size, uint64_t offset, uint8_t pointerSize)
+    {
+        Reader in(data, size, offset);
+        if (in.u32() == 0xffffffff)
+        {
+            in.u64();
+        }
+        in.u32(); // CIE id
+
+        uint8_t version = in.u8();
+        const char* augmentation = in.cstr();
+        if (augmentation[0] != 'z')
+        {
+            return augmentation[0] == 0 ? 0 : 0xff;
+        }
+
+        in.uleb(); // code alignment
+        in.sleb(); // data alignment
+        if (version == 1)
+        {
+            in.u8(); // return address register
+        }
+        else
+        {
+            in.uleb();
+        }
+        in.uleb(); // augmentation length
+
+        for (const char* c = augmentation + 1; *c != 0; c++)
+        {
+            if (*c == 'R')
+            {
+                return in.u8();
+            }
+            else if (*c == 'L')
+            {
+                in.u8();
+            }
+            else if (*c == 'P')
+            {
+                uint64_t personality;
+                if (!readEncoded(in, in.u8(), 0, pointerSize, &personality))
+                {
+                    return 0xff;
+                }
+            }
+            else if (*c != 'S' && *c != 'B')
+            {
+                return 0xff;
+            }
+        }
+
+        return in.isValid() ? 0 : 0xff;
+    }
+
+    const ElfFunction* findRange(const QVector<ElfFunction>& functions, uint64_t address)
+    {
+        auto it = std::upper_bound(functions.constBegin(), functions.constEnd(), address, [](uint64_t value, const ElfFunction& function)
+        {
+            return value < function.address;
+        });
+
+        if (it != functions.constBegin())
+        {
+            --it;
+            if (address - it->address < it->size)
+            {
+                return &*it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    QString joinPath(const QString& folder, const QString& name)
+    {
+        if (folder.isEmpty() || name.startsWith('/') || (name.size() > 1 && name.at(1) == ':'))
+        {
+            return name;
+        }
+        return folder + '/' + name;
+    }
+
+    // file names indexed same way as DW_LNS_set_file operand
+    QStringList parseLineFiles(const uchar* data, const LineHeader& header, const uchar* lineStr, uint64_t lineStrSize, const uchar* str, uint64_t strSize)
+    {
+        Reader in(data, header.programBegin, header.tables);
+
+        QStringList folders;
+        QStringList files;
+
+        if (header.version < 5)
+        {
+            folders.append(QString());
+            for (;;)
+            {
+                const char* folder = in.cstr();
+                if (*folder == 0 || !in.isValid())
+                {
+                    break;
+                }
+                folders.append(QString::fromUtf8(folder));
+            }
+
+            files.append(QString());
+            for (;;)
+            {
+                const char* name = in.cstr();
+                if (*name == 0 || !in.isValid())
+                {
+                    break;
+                }
+                uint64_t folder = in.uleb();
+                in.uleb(); // modification time
+                in.uleb(); // file length
+                files.append(joinPath(folder < uint64_t(folders.count()) ? folders[static_cast<int>(folder)] : QString(), QString::fromUtf8(name)));
+            }
+
+            return files;
+        }
+
+        for (int table = 0; table < 2; table++)
+        {
+            QVector<QPair<uint64_t, uint64_t>> formats;
+            uint8_t formatCount = in.u8();
+            for (uint8_t i = 0; i < formatCount; i++)
+            {
+                uint64_t type = in.uleb();
+                uint64_t form = in.uleb();
+                formats.append(qMakePair(type, form));
+            }
+
+            uint64_t count = in.uleb();
+            for (uint64_t i = 0; i < count && in.isValid(); i++)
+            {
+                QString path;
+                uint64_t folder = 0;
+                for (const auto& format : formats)
+                {
+                    QString string;
+                    uint64_t value = 0;
+                    if (!readForm(in, format.second, header.dwarf64, lineStr, lineStrSize, str, strSize, &string, &value))
+                    {
+                        return files;
+                    }
+
+                    if (format.first == DW_LNCT_path)
+                    {
+                        path = string;
+                    }
+                    else if (format.first == DW_LNCT_directory_index)
+                    {
+                        folder = value;
+                    }
+                }
+
+                if (table == 0)
+                {
+                    folders.append(path);
+                }
+                else
+                {
+                    files.append(joinPath(folder < uint64_t(folders.count()) ? folders[static_cast<int>(folder)] : QString(), path));
+                }
+            }
+        }
+
+        return files;
+    }
+}
+
+ElfFile::ElfFile(const QString& path)
+    : mFile(path)
+{
+}
+
+ElfFile::~ElfFile()
+{
+    if (mData != nullptr)
+    {
+        mFile.unmap(const_cast<uchar*>(mData));
+    }
+}
+
+bool ElfFile::isValid()
+{
+    if (!mOpened)
+    {
+        mOpened = true;
+        mValid = open();
+    }
+    return mValid;
+}
+
+bool ElfFile::hasSymbols()
+{
+    return isValid() && (mSymtab.size != 0 || mDynsym.size != 0);
+}
+
+bool ElfFile::hasLines()
+{
+    return isValid() && mDebugLine.size != 0;
+}
+
+QByteArray ElfFile::getBuildId()
+{
+    if (!isValid())
+    {
+        return QByteArray();
+    }
+
+    Reader in(mBuildId.data, mBuildId.size);
+    while (!in.atEnd())
+    {
+        uint32_t nameSize = in.u32();
+        uint32_t descSize = in.u32();
+        uint32_t type = in.u32();
+        in.skip((nameSize + 3) & ~3);
+        uint64_t desc = in.offset();
+        in.skip((descSize + 3) & ~3);
+
+        if (!in.isValid())
+        {
+            break;
+        }
+
+        if (type == ELF_NT_GNU_BUILD_ID)
+        {
+            return QByteArray(reinterpret_cast<const char*>(mBuildId.data + desc), descSize);
+        }
+    }
+
+    return QByteArray();
+}
+
+bool ElfFile::fileOffsetToAddress(uint64_t offset, uint64_t* address)
+{
+    if (!isValid())
+    {
+        return false;
+    }
+
+    for (const Segment& segment : mSegments)
+    {
+        if (offset >= segment.offset && offset - segment.offset < segment.fileSize)
+        {
+            *address = segment.address + (offset - segment.offset);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const ElfFunction* ElfFile::findFunction(uint64_t address)
+{
+    if (!isValid())
+    {
+        return nullptr;
+    }
+
+    if (!mFunctionsIndexed)
+    {
+        indexFunctions();
+    }
+
+    // unwind entries cover functions missing from symbol table (stripped or static functions)
+    const ElfFunction* function = findRange(mFunctions, address);
+    return function != nullptr ? function : findRange(mFrames, address);
+}
+
+bool ElfFile::findLines(uint64_t address, uint64_t size, QString* file, QVector<ElfLine>* lines)
+{
+    if (!isValid() || mDebugLine.size == 0)
+    {
+        return false;
+    }
+
+    if (!mSequencesIndexed)
+    {
+        indexSequences();
+    }
+
+    auto it = std::upper_bound(mSequences.constBegin(), mSequences.constEnd(), address, [](uint64_t value, const Sequence& sequence)
+    {
+        return value < sequence.low;
+    });
+
+    if (it == mSequences.constBegin())
+    {
+        return false;
+    }
+    --it;
+
+    if (address >= it->high)
+    {
+        return false;
+    }
+
+    LineHeader header;
+    if (!parseLineHeader(mDebugLine.data, mDebugLine.size, it->unit, mIs64 ? 8 : 4, &header))
+    {
+        return false;
+    }
+
+    struct Row
+    {
+        uint64_t address;
+        uint32_t file;
+        uint32_t line;
+    };
+
+    uint64_t end = address + qMax<uint64_t>(size, 1);
+
+    Row start = {};
+    bool hasStart = false;
+    QVector<Row> rows;
+
+    auto callback = [&](uint64_t rowAddress, uint32_t rowFile, uint32_t rowLine, bool endSequence, uint64_t) -> bool
+    {
+        if (endSequence || rowAddress >= end)
+        {
+            return false;
+        }
+
+        Row row = { rowAddress, rowFile, rowLine };
+        if (rowAddress <= address)
+        {
+            start = row;
+            hasStart = true;
+        }
+        else
+        {
+            rows.append(row);
+        }
+        return true;
+    };
+    runLineProgram(mDebugLine.data, header, it->program, callback);
+
+    if (!hasStart)
+    {
+        if (rows.isEmpty())
+        {
+            return false;
+        }
+        start = rows.takeFirst();
+    }
+
+    QStringList files = parseLineFiles(mDebugLine.data, header, mDebugLineStr.data, mDebugLineStr.size, mDebugStr.data, mDebugStr.size);
+    *file = start.file < uint32_t(files.count()) ? files[start.file] : QString();
+
+    // rows from other files are inlined code, address keeps line of caller
+    ElfLine first = { qMax(start.address, address), start.line };
+    lines->append(first);
+    for (const Row& row : rows)
+    {
+        if (row.file != start.file)
+        {
+            continue;
+        }
+
+        if (lines->last().address == row.address)
+        {
+            lines->last().line = row.line;
+        }
+        else
+        {
+            ElfLine line = { row.address, row.line };
+            lines->append(line);
+        }
+    }
+
+    return true;
+}
+
+bool ElfFile::open()
+{
+    if (!mFile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    mSize = mFile.size();
+    if (mSize < 52)
+    {
+        return false;
+    }
+
+    mData = mFile.map(0, mSize);
+    if (mData == nullptr)
+    {
+        return false;
+    }
+
+    // only little endian files are supported
+    if (memcmp(mData, "\x7f" "ELF", 4) != 0 || (mData[4] != 1 && mData[4] != 2) || mData[5] != 1)
+    {
+        return false;
+    }
+    mIs64 = mData[4] == 2;
+
+    Reader in(mData, mSize);
+
+    uint64_t programOffset;
+    uint64_t sectionOffset;
+    if (mIs64)
+    {
+        in.seek(0x20);
+        programOffset = in.u64();
+        sectionOffset = in.u64();
+        in.seek(0x36);
+    }
+    else
+    {
+        in.seek(0x1c);
+        programOffset = in.u32();
+        sectionOffset = in.u32();
+        in.seek(0x2a);
+    }
+    uint16_t programSize = in.u16();
+    uint16_t programCount = in.u16();
+    uint16_t sectionSize = in.u16();
+    uint16_t sectionCount = in.u16();
+    uint16_t sectionNames = in.u16();
+
+    if (!in.isValid())
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < programCount; i++)
+    {
+        in.seek(programOffset + uint64_t(i) * programSize);
+
+        Segment segment;
+        uint32_t type = in.u32();
+        if (mIs64)
+        {
+            in.u32(); // flags
+            segment.offset = in.u64();
+            segment.address = in.u64();
+            in.u64(); // physical address
+            segment.fileSize = in.u64();
+        }
+        else
+        {
+            segment.offset = in.u32();
+            segment.address = in.u32();
+            in.u32(); // physical address
+            segment.fileSize = in.u32();
+        }
+
+        if (in.isValid() && type == ELF_PT_LOAD)
+        {
+            mSegments.append(segment);
+        }
+    }
+
+    struct SectionHeader
+    {
+        uint32_t name;
+        uint32_t type;
+        uint64_t flags;
+        uint64_t address;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t link;
+    };
+
+    QVector<SectionHeader> headers;
+    for (uint16_t i = 0; i < sectionCount; i++)
+    {
+        in.seek(sectionOffset + uint64_t(i) * sectionSize);
+
+        SectionHeader header;
+        header.name = in.u32();
+        header.type = in.u32();
+        if (mIs64)
+        {
+            header.flags = in.u64();
+            header.address = in.u64();
+            header.offset = in.u64();
+            header.size = in.u64();
+        }
+        else
+        {
+            header.flags = in.u32();
+            header.address = in.u32();
+            header.offset = in.u32();
+            header.size = in.u32();
+        }
+        header.link = in.u32();
+
+        if (!in.isValid())
+        {
+            return false;
+        }
+        headers.append(header);
+    }
+
+    if (sectionNames >= headers.count())
+    {
+        return true;
+    }
+
+    const SectionHeader& names = headers[sectionNames];
+    if (names.offset > mSize || names.size > mSize - names.offset)
+    {
+        return true;
+    }
+
+    for (const SectionHeader& header : headers)
+    {
+        const char* name = stringAt(mData + names.offset, names.size, header.name);
+        if (name == nullptr || header.type == ELF_SHT_NOBITS)
+        {
+            continue;
+        }
+
+        Section section = loadSection(header.offset, header.size, header.address, header.flags);
+
+        if (strcmp(name, ".symtab") == 0 || strcmp(name, ".dynsym") == 0)
+        {
+            Section strings;
+            if (header.link < uint32_t(headers.count()))
+            {
+                const SectionHeader& link = headers[header.link];
+                strings = loadSection(link.offset, link.size, link.address, link.flags);
+            }
+
+            if (strcmp(name, ".symtab") == 0)
+            {
+                mSymtab = section;
+                mStrtab = strings;
+            }
+            else
+            {
+                mDynsym = section;
+                mDynstr = strings;
+            }
+        }
+        else if (strcmp(name, ".debug_line") == 0)
+        {
+            mDebugLine = section;
+        }
+        else if (strcmp(name, ".debug_line_str") == 0)
+        {
+            mDebugLineStr = section;
+        }
+        else if (strcmp(name, ".debug_str") == 0)
+        {
+            mDebugStr = section;
+        }
+        else if (strcmp(name, ".note.gnu.build-id") == 0)
+        {
+            mBuildId = section;
+        }
+        else if (strcmp(name, ".eh_frame") == 0)
+        {
+            mEhFrame = section;
+        }
+    }
+
+    return true;
+}
+
+ElfFile::Section ElfFile::loadSection(uint64_t offset, uint64_t size, uint64_t address, uint64_t flags)
+{
+    Section section;
+    if (offset > mSize || size > mSize - offset)
+    {
+        return section;
+    }
+
+    section.address = address;
+
+    if ((flags & ELF_SHF_COMPRESSED) == 0)
+    {
+        section.data = mData + offset;
+        section.size = size;
+        return section;
+    }
+
+    // compressed debug sections are the only ones that are copied
+    Reader in(mData + offset, size);
+    uint32_t type = in.u32();
+    uint64_t uncompressedSize;
+    if (mIs64)
+    {
+        in.u32(); // reserved
+        uncompressedSize = in.u64();
+        in.u64(); // alignment
+    }
+    else
+    {
+        uncompressedSize = in.u32();
+        in.u32(); // alignment
+    }
+
+    if (!in.isValid() || type != ELF_COMPRESS_ZLIB || uncompressedSize > 0x7fffffff)
+    {
+        return section;
+    }
+
+    // qUncompress expects big endian size in front of zlib stream
+    QByteArray compressed;
+    compressed.reserve(static_cast<int>(size - in.offset() + 4));
+    compressed.append(char(uncompressedSize >> 24));
+    compressed.append(char(uncompressedSize >> 16));
+    compressed.append(char(uncompressedSize >> 8));
+    compressed.append(char(uncompressedSize));
+    compressed.append(reinterpret_cast<const char*>(mData + offset + in.offset()), static_cast<int>(size - in.offset()));
+
+    QByteArray uncompressed = qUncompress(compressed);
+    if (uint64_t(uncompressed.size()) != uncompressedSize)
+    {
+        return section;
+    }
+
+    mDecompressed.append(uncompressed);
+    section.data = reinterpret_cast<const uchar*>(uncompressed.constData());
+    section.size = uncompressedSize;
+    return section;
+}
+
+void ElfFile::indexFunctions()
+{
+    mFunctionsIndexed = true;
+
+    if (mSymtab.size != 0)
+    {
+        indexSymbols(mSymtab, mStrtab);
+    }
+    else
+    {
+        indexSymbols(mDynsym, mDynstr);
+    }
+
+    std::stable_sort(mFunctions.begin(), mFunctions.end(), [](const ElfFunction& a, const ElfFunction& b)
+    {
+        return a.address < b.address;
+    });
+
+    // aliases share address, symbols without size extend up to next symbol
+    QVector<ElfFunction> functions;
+    functions.reserve(mFunctions.count());
+    for (const ElfFunction& function : mFunctions)
+    {
+        if (!functions.isEmpty() && functions.last().address == function.address)
+        {
+            if (functions.last().size == 0)
+            {
+                functions.last().size = function.size;
+            }
+            continue;
+        }
+        functions.append(function);
+    }
+
+    for (int i = 0; i + 1 < functions.count(); i++)
+    {
+        if (functions[i].size == 0)
+        {
+            functions[i].size = functions[i + 1].address - functions[i].address;
+        }
+    }
+
+    mFunctions = functions;
+
+    if (mEhFrame.size != 0)
+    {
+        indexFrames();
+    }
+}
+
+void ElfFile::indexSymbols(const Section& symbols, const Section& strings)
+{
+    uint64_t entrySize = mIs64 ? 24 : 16;
+    uint64_t count = symbols.size / entrySize;
+
+    mFunctions.reserve(static_cast<int>(qMin<uint64_t>(count, 0x7fffffff)));
+
+    Reader in(symbols.data, symbols.size);
+    for (uint64_t i = 0; i < count; i++)
+    {
+        in.seek(i * entrySize);
+
+        uint32_t name = in.u32();
+        uint64_t value;
+        uint64_t size;
+        uint8_t info;
+        uint16_t index;
+        if (mIs64)
+        {
+            info = in.u8();
+            in.u8(); // visibility
+            index = in.u16();
+            value = in.u64();
+            size = in.u64();
+        }
+        else
+        {
+            value = in.u32();
+            size = in.u32();
+            info = in.u8();
+            in.u8(); // visibility
+            index = in.u16();
+        }
+
+        uint8_t type = info & 0xf;
+        if ((type != ELF_STT_FUNC && type != ELF_STT_GNU_IFUNC) || index == 0 || value == 0)
+        {
+            continue;
+        }
+
+        const char* str = stringAt(strings.data, strings.size, name);
+        if (str == nullptr || *str == 0)
+        {
+            continue;
+        }
+
+        ElfFunction function = { value, size, str };
+        mFunctions.append(function);
+    }
+}
+
+void ElfFile::indexFrames()
+{
+    uint8_t pointerSize = mIs64 ? 8 : 4;
+    QHash<uint64_t, uint8_t> encodings;
+
+    Reader in(mEhFrame.data, mEhFrame.size);
+    while (!in.atEnd())
+    {
+        uint64_t length = in.u32();
+        if (length == 0)
+        {
+            break;
+        }
+        else if (length == 0xffffffff)
+        {
+            length = in.u64();
+        }
+
+        uint64_t end = in.offset() + length;
+        uint64_t idOffset = in.offset();
+        uint32_t id = in.u32();
+        if (!in.isValid() || end > mEhFrame.size)
+        {
+            break;
+        }
+
+        // non-zero id is backwards offset to CIE of this FDE
+        if (id != 0 && id <= idOffset)
+        {
+            uint64_t cie = idOffset - id;
+            auto it = encodings.constFind(cie);
+            if (it == encodings.constEnd())
+            {
+                it = encodings.insert(cie, parseCieEncoding(mEhFrame.data, mEhFrame.size, cie, pointerSize));
+            }
+
+            uint64_t begin;
+            uint64_t size;
+            if (it.value() != 0xff
+                && readEncoded(in, it.value(), mEhFrame.address + in.offset(), pointerSize, &begin)
+                && readEncoded(in, it.value() & 0x0f, 0, pointerSize, &size)
+                && begin != 0 && size != 0)
+            {
+                ElfFunction function = { begin, size, nullptr };
+                mFrames.append(function);
+            }
+        }
+
+        in.seek(end);
+    }
+
+    std::sort(mFrames.begin(), mFrames.end(), [](const ElfFunction& a, const ElfFunction& b)
+    {
+        return a.address < b.address;
+    });
+}
+
+void ElfFile::indexSequences()
+{
+    mSequencesIndexed = true;
+
+    uint64_t offset = 0;
+    while (offset < mDebugLine.size)
+    {
+        LineHeader header;
+        if (!parseLineHeader(mDebugLine.data, mDebugLine.size, offset, mIs64 ? 8 : 4, &header))
+        {
+            break;
+        }
+
+        uint64_t program = header.programBegin;
+        uint64_t low = 0;
+        bool hasRows = false;
+
+        auto callback = [&](uint64_t address, uint32_t, uint32_t, bool endSequence, uint64_t next) -> bool
+        {
+            if (endSequence)
+            {
+                // sequences at zero address are functions discarded by linker
+                if (hasRows && low != 0 && address > low)
+                {
+                    Sequence sequence = { low, address, offset, program };
+                    mSequences.append(sequence);
+                }
+                program = next;
+                hasRows = false;
+            }
+            else if (!hasRows)
+            {
+                low = address;
+                hasRows = true;
+            }
+            return true;
+        };
+        runLineProgram(mDebugLine.data, header, header.programBegin, callback);
+
+        offset = header.unitEnd;
+    }
+
+    std::sort(mSequences.begin(), mSequences.end(), [](const Sequence& a, const Sequence& b)
+    {
+        return a.low < b.low;
+    });
+}
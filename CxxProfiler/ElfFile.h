@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Precompiled.h"
+
+// functions without name come from .eh_frame unwind entries of stripped files
+struct ElfFunction
+{
+    uint64_t address;
+    uint64_t size;
+    const char* name;
+};
+
+struct ElfLine
+{
+    uint64_t address;
+    uint32_t line;
+};
+
+// Read-only view of ELF file (little endian, 32 or 64-bit). Whole file is
+// memory mapped and function names point directly into mapping. Symbol table
+// and .debug_line sequences are indexed lazily on first lookup, line rows are
+// decoded only for sequence that covers requested function.
+class ElfFile
+{
+    Q_DISABLE_COPY(ElfFile)
+
+public:
+    explicit ElfFile(const QString& path);
+    ~ElfFile();
+
+    bool isValid();
+    bool hasSymbols();
+    bool hasLines();
+    QByteArray getBuildId();
+
+    bool fileOffsetToAddress(uint64_t offset, uint64_t* address);
+
+    const ElfFunction* findFunction(uint64_t address);
+    bool findLines(uint64_t address, uint64_t size, QString* file, QVector<ElfLine>* lines);
+
+private:
+    struct Section
+    {
+        const uchar* data = nullptr;
+        uint64_t size = 0;
+        uint64_t address = 0;
+    };
+
+    struct Segment
+    {
+        uint64_t offset;
+        uint64_t address;
+        uint64_t fileSize;
+    };
+
+    struct Sequence
+    {
+        uint64_t low;
+        uint64_t high;
+        uint64_t unit;
+        uint64_t program;
+    };
+
+    QFile mFile;
+    const uchar* mData = nullptr;
+    uint64_t mSize = 0;
+
+    bool mOpened = false;
+    bool mValid = false;
+    bool mIs64 = false;
+
+    QVector<Segment> mSegments;
+    QVector<QByteArray> mDecompressed;
+
+    Section mSymtab;
+    Section mStrtab;
+    Section mDynsym;
+    Section mDynstr;
+    Section mDebugLine;
+    Section mDebugLineStr;
+    Section mDebugStr;
+    Section mBuildId;
+    Section mEhFrame;
+
+    bool mFunctionsIndexed = false;
+    QVector<ElfFunction> mFunctions;
+    QVector<ElfFunction> mFrames;
+
+    bool mSequencesIndexed = false;
+    QVector<Sequence> mSequences;
+
+    bool open();
+    Section loadSection(uint64_t offset, uint64_t size, uint64_t address, uint64_t flags);
+
+    void indexFunctions();
+    void indexSymbols(const Section& symbols, const Section& strings);
+    void indexFrames();
+    void indexSequences();
+};
+
+typedef QSharedPointer<ElfFile> ElfFilePtr;
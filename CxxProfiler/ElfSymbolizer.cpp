@@ -0,0 +1,166 @@
+#include "ElfSymbolizer.h"
+
+ElfSymbolizer::ElfSymbolizer(SymbolTable* symbols, const QString& root)
+    : mSymbols(symbols)
+    , mRoot(root)
+{
+}
+
+void ElfSymbolizer::addMapping(uint64_t start, uint64_t end, uint64_t offset, const QString& path)
+{
+    if (end <= start)
+    {
+        return;
+    }
+
+    Mapping mapping;
+    mapping.path = path;
+    mapping.name = QFileInfo(path).fileName();
+    mapping.start = start;
+    mapping.offset = offset;
+    mapping.opened = false;
+
+    // mmap over existing mapping replaces it
+    mMappings.replace(start, static_cast<uint32_t>(qMin<uint64_t>(end - start, 0xFFFFFFFF)), mapping);
+}
+
+uint32_t ElfSymbolizer::lookupSymbol(uint64_t address, uint32_t* line)
+{
+    int index = mMappings.find(address);
+    if (index < 0)
+    {
+        return 0;
+    }
+
+    const MappedSymbol* resolved = resolveSymbol(mMappings[index], address);
+    if (resolved == nullptr)
+    {
+        return 0;
+    }
+
+    *line = resolved->lines.find(static_cast<uint32_t>(address - (*mSymbols)[resolved->symbol].address));
+    return resolved->symbol;
+}
+
+ElfFilePtr ElfSymbolizer::openFile(const QString& path)
+{
+    auto it = mFiles.constFind(path);
+    if (it != mFiles.constEnd())
+    {
+        return it.value();
+    }
+
+    QString located = path;
+    if (!QFile::exists(located) && !mRoot.isEmpty())
+    {
+        located = mRoot + path;
+        if (!QFile::exists(located))
+        {
+            located = QDir(mRoot).filePath(QFileInfo(path).fileName());
+        }
+    }
+
+    ElfFilePtr file(new ElfFile(located));
+    if (!file->isValid())
+    {
+        file.reset();
+    }
+
+    mFiles.insert(path, file);
+    return file;
+}
+
+ElfFilePtr ElfSymbolizer::openDebugFile(const ElfFilePtr& file)
+{
+    QByteArray buildId = file->getBuildId().toHex();
+    if (buildId.size() < 3)
+    {
+        return ElfFilePtr();
+    }
+
+    QString path = QString("/usr/lib/debug/.build-id/%1/%2.debug")
+        .arg(QString::fromLatin1(buildId.left(2)))
+        .arg(QString::fromLatin1(buildId.mid(2)));
+    return openFile(path);
+}
+
+const ElfSymbolizer::MappedSymbol* ElfSymbolizer::resolveSymbol(Mapping& mapping, uint64_t address)
+{
+    int index = mapping.symbols.find(address);
+    if (index >= 0)
+    {
+        return &mapping.symbols[index];
+    }
+
+    if (!mapping.opened)
+    {
+        mapping.opened = true;
+        mapping.file = openFile(mapping.path);
+        if (mapping.file && (!mapping.file->hasSymbols() || !mapping.file->hasLines()))
+        {
+            mapping.debugFile = openDebugFile(mapping.file);
+        }
+    }
+
+    if (!mapping.file)
+    {
+        return nullptr;
+    }
+
+    // process address -> file offset -> virtual address in ELF file
+    uint64_t elfAddress;
+    if (!mapping.file->fileOffsetToAddress(address - mapping.start + mapping.offset, &elfAddress))
+    {
+        return nullptr;
+    }
+    uint64_t bias = address - elfAddress;
+
+    ElfFile* symbolFile = mapping.file->hasSymbols() || !mapping.debugFile ? mapping.file.data() : mapping.debugFile.data();
+    ElfFile* lineFile = mapping.file->hasLines() || !mapping.debugFile ? mapping.file.data() : mapping.debugFile.data();
+
+    const ElfFunction* function = symbolFile->findFunction(elfAddress);
+    if (function == nullptr)
+    {
+        return nullptr;
+    }
+
+    QString name = function->name == nullptr
+        ? QString("%1+0x%2").arg(mapping.name).arg(function->address, 0, 16)
+        : QString::fromUtf8(function->name);
+    QString file;
+
+    Symbol symbol;
+    symbol.address = function->address + bias;
+    symbol.size = static_cast<uint32_t>(qMin<uint64_t>(function->size, 0xFFFFFFFF));
+    symbol.module = mSymbols->addString(mapping.name);
+    symbol.line = 0;
+    symbol.lineLast = 0;
+    symbol.flags = 0;
+
+    // line table is stored relative to function start
+    MappedSymbol resolved;
+
+    QVector<ElfLine> elfLines;
+    if (lineFile->findLines(function->address, function->size, &file, &elfLines))
+    {
+        CachedLines lines;
+        lines.reserve(elfLines.count());
+        for (const ElfLine& elfLine : elfLines)
+        {
+            CachedLine line;
+            line.rva = static_cast<uint32_t>(elfLine.address - function->address);
+            line.line = elfLine.line;
+            lines.append(line);
+
+            symbol.line = symbol.line == 0 ? line.line : qMin(symbol.line, line.line);
+            symbol.lineLast = qMax(symbol.lineLast, line.line);
+        }
+        resolved.lines = LineTable(lines, 0);
+    }
+
+    symbol.name = mSymbols->addString(name);
+    symbol.file = mSymbols->addString(file);
+    resolved.symbol = mSymbols->addSymbol(symbol);
+
+    return &mapping.symbols.insert(symbol.address, symbol.size, resolved);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "Symbols.h"
+#include "ElfFile.h"
+#include "AddressIndex.h"
+#include "LineTable.h"
+
+// Resolves addresses of Linux process from its memory mappings using ELF symbol
+// tables and DWARF line tables. ELF files are shared between mappings and opened
+// only when first address inside them is resolved. Separate debug files are looked
+// up by build-id under /usr/lib/debug. Files of other machine can be copied under
+// root folder, with or without their directories. Resolved symbols are added to
+// given symbol table.
+class ElfSymbolizer
+{
+    Q_DISABLE_COPY(ElfSymbolizer)
+
+public:
+    ElfSymbolizer(SymbolTable* symbols, const QString& root);
+
+    void addMapping(uint64_t start, uint64_t end, uint64_t offset, const QString& path);
+
+    uint32_t lookupSymbol(uint64_t address, uint32_t* line);
+
+private:
+    struct MappedSymbol
+    {
+        uint32_t symbol;
+        LineTable lines;
+    };
+
+    struct Mapping
+    {
+        QString path;
+        QString name;
+        uint64_t start;
+        uint64_t offset;
+        bool opened;
+        ElfFilePtr file;
+        ElfFilePtr debugFile;
+        AddressIndex<MappedSymbol> symbols;
+    };
+
+    SymbolTable* mSymbols;
+    QString mRoot;
+    AddressIndex<Mapping> mMappings;
+    QHash<QString, ElfFilePtr> mFiles;
+
+    ElfFilePtr openFile(const QString& path);
+    ElfFilePtr openDebugFile(const ElfFilePtr& file);
+    const MappedSymbol* resolveSymbol(Mapping& mapping, uint64_t address);
+};
@@ -0,0 +1,46 @@
+#include "Export.h"
+
+namespace
+{
+    struct ExportFormat
+    {
+        const char* name;
+        const char* extension;
+        bool (*write)(const QString& fileName, const ProfileData& profile, QString* error);
+    };
+
+    const ExportFormat ExportFormats[] =
+    {
+        { "pprof Profile", ".pb.gz", &ExportPprof },
+        { "Folded Stacks", ".folded", &ExportFolded },
+        { "Speedscope", ".speedscope.json", &ExportSpeedscope },
+        { "Chrome Trace", ".trace.json", &ExportChromeTrace },
+        { "Callgrind", ".callgrind", &ExportCallgrind },
+        { "SQLite Database", ".sqlite", &ExportSqlite },
+        { "HTML Report", ".html", &ExportHtmlReport },
+    };
+}
+
+QString GetExportFilter()
+{
+    QStringList filters;
+    for (const ExportFormat& format : ExportFormats)
+    {
+        filters.append(QString("%1 (*%2)").arg(format.name).arg(format.extension));
+    }
+    return filters.join(";;");
+}
+
+bool ExportProfile(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    for (const ExportFormat& format : ExportFormats)
+    {
+        if (fileName.endsWith(format.extension, Qt::CaseInsensitive))
+        {
+            return format.write(fileName, profile, error);
+        }
+    }
+
+    *error = "Unknown export format";
+    return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "ProfileData.h"
+
+// filter for file dialog, one entry per export format
+QString GetExportFilter();
+
+// format is chosen by extension of file name
+bool ExportProfile(const QString& fileName, const ProfileData& profile, QString* error);
+
+// gzip compressed profile.proto, as read by pprof
+bool ExportPprof(const QString& fileName, const ProfileData& profile, QString* error);
+
+// Brendan Gregg's folded stacks, "thread;root;...;leaf count" line per unique stack
+bool ExportFolded(const QString& fileName, const ProfileData& profile, QString* error);
+
+// speedscope "sampled" profile per thread, weighted by time between samples
+bool ExportSpeedscope(const QString& fileName, const ProfileData& profile, QString* error);
+
+// Chrome trace event format, begin & end events of frames per thread, for chrome://tracing or Perfetto
+bool ExportChromeTrace(const QString& fileName, const ProfileData& profile, QString* error);
+
+// callgrind format for KCachegrind, self samples per line & inclusive samples per call site
+bool ExportCallgrind(const QString& fileName, const ProfileData& profile, QString* error);
+
+// normalized SQLite database of strings, modules, symbols, threads, stacks, stack_frames & samples
+bool ExportSqlite(const QString& fileName, const ProfileData& profile, QString* error);
+
+// single HTML file with flat profile, call graph, flame graph & source of hottest functions, data is embedded as JSON
+bool ExportHtmlReport(const QString& fileName, const ProfileData& profile, QString* error);
+
+// appends quoted & escaped UTF-8 string
+void AppendJsonString(QByteArray& out, const QString& string);
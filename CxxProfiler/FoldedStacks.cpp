@@ -0,0 +1,262 @@
+#include "Export.h"
+#include "Import.h"
+
+namespace
+{
+    const int FOLDED_CHUNK_SIZE = 1 << 20;
+
+    // ';' separates frames, everything after last space is count
+    QByteArray FrameName(const QString& name)
+    {
+        if (name.isEmpty())
+        {
+            return "[unknown]";
+        }
+
+        QByteArray result = name.toUtf8();
+        result.replace(';', ':');
+        result.replace('\n', ' ');
+        return result;
+    }
+
+    // thread names written by export are recognized as first frame
+    int ThreadIndex(const QByteArray& frame)
+    {
+        if (frame == "Main Thread")
+        {
+            return 0;
+        }
+        if (frame.startsWith("Thread #"))
+        {
+            bool ok;
+            int index = frame.mid(8).toInt(&ok);
+            if (ok && index > 0 && index < 0x10000)
+            {
+                return index;
+            }
+        }
+        return -1;
+    }
+}
+
+bool ExportFolded(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    const SymbolTable& symbols = profile.symbols;
+
+    // names are converted once per symbol, not per sample
+    QVector<QByteArray> names(symbols.count());
+
+    QByteArray out;
+    bool ok = true;
+
+    for (int thread = 0; thread < profile.callStacks.count() && ok; thread++)
+    {
+        const ThreadCallStack& callStack = profile.callStacks[thread];
+
+        // stacks are folded to tree of (parent, symbol) nodes from root, samples are counted per node
+        QVector<uint32_t> parents(1);
+        QVector<uint32_t> nodeSymbols(1);
+        QVector<uint64_t> counts(1);
+        QHash<QPair<uint32_t, uint32_t>, uint32_t> nodes;
+
+        int first = 0;
+        for (int i = 0; i < callStack.count(); i++)
+        {
+            if (callStack[i].symbol != 0)
+            {
+                continue;
+            }
+
+            uint32_t node = 0;
+            for (int k = i - 1; k >= first; k--)
+            {
+                QPair<uint32_t, uint32_t> key = qMakePair(node, callStack[k].symbol);
+
+                auto it = nodes.constFind(key);
+                if (it == nodes.constEnd())
+                {
+                    it = nodes.insert(key, parents.count());
+                    parents.append(node);
+                    nodeSymbols.append(callStack[k].symbol);
+                    counts.append(0);
+                }
+                node = it.value();
+            }
+
+            counts[node] += SampleWeight(callStack[i]);
+            first = i + 1;
+        }
+
+        QByteArray threadName = FrameName(GetThreadName(thread));
+
+        QVector<uint32_t> path;
+        for (int node = 1; node < counts.count() && ok; node++)
+        {
+            if (counts[node] == 0)
+            {
+                continue;
+            }
+
+            path.clear();
+            for (uint32_t parent = node; parent != 0; parent = parents[parent])
+            {
+                path.append(nodeSymbols[parent]);
+            }
+
+            out.append(threadName);
+            for (int k = path.count() - 1; k >= 0; k--)
+            {
+                QByteArray& name = names[path[k]];
+                if (name.isEmpty())
+                {
+                    name = FrameName(symbols.getDisplayName(path[k]));
+                }
+                out.append(';');
+                out.append(name);
+            }
+            out.append(' ');
+            out.append(QByteArray::number(counts[node]));
+            out.append('\n');
+
+            if (out.size() >= FOLDED_CHUNK_SIZE)
+            {
+                ok = file.write(out) == out.size();
+                out.clear();
+            }
+        }
+    }
+
+    if (ok)
+    {
+        ok = file.write(out) == out.size();
+    }
+
+    if (!ok)
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ImportFolded(const QString& fileName, ProfileData* profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    SymbolTable& symbols = profile->symbols;
+    uint32_t module = symbols.addString(QFileInfo(fileName).fileName());
+
+    // frames are looked up by their raw bytes, strings are created only for new symbols
+    QHash<QByteArray, uint32_t> symbolIds;
+
+    QVector<CallStackEntry> frames;
+    int lineNumber = 0;
+
+    while (!file.atEnd())
+    {
+        QByteArray line = file.readLine();
+        lineNumber++;
+
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        int space = line.lastIndexOf(' ');
+        bool ok = space > 0;
+        qulonglong count = ok ? line.mid(space + 1).toULongLong(&ok) : 0;
+        if (!ok)
+        {
+            *error = QString("Invalid line %1").arg(lineNumber);
+            return false;
+        }
+
+        int thread = 0;
+        frames.clear();
+
+        int start = 0;
+        bool firstFrame = true;
+        while (start < space)
+        {
+            int end = line.indexOf(';', start);
+            if (end < 0 || end > space)
+            {
+                end = space;
+            }
+
+            QByteArray frame = QByteArray::fromRawData(line.constData() + start, end - start);
+            start = end + 1;
+
+            if (firstFrame)
+            {
+                firstFrame = false;
+
+                int index = ThreadIndex(frame);
+                if (index >= 0)
+                {
+                    thread = index;
+                    continue;
+                }
+            }
+
+            auto it = symbolIds.constFind(frame);
+            if (it == symbolIds.constEnd())
+            {
+                Symbol symbol;
+                symbol.address = 0;
+                symbol.size = 0;
+                symbol.name = symbols.addString(QString::fromUtf8(frame));
+                symbol.file = 0;
+                symbol.module = module;
+                symbol.line = 0;
+                symbol.lineLast = 0;
+                symbol.flags = 0;
+
+                // key must own its bytes, frame points into line
+                it = symbolIds.insert(QByteArray(frame.constData(), frame.size()), symbols.addSymbol(symbol));
+            }
+
+            CallStackEntry entry;
+            entry.symbol = it.value();
+            frames.append(entry);
+        }
+
+        if (frames.isEmpty() || count == 0)
+        {
+            continue;
+        }
+
+        // folded stacks go from root to leaf, samples from leaf to root
+        // stack is stored once, count of its samples is in terminating entry
+        std::reverse(frames.begin(), frames.end());
+        CallStackEntry end;
+        end.offset = static_cast<uint32_t>(qMin<qulonglong>(count, 0xFFFFFFFF) - 1);
+        frames.append(end);
+
+        if (thread >= profile->callStacks.count())
+        {
+            profile->callStacks.resize(thread + 1);
+        }
+
+        profile->callStacks[thread].append(frames);
+    }
+
+    profile->symbolModules.fill(0, symbols.count());
+    return true;
+}
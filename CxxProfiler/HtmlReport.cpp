@@ -0,0 +1,294 @@
+#include "Export.h"
+#include "SourceLoader.h"
+
+namespace
+{
+    const int REPORT_FLAT_LIMIT = 1000;     // rows of flat profile per thread
+    const int REPORT_SOURCE_LIMIT = 10;     // functions with most self samples get source excerpts
+    const int REPORT_SOURCE_CONTEXT = 3;    // lines around function
+    const int REPORT_SOURCE_MAX_LINES = 300;
+    const int REPORT_TREE_FRACTION = 2000;  // call graph nodes with less than 1/2000 of thread samples are left out
+
+    // symbols are renumbered in order of first use, so report has only symbols it shows
+    class ReportSymbols
+    {
+    public:
+        explicit ReportSymbols(const SymbolTable& symbols)
+            : mSymbols(symbols)
+            , mIndices(symbols.count(), -1)
+        {
+        }
+
+        int index(uint32_t symbol)
+        {
+            if (mIndices[symbol] < 0)
+            {
+                mIndices[symbol] = mUsed.count();
+                mUsed.append(symbol);
+            }
+            return mIndices[symbol];
+        }
+
+        void write(QByteArray& out) const
+        {
+            out.append('[');
+            for (int i = 0; i < mUsed.count(); i++)
+            {
+                uint32_t symbol = mUsed[i];
+                out.append(i == 0 ? "[" : ",[");
+                AppendJsonString(out, mSymbols.getDisplayName(symbol));
+                out.append(',');
+                AppendJsonString(out, mSymbols.getModule(symbol));
+                out.append(',');
+                AppendJsonString(out, mSymbols.getFile(symbol));
+                out.append(',');
+                out.append(QByteArray::number(mSymbols[symbol].line));
+                out.append(']');
+            }
+            out.append(']');
+        }
+
+    private:
+        const SymbolTable& mSymbols;
+        QVector<int> mIndices;
+        QVector<uint32_t> mUsed;
+    };
+
+    void AppendNumbers(QByteArray& out, const QVector<uint32_t>& numbers)
+    {
+        out.append('[');
+        for (int i = 0; i < numbers.count(); i++)
+        {
+            if (i != 0)
+            {
+                out.append(',');
+            }
+            out.append(QByteArray::number(numbers[i]));
+        }
+        out.append(']');
+    }
+
+    // flat array of (symbol, line, self, total, first child, child count), children of node are next to each other
+    QVector<uint32_t> EncodeCallGraph(const CallGraph& graph, uint32_t minimum, ReportSymbols& symbols)
+    {
+        QVector<uint32_t> queue;
+        queue.append(0);
+
+        QVector<uint32_t> result;
+        QVector<uint32_t> childs;
+        for (int i = 0; i < queue.count(); i++)
+        {
+            const CallGraphNode& node = graph[queue[i]];
+
+            childs.clear();
+            for (uint32_t index = node.child; index != 0; index = graph[index].next)
+            {
+                if (graph[index].total >= minimum)
+                {
+                    childs.append(index);
+                }
+            }
+            std::sort(childs.begin(), childs.end(), [&graph](uint32_t a, uint32_t b)
+            {
+                return graph[a].total > graph[b].total;
+            });
+
+            result.append(i == 0 ? 0 : symbols.index(node.symbol));
+            result.append(node.line);
+            result.append(node.self);
+            result.append(node.total);
+            result.append(queue.count());
+            result.append(childs.count());
+
+            queue += childs;
+        }
+        return result;
+    }
+
+    QVector<uint32_t> EncodeFlat(const FlatSymbols& flat, ReportSymbols& symbols)
+    {
+        QVector<uint32_t> ids;
+        for (int id = 1; id < flat.count(); id++)
+        {
+            if (flat[id].total != 0)
+            {
+                ids.append(id);
+            }
+        }
+        std::sort(ids.begin(), ids.end(), [&flat](uint32_t a, uint32_t b)
+        {
+            return flat[a].total > flat[b].total;
+        });
+
+        QVector<uint32_t> result;
+        for (int i = 0; i < ids.count() && i < REPORT_FLAT_LIMIT; i++)
+        {
+            result.append(symbols.index(ids[i]));
+            result.append(flat[ids[i]].self);
+            result.append(flat[ids[i]].total);
+        }
+        return result;
+    }
+
+    // excerpts of functions with most self samples over all threads, with percents per line
+    void WriteSources(QByteArray& out, const SymbolTable& symbolTable, uint32_t sampleCount, const ProfileAggregates& aggregates, ReportSymbols& symbols)
+    {
+        QVector<uint32_t> self(symbolTable.count());
+        for (const FlatThread& thread : aggregates.flatThreads)
+        {
+            for (int id = 1; id < thread.second.count(); id++)
+            {
+                self[id] += thread.second[id].self;
+            }
+        }
+
+        QVector<uint32_t> ids;
+        for (int id = 1; id < self.count(); id++)
+        {
+            if (self[id] != 0 && symbolTable[id].file != 0 && symbolTable[id].line != 0)
+            {
+                ids.append(id);
+            }
+        }
+        std::sort(ids.begin(), ids.end(), [&self](uint32_t a, uint32_t b)
+        {
+            return self[a] > self[b];
+        });
+
+        SourceLoader loader(sampleCount, aggregates.fileProfile);
+
+        out.append('[');
+        int written = 0;
+        for (int i = 0; i < ids.count() && written < REPORT_SOURCE_LIMIT; i++)
+        {
+            const Symbol& symbol = symbolTable[ids[i]];
+            const QString& file = symbolTable.getFile(ids[i]);
+
+            int lineFrom = qMax(1, static_cast<int>(symbol.line) - REPORT_SOURCE_CONTEXT);
+            int lineTo = qMin(static_cast<int>(qMax(symbol.line, symbol.lineLast)) + REPORT_SOURCE_CONTEXT, lineFrom + REPORT_SOURCE_MAX_LINES - 1);
+
+            LoadResult source = loader.load(file, lineFrom, lineTo).result();
+            if (!source.loaded)
+            {
+                continue;
+            }
+
+            // loader may return more lines than asked for, starting with line loadedFrom
+            QStringList lines = source.source.split('\n');
+            int first = lineFrom - source.loadedFrom;
+            int count = qMin(lineTo - lineFrom + 1, lines.count() - first);
+            if (first < 0 || count <= 0)
+            {
+                continue;
+            }
+
+            out.append(written++ == 0 ? "{\"symbol\":" : ",{\"symbol\":");
+            out.append(QByteArray::number(symbols.index(ids[i])));
+            out.append(",\"file\":");
+            AppendJsonString(out, file);
+            out.append(",\"first\":");
+            out.append(QByteArray::number(lineFrom));
+            out.append(",\"lines\":[");
+            for (int k = 0; k < count; k++)
+            {
+                if (k != 0)
+                {
+                    out.append(',');
+                }
+                AppendJsonString(out, lines[first + k]);
+            }
+            out.append("],\"percents\":[");
+            for (int k = 0; k < count; k++)
+            {
+                if (k != 0)
+                {
+                    out.append(',');
+                }
+                AppendJsonString(out, source.percents.value(first + k));
+            }
+            out.append("]}");
+        }
+        out.append(']');
+    }
+}
+
+bool ExportHtmlReport(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile templateFile(":/CxxProfiler/Report.html");
+    if (!templateFile.open(QIODevice::ReadOnly))
+    {
+        *error = "Report template is missing";
+        return false;
+    }
+    QByteArray html = templateFile.readAll();
+
+    // all frames are shown, imported profiles often have no source files
+    ProfileAggregates aggregates;
+    aggregates.sampleCount = AggregateProfile(profile.symbols, profile.callStacks, true,
+        aggregates.flatThreads, aggregates.callGraphThreads, aggregates.fileProfile);
+
+    ReportSymbols symbols(profile.symbols);
+
+    QByteArray data;
+    data.append("{\"title\":");
+    AppendJsonString(data, QFileInfo(fileName).completeBaseName());
+    data.append(",\"samples\":");
+    data.append(QByteArray::number(aggregates.sampleCount));
+
+    // flat & call graph threads are matched by name, both are left out for threads without samples
+    data.append(",\"threads\":[");
+    bool firstThread = true;
+    for (const CallGraphThread& thread : aggregates.callGraphThreads)
+    {
+        const CallGraph& graph = thread.second;
+
+        uint32_t threadSamples = 0;
+        for (uint32_t index = graph[0].child; index != 0; index = graph[index].next)
+        {
+            threadSamples += graph[index].total;
+        }
+
+        data.append(firstThread ? "{\"name\":" : ",{\"name\":");
+        firstThread = false;
+        AppendJsonString(data, thread.first);
+        data.append(",\"samples\":");
+        data.append(QByteArray::number(threadSamples));
+
+        data.append(",\"flat\":");
+        QVector<uint32_t> flatRows;
+        for (const FlatThread& flat : aggregates.flatThreads)
+        {
+            if (flat.first == thread.first)
+            {
+                flatRows = EncodeFlat(flat.second, symbols);
+                break;
+            }
+        }
+        AppendNumbers(data, flatRows);
+
+        data.append(",\"tree\":");
+        AppendNumbers(data, EncodeCallGraph(graph, qMax(1U, threadSamples / REPORT_TREE_FRACTION), symbols));
+        data.append('}');
+    }
+    data.append(']');
+
+    data.append(",\"sources\":");
+    WriteSources(data, profile.symbols, aggregates.sampleCount, aggregates, symbols);
+
+    // symbols go last, after every user of them has been written
+    data.append(",\"symbols\":");
+    symbols.write(data);
+    data.append('}');
+
+    // JSON is inside script element, which would be closed by "</" in strings
+    data.replace("</", "<\\/");
+    html.replace("{{PROFILE}}", data);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(html) != html.size())
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#include "Import.h"
+
+namespace
+{
+    struct ImportFormat
+    {
+        const char* name;
+        const char* extensions; // separated by space
+        bool (*read)(const QString& fileName, ProfileData* profile, QString* error);
+    };
+
+    const ImportFormat ImportFormats[] =
+    {
+        { "Folded Stacks", ".folded .collapsed", &ImportFolded },
+        { "perf script Output", ".perf .perf-script", &ImportPerfScript },
+    };
+}
+
+QString GetImportFilter()
+{
+    QStringList filters;
+    for (const ImportFormat& format : ImportFormats)
+    {
+        QString extensions = QString(format.extensions).replace(".", "*.");
+        filters.append(QString("%1 (%2)").arg(format.name).arg(extensions));
+    }
+    return filters.join(";;");
+}
+
+bool ImportProfile(const QString& fileName, ProfileData* profile, QString* error)
+{
+    for (const ImportFormat& format : ImportFormats)
+    {
+        for (const QString& extension : QString(format.extensions).split(' '))
+        {
+            if (fileName.endsWith(extension, Qt::CaseInsensitive))
+            {
+                return format.read(fileName, profile, error);
+            }
+        }
+    }
+
+    *error = "Unknown import format";
+    return false;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "ProfileData.h"
+
+// filter for file dialog, one entry per import format
+QString GetImportFilter();
+
+// format is chosen by extension of file name, imported profile uses 64-bit pointers
+bool ImportProfile(const QString& fileName, ProfileData* profile, QString* error);
+
+// Brendan Gregg's folded stacks, one "frame;frame;frame count" line per stack
+bool ImportFolded(const QString& fileName, ProfileData* profile, QString* error);
+
+// text output of "perf script", threads are split by tid & only samples of first event are used,
+// with --show-mmap-events frames get file & line from DSOs found at their paths or next to imported file
+bool ImportPerfScript(const QString& fileName, ProfileData* profile, QString* error);
@@ -0,0 +1,242 @@
+#include "JitSymbols.h"
+
+namespace
+{
+    const uint32_t JITDUMP_MAGIC = 0x4A695444; // 'JiTD'
+
+    enum
+    {
+        JIT_CODE_LOAD = 0,
+        JIT_CODE_MOVE = 1,
+    };
+
+#pragma pack(push, 1)
+    struct JitDumpHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t totalSize;
+        uint32_t elfMach;
+        uint32_t pad;
+        uint32_t pid;
+        uint64_t timestamp;
+        uint64_t flags;
+    };
+
+    struct JitRecordHeader
+    {
+        uint32_t id;
+        uint32_t totalSize;
+        uint64_t timestamp;
+    };
+
+    struct JitCodeLoad
+    {
+        uint32_t pid;
+        uint32_t tid;
+        uint64_t vma;
+        uint64_t codeAddress;
+        uint64_t codeSize;
+        uint64_t codeIndex;
+        // followed by zero terminated name & code bytes
+    };
+
+    struct JitCodeMove
+    {
+        uint32_t pid;
+        uint32_t tid;
+        uint64_t vma;
+        uint64_t oldCodeAddress;
+        uint64_t newCodeAddress;
+        uint64_t codeSize;
+        uint64_t codeIndex;
+    };
+#pragma pack(pop)
+
+    // code larger than 4GB is not real
+    bool AddSymbol(QVector<JitSymbol>& symbols, uint64_t address, uint64_t size, const QString& name)
+    {
+        if (address == 0 || size == 0 || size > 0xFFFFFFFF)
+        {
+            return false;
+        }
+
+        JitSymbol symbol;
+        symbol.address = address;
+        symbol.size = static_cast<uint32_t>(size);
+        symbol.name = name;
+        symbols.append(symbol);
+        return true;
+    }
+}
+
+JitSymbolReader::JitSymbolReader(const QString& folder, DWORD processId)
+{
+    mMap.file.setFileName(QDir(folder).filePath(QString("perf-%1.map").arg(processId)));
+    mDump.file.setFileName(QDir(folder).filePath(QString("jit-%1.dump").arg(processId)));
+}
+
+QVector<JitSymbol> JitSymbolReader::poll()
+{
+    QVector<JitSymbol> symbols;
+    if (readAppended(mMap))
+    {
+        parseMap(symbols);
+    }
+    if (readAppended(mDump))
+    {
+        parseDump(symbols);
+    }
+    return symbols;
+}
+
+bool JitSymbolReader::readAppended(Source& source)
+{
+    if (source.invalid)
+    {
+        return false;
+    }
+
+    if (!source.file.isOpen())
+    {
+        // runtime creates file only when it generates first code
+        if (!source.file.exists() || !source.file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        {
+            return false;
+        }
+    }
+
+    qint64 size = source.file.size();
+    if (size < source.offset)
+    {
+        // file was recreated, start from beginning
+        source.offset = 0;
+        source.pending.clear();
+        if (&source == &mDump)
+        {
+            mDumpHeader = false;
+            mDumpNames.clear();
+        }
+    }
+    if (size == source.offset || !source.file.seek(source.offset))
+    {
+        return false;
+    }
+
+    QByteArray data = source.file.read(size - source.offset);
+    source.offset += data.size();
+    source.pending += data;
+    return !data.isEmpty();
+}
+
+void JitSymbolReader::parseMap(QVector<JitSymbol>& symbols)
+{
+    QByteArray& data = mMap.pending;
+
+    int start = 0;
+    for (;;)
+    {
+        int end = data.indexOf('\n', start);
+        if (end < 0)
+        {
+            break;
+        }
+
+        QByteArray line = data.mid(start, end - start).trimmed();
+        start = end + 1;
+
+        int first = line.indexOf(' ');
+        int second = first < 0 ? -1 : line.indexOf(' ', first + 1);
+        if (second < 0)
+        {
+            continue;
+        }
+
+        bool okAddress;
+        bool okSize;
+        uint64_t address = line.left(first).toULongLong(&okAddress, 16);
+        uint64_t size = line.mid(first + 1, second - first - 1).toULongLong(&okSize, 16);
+        if (okAddress && okSize)
+        {
+            AddSymbol(symbols, address, size, QString::fromUtf8(line.mid(second + 1)));
+        }
+    }
+
+    data.remove(0, start);
+}
+
+void JitSymbolReader::parseDump(QVector<JitSymbol>& symbols)
+{
+    QByteArray& data = mDump.pending;
+    int offset = 0;
+
+    if (!mDumpHeader)
+    {
+        if (data.size() < int(sizeof(JitDumpHeader)))
+        {
+            return;
+        }
+
+        const JitDumpHeader* header = reinterpret_cast<const JitDumpHeader*>(data.constData());
+        if (header->magic != JITDUMP_MAGIC || header->totalSize < sizeof(JitDumpHeader))
+        {
+            // not jitdump file, nothing will be read from it anymore
+            mDump.file.close();
+            mDump.invalid = true;
+            data.clear();
+            return;
+        }
+        if (data.size() < int(header->totalSize))
+        {
+            return;
+        }
+
+        offset = static_cast<int>(header->totalSize);
+        mDumpHeader = true;
+    }
+
+    while (data.size() - offset >= int(sizeof(JitRecordHeader)))
+    {
+        const JitRecordHeader* record = reinterpret_cast<const JitRecordHeader*>(data.constData() + offset);
+        if (record->totalSize < sizeof(JitRecordHeader))
+        {
+            // broken record, rest of file cannot be parsed
+            mDump.file.close();
+            mDump.invalid = true;
+            data.clear();
+            return;
+        }
+        if (uint32_t(data.size() - offset) < record->totalSize)
+        {
+            break;
+        }
+
+        const char* body = data.constData() + offset + sizeof(JitRecordHeader);
+        uint32_t bodySize = record->totalSize - static_cast<uint32_t>(sizeof(JitRecordHeader));
+
+        if (record->id == JIT_CODE_LOAD && bodySize > sizeof(JitCodeLoad))
+        {
+            const JitCodeLoad* load = reinterpret_cast<const JitCodeLoad*>(body);
+            const char* name = body + sizeof(JitCodeLoad);
+            QString nameString = QString::fromUtf8(name, static_cast<int>(qstrnlen(name, bodySize - static_cast<uint32_t>(sizeof(JitCodeLoad)))));
+
+            if (AddSymbol(symbols, load->codeAddress, load->codeSize, nameString))
+            {
+                mDumpNames.insert(load->codeIndex, nameString);
+            }
+        }
+        else if (record->id == JIT_CODE_MOVE && bodySize >= sizeof(JitCodeMove))
+        {
+            const JitCodeMove* move = reinterpret_cast<const JitCodeMove*>(body);
+            auto it = mDumpNames.constFind(move->codeIndex);
+            if (it != mDumpNames.constEnd())
+            {
+                AddSymbol(symbols, move->newCodeAddress, move->codeSize, it.value());
+            }
+        }
+
+        offset += static_cast<int>(record->totalSize);
+    }
+
+    data.remove(0, offset);
+}
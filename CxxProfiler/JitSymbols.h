@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Precompiled.h"
+
+struct JitSymbol
+{
+    uint64_t address;
+    uint32_t size;
+    QString name;
+};
+
+// Reads symbols of JIT generated code from files that runtime writes while it runs:
+// perf map (perf-<pid>.map, text lines "START SIZE name" with hex numbers) and
+// jitdump (jit-<pid>.dump, binary records). Files are read incrementally, each poll
+// parses only data appended since previous one, incomplete line or record at the
+// end waits for next poll.
+class JitSymbolReader
+{
+    Q_DISABLE_COPY(JitSymbolReader)
+
+public:
+    JitSymbolReader(const QString& folder, DWORD processId);
+
+    // symbols that appeared since last call
+    QVector<JitSymbol> poll();
+
+private:
+    struct Source
+    {
+        QFile file;
+        qint64 offset = 0;
+        QByteArray pending;
+        bool invalid = false;
+    };
+
+    Source mMap;
+    Source mDump;
+    bool mDumpHeader = false;
+    QHash<uint64_t, QString> mDumpNames; // by code index, for moved code
+
+    bool readAppended(Source& source);
+    void parseMap(QVector<JitSymbol>& symbols);
+    void parseDump(QVector<JitSymbol>& symbols);
+};
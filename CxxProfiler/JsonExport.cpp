@@ -0,0 +1,349 @@
+#include "Export.h"
+
+namespace
+{
+    const int JSON_CHUNK_SIZE = 1 << 20;
+    const uint64_t DEFAULT_SAMPLING_INTERVAL = 1000;
+
+    // JSON is written to buffer that goes to file in blocks, no document is built in memory
+    class JsonOutput
+    {
+    public:
+        explicit JsonOutput(QFile* file)
+            : mFile(file)
+            , mValid(true)
+        {
+        }
+
+        QByteArray& buffer()
+        {
+            return mBuffer;
+        }
+
+        bool flush(bool last)
+        {
+            if (mBuffer.size() >= JSON_CHUNK_SIZE || last)
+            {
+                mValid = mValid && mFile->write(mBuffer) == mBuffer.size();
+                mBuffer.clear();
+            }
+            return mValid;
+        }
+
+    private:
+        QFile* mFile;
+        QByteArray mBuffer;
+        bool mValid;
+    };
+
+    uint64_t SamplingInterval(const ProfileData& profile)
+    {
+        return profile.samplingInterval != 0 ? profile.samplingInterval : DEFAULT_SAMPLING_INTERVAL;
+    }
+
+    // calls function with range of entries of each sample, from leaf to root
+    template <typename Function>
+    void ForEachSample(const ThreadCallStack& callStack, Function function)
+    {
+        int first = 0;
+        for (int i = 0; i < callStack.count(); i++)
+        {
+            if (callStack[i].symbol == 0)
+            {
+                function(first, i);
+                first = i + 1;
+            }
+        }
+    }
+
+    // recorded time of each sample followed by end time of last sample, times are calculated from
+    // sampling interval & count of samples of each stack for older & imported profiles
+    QVector<uint64_t> SampleTimes(const ProfileData& profile, int thread)
+    {
+        const ThreadCallStack& callStack = profile.callStacks[thread];
+        const QVector<uint64_t> recorded = profile.sampleTimes.value(thread);
+        uint64_t interval = SamplingInterval(profile);
+
+        QVector<uint64_t> times;
+        uint64_t next = 0;
+        ForEachSample(callStack, [&](int, int last)
+        {
+            times.append(times.count() < recorded.count() ? recorded[times.count()] : next);
+            next = times.last() + SampleWeight(callStack[last]) * interval;
+        });
+        times.append(next);
+        return times;
+    }
+}
+
+void AppendJsonString(QByteArray& out, const QString& string)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.append('"');
+    for (char c : string.toUtf8())
+    {
+        switch (c)
+        {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            if (static_cast<uchar>(c) < 0x20)
+            {
+                out.append("\\u00");
+                out.append(hex[c >> 4]);
+                out.append(hex[c & 0xf]);
+            }
+            else
+            {
+                out.append(c);
+            }
+            break;
+        }
+    }
+    out.append('"');
+}
+
+bool ExportSpeedscope(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    const SymbolTable& symbols = profile.symbols;
+
+    // frames are shared by all threads and written at the end, in order they were first used
+    QVector<int> frameIndex(symbols.count(), -1);
+    QVector<uint32_t> frames;
+
+    JsonOutput json(&file);
+    QByteArray& out = json.buffer();
+
+    out.append("{\"$schema\":\"https://www.speedscope.app/file-format-schema.json\",\"exporter\":");
+    AppendJsonString(out, qApp->applicationName());
+    out.append(",\"name\":");
+    AppendJsonString(out, QFileInfo(fileName).completeBaseName());
+    out.append(",\"activeProfileIndex\":0,\"profiles\":[");
+
+    bool firstProfile = true;
+    for (int thread = 0; thread < profile.callStacks.count(); thread++)
+    {
+        const ThreadCallStack& callStack = profile.callStacks[thread];
+        QVector<uint64_t> times = SampleTimes(profile, thread);
+        int count = times.count() - 1;
+        if (count == 0)
+        {
+            continue;
+        }
+
+        if (!firstProfile)
+        {
+            out.append(',');
+        }
+        firstProfile = false;
+
+        out.append("{\"type\":\"sampled\",\"name\":");
+        AppendJsonString(out, GetThreadName(thread));
+        out.append(",\"unit\":\"microseconds\",\"startValue\":");
+        out.append(QByteArray::number(times.first()));
+        out.append(",\"endValue\":");
+        out.append(QByteArray::number(times.last()));
+
+        // stacks go from root to leaf
+        out.append(",\"samples\":[");
+        int sample = 0;
+        ForEachSample(callStack, [&](int first, int last)
+        {
+            out.append(sample++ == 0 ? "[" : ",[");
+            for (int k = last - 1; k >= first; k--)
+            {
+                uint32_t symbol = callStack[k].symbol;
+                if (frameIndex[symbol] < 0)
+                {
+                    frameIndex[symbol] = frames.count();
+                    frames.append(symbol);
+                }
+                if (k != last - 1)
+                {
+                    out.append(',');
+                }
+                out.append(QByteArray::number(frameIndex[symbol]));
+            }
+            out.append(']');
+            json.flush(false);
+        });
+
+        // weight of sample is time until next sample
+        out.append("],\"weights\":[");
+        for (int i = 0; i < count; i++)
+        {
+            if (i != 0)
+            {
+                out.append(',');
+            }
+            out.append(QByteArray::number(times[i + 1] - times[i]));
+            json.flush(false);
+        }
+        out.append("]}");
+    }
+
+    out.append("],\"shared\":{\"frames\":[");
+    for (int i = 0; i < frames.count(); i++)
+    {
+        uint32_t symbol = frames[i];
+        if (i != 0)
+        {
+            out.append(',');
+        }
+        out.append("{\"name\":");
+        AppendJsonString(out, symbols.getDisplayName(symbol));
+        if (symbols[symbol].file != 0)
+        {
+            out.append(",\"file\":");
+            AppendJsonString(out, symbols.getFile(symbol));
+            out.append(",\"line\":");
+            out.append(QByteArray::number(symbols[symbol].line));
+        }
+        out.append('}');
+        json.flush(false);
+    }
+    out.append("]}}");
+
+    if (!json.flush(true))
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ExportChromeTrace(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    const SymbolTable& symbols = profile.symbols;
+    uint64_t interval = SamplingInterval(profile);
+
+    // escaped name & category of each symbol, as they are repeated in many events
+    QVector<QByteArray> eventNames(symbols.count());
+
+    JsonOutput json(&file);
+    QByteArray& out = json.buffer();
+
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool firstEvent = true;
+    auto beginEvent = [&](const char* phase, int thread, uint64_t time)
+    {
+        out.append(firstEvent ? "\n{\"ph\":\"" : ",\n{\"ph\":\"");
+        firstEvent = false;
+        out.append(phase);
+        out.append("\",\"pid\":1,\"tid\":");
+        out.append(QByteArray::number(thread));
+        out.append(",\"ts\":");
+        out.append(QByteArray::number(time));
+    };
+
+    for (int thread = 0; thread < profile.callStacks.count(); thread++)
+    {
+        const ThreadCallStack& callStack = profile.callStacks[thread];
+        QVector<uint64_t> times = SampleTimes(profile, thread);
+
+        beginEvent("M", thread, 0);
+        out.append(",\"name\":\"thread_name\",\"args\":{\"name\":");
+        AppendJsonString(out, GetThreadName(thread));
+        out.append("}}");
+
+        // samples become begin & end events of frames that changed since previous sample,
+        // open frames are closed when thread was not sampled for a while
+        QVector<uint32_t> open;
+        QVector<uint32_t> stack;
+        uint64_t lastEnd = 0;
+
+        auto closeFrames = [&](int depth, uint64_t time)
+        {
+            while (open.count() > depth)
+            {
+                beginEvent("E", thread, time);
+                out.append('}');
+                open.pop_back();
+            }
+        };
+
+        int sample = 0;
+        ForEachSample(callStack, [&](int first, int last)
+        {
+            uint64_t time = times[sample];
+            if (!open.isEmpty() && time > lastEnd + interval)
+            {
+                closeFrames(0, lastEnd);
+            }
+            lastEnd = times[++sample];
+
+            stack.clear();
+            for (int k = last - 1; k >= first; k--)
+            {
+                stack.append(callStack[k].symbol);
+            }
+
+            int common = 0;
+            while (common < open.count() && common < stack.count() && open[common] == stack[common])
+            {
+                common++;
+            }
+            closeFrames(common, time);
+
+            for (int k = common; k < stack.count(); k++)
+            {
+                uint32_t symbol = stack[k];
+                QByteArray& name = eventNames[symbol];
+                if (name.isEmpty())
+                {
+                    name.append(",\"name\":");
+                    AppendJsonString(name, symbols.getDisplayName(symbol));
+                    name.append(",\"cat\":");
+                    AppendJsonString(name, symbols.getModule(symbol));
+                }
+
+                beginEvent("B", thread, time);
+                out.append(name);
+                out.append('}');
+                open.append(symbol);
+            }
+
+            json.flush(false);
+        });
+
+        closeFrames(0, lastEnd);
+    }
+
+    out.append("\n]}");
+
+    if (!json.flush(true))
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+#include "LineTable.h"
+
+namespace
+{
+    template <typename T>
+    void packLines(QByteArray& data, const CachedLines& lines, uint32_t rva, uint32_t baseLine)
+    {
+        int count = lines.count();
+        data.resize(static_cast<int>(2 * count * sizeof(T)));
+
+        T* offsets = reinterpret_cast<T*>(data.data());
+        T* deltas = offsets + count;
+        for (int i = 0; i < count; i++)
+        {
+            offsets[i] = static_cast<T>(lines[i].rva - rva);
+            deltas[i] = static_cast<T>(lines[i].line - baseLine);
+        }
+    }
+
+    template <typename T>
+    uint32_t findLine(const QByteArray& data, int count, uint32_t baseLine, uint32_t offset)
+    {
+        const T* offsets = reinterpret_cast<const T*>(data.constData());
+        const T* deltas = offsets + count;
+
+        const T* it = std::upper_bound(offsets, offsets + count, offset, [](uint32_t value, T element)
+        {
+            return value < element;
+        });
+        if (it == offsets)
+        {
+            return ~(uint32_t)0;
+        }
+
+        return baseLine + deltas[it - offsets - 1];
+    }
+}
+
+LineTable::LineTable()
+    : mBaseLine(0)
+    , mCount(0)
+    , mWide(false)
+{
+}
+
+LineTable::LineTable(const CachedLines& lines, uint32_t rva)
+    : mBaseLine(~(uint32_t)0)
+    , mCount(0)
+    , mWide(false)
+{
+    CachedLines valid;
+    valid.reserve(lines.count());
+
+    uint32_t maxOffset = 0;
+    uint32_t maxLine = 0;
+    for (const CachedLine& line : lines)
+    {
+        if (line.rva >= rva)
+        {
+            valid.append(line);
+            mBaseLine = qMin(mBaseLine, line.line);
+            maxLine = qMax(maxLine, line.line);
+            maxOffset = qMax(maxOffset, line.rva - rva);
+        }
+    }
+
+    if (valid.isEmpty())
+    {
+        mBaseLine = 0;
+        return;
+    }
+
+    mCount = valid.count();
+    mWide = maxOffset > 0xFFFF || maxLine - mBaseLine > 0xFFFF;
+
+    if (mWide)
+    {
+        packLines<uint32_t>(mData, valid, rva, mBaseLine);
+    }
+    else
+    {
+        packLines<uint16_t>(mData, valid, rva, mBaseLine);
+    }
+}
+
+bool LineTable::isEmpty() const
+{
+    return mCount == 0;
+}
+
+uint32_t LineTable::find(uint32_t offset) const
+{
+    if (mWide)
+    {
+        return findLine<uint32_t>(mData, mCount, mBaseLine, offset);
+    }
+    else
+    {
+        return findLine<uint16_t>(mData, mCount, mBaseLine, offset);
+    }
+}
+
+CachedLines CollectLines(HANDLE process, uint64_t address, uint32_t size, uint64_t base, QString* file)
+{
+    CachedLines lines;
+
+    IMAGEHLP_LINEW64 line;
+    line.SizeOfStruct = sizeof(line);
+    DWORD offset;
+    if (SymGetLineFromAddrW64(process, address, &offset, &line))
+    {
+        *file = QString::fromWCharArray(line.FileName);
+        do
+        {
+            if (!lines.isEmpty() && (line.Address >= address + size || line.Address < address))
+            {
+                break;
+            }
+
+            CachedLine entry;
+            entry.rva = static_cast<uint32_t>(qMax<uint64_t>(line.Address, address) - base);
+            entry.line = line.LineNumber;
+            lines.append(entry);
+        } while (SymGetLineNextW64(process, &line));
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const CachedLine& a, const CachedLine& b)
+    {
+        return a.rva < b.rva;
+    });
+
+    return lines;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "SymbolCache.h"
+
+// Address to line mapping for single function. Addresses are stored as offsets
+// from function start and lines as deltas from smallest line, both in 16 bits
+// when they fit (almost always), otherwise in 32 bits. Lookup is binary search.
+class LineTable
+{
+public:
+    LineTable();
+    LineTable(const CachedLines& lines, uint32_t rva);
+
+    bool isEmpty() const;
+    uint32_t find(uint32_t offset) const;
+
+private:
+    uint32_t mBaseLine;
+    int mCount;
+    bool mWide;
+    QByteArray mData;
+};
+
+// collects whole line table of function from dbghelp, rva of lines are relative to base
+CachedLines CollectLines(HANDLE process, uint64_t address, uint32_t size, uint64_t base, QString* file);
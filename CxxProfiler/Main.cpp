@@ -1,4 +1,9 @@
 #include "MainWindow.h"
+#include "Export.h"
+#include "Import.h"
+#include "ProfileFile.h"
+#include "ProfileMerge.h"
+#include "Resymbolizer.h"
 #include "Version.h"
 
 namespace
@@ -20,6 +25,118 @@ namespace
             CloseHandle(token);
         }
     }
+
+    // GUI application has no console, output goes to console of parent process if there is one
+    void PrintLine(const QString& text)
+    {
+        static bool attached = AttachConsole(ATTACH_PARENT_PROCESS) != FALSE;
+        if (attached)
+        {
+            QString line = text + "\n";
+            DWORD written;
+            WriteConsoleW(GetStdHandle(STD_ERROR_HANDLE), line.utf16(), line.length(), &written, nullptr);
+        }
+    }
+
+    // -resymbolize input.profiler symbols [output.profiler]
+    int Resymbolize(const QStringList& args)
+    {
+        if (args.count() < 4)
+        {
+            PrintLine("Usage: CxxProfiler -resymbolize input.profiler symbol-folder-or-url [output.profiler]");
+            return 1;
+        }
+
+        uint32_t pointerSize;
+        ProfileData profile;
+        QString error;
+        ResymbolizeResult result;
+        if (!LoadProfileFile(args.at(2), &pointerSize, &profile, &error)
+          || !ResymbolizeProfile(&profile, args.at(3), &result, &error)
+          || !WriteProfileFile(args.count() > 4 ? args.at(4) : args.at(2), pointerSize, profile, &error))
+        {
+            PrintLine(error);
+            return 1;
+        }
+
+        PrintLine(QString("Resolved %1 of %2 unresolved frames").arg(result.resolved).arg(result.frames));
+        return 0;
+    }
+
+    // -export input.profiler output, format is chosen by extension of output
+    int Export(const QStringList& args)
+    {
+        if (args.count() < 4)
+        {
+            PrintLine("Usage: CxxProfiler -export input.profiler output");
+            PrintLine("Formats: " + GetExportFilter().replace(";;", ", "));
+            return 1;
+        }
+
+        ProfileFile file;
+        ProfileData profile;
+        QString error;
+        if (!file.open(args.at(2), &error))
+        {
+            PrintLine(error);
+            return 1;
+        }
+        if (!file.read(&profile))
+        {
+            PrintLine("Failed to load data");
+            return 1;
+        }
+        if (!ExportProfile(args.at(3), profile, &error))
+        {
+            PrintLine(error);
+            return 1;
+        }
+        return 0;
+    }
+
+    // -import input output.profiler, format is chosen by extension of input
+    int Import(const QStringList& args)
+    {
+        if (args.count() < 4)
+        {
+            PrintLine("Usage: CxxProfiler -import input output.profiler");
+            PrintLine("Formats: " + GetImportFilter().replace(";;", ", "));
+            return 1;
+        }
+
+        ProfileData profile;
+        QString error;
+        if (!ImportProfile(args.at(2), &profile, &error)
+          || !WriteProfileFile(args.at(3), sizeof(uint64_t), profile, &error))
+        {
+            PrintLine(error);
+            return 1;
+        }
+        return 0;
+    }
+
+    // -merge output.profiler input.profiler...
+    int Merge(const QStringList& args)
+    {
+        if (args.count() < 4)
+        {
+            PrintLine("Usage: CxxProfiler -merge output.profiler input.profiler...");
+            return 1;
+        }
+
+        uint32_t pointerSize;
+        ProfileData profile;
+        QString error;
+        if (!MergeProfileFiles(args.mid(3), &pointerSize, &profile, &error)
+          || !WriteProfileFile(args.at(2), pointerSize, profile, &error))
+        {
+            PrintLine(error);
+            return 1;
+        }
+
+        PrintLine(QString("Merged %1 files, %2 symbols").arg(args.count() - 3).arg(profile.symbols.count() - 1));
+        return 0;
+    }
 }
 
 int main(int argc, char* argv[])
@@ -29,6 +146,24 @@ int main(int argc, char* argv[])
     app.setWindowIcon(QIcon(":/CxxProfiler/Icon.png"));
     app.setApplicationVersion("2");
 
+    QStringList args = app.arguments();
+    if (args.count() > 1 && args.at(1) == "-resymbolize")
+    {
+        return Resymbolize(args);
+    }
+    if (args.count() > 1 && args.at(1) == "-export")
+    {
+        return Export(args);
+    }
+    if (args.count() > 1 && args.at(1) == "-import")
+    {
+        return Import(args);
+    }
+    if (args.count() > 1 && args.at(1) == "-merge")
+    {
+        return Merge(args);
+    }
+
     EnableDebugPrivileges();
 
     MainWindow window;
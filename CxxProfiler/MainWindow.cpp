@@ -1,12 +1,16 @@
 #include "MainWindow.h"
 #include "NewDialog.h"
+#include "Export.h"
+#include "Import.h"
 #include "Preferences.h"
 #include "RunningDialog.h"
 #include "Profiler.h"
+#include "ProfileFile.h"
+#include "ProfileMerge.h"
+#include "Resymbolizer.h"
 #include "SymbolWidget.h"
 #include "Symbols.h"
 #include "Utils.h"
-#include "Version.h"
 
 MainWindow::MainWindow()
 {
@@ -25,8 +29,8 @@ MainWindow::MainWindow()
     }
 
     ui.actFileSave->setDisabled(true);
-
-    setStatusBar(nullptr);
+    ui.actFileResymbolize->setDisabled(true);
+    ui.actFileExport->setDisabled(true);
 
     QMenu* contextMenu = new QMenu(this);
     {
@@ -224,30 +228,9 @@ MainWindow::MainWindow()
 
     QObject::connect(ui.actFileNew, &QAction::triggered, this, [this]()
     {
-        if (!mDataSaved)
+        if (!confirmDiscard())
         {
-            QMessageBox::StandardButton ret = QMessageBox::question(
-                this,
-                qApp->applicationName(),
-                "Profiling information has not been saved.\n"
-                "Do you want to save?",
-                QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
-
-            if (ret == QMessageBox::Save)
-            {
-                if (!saveData())
-                {
-                    return;
-                }
-            }
-            else if (ret == QMessageBox::Cancel)
-            {
-                return;
-            }
-            else // ret == QMessageBox::Discard
-            {
-                // pass
-            }
+            return;
         }
 
         NewDialog newDialog(this);
@@ -273,38 +256,16 @@ MainWindow::MainWindow()
 
         if (runningDialog.exec() == QDialog::Accepted)
         {
-            QByteArray data = profiler.serializeCallStacks();
-            loadData(profiler.getSizeOfPointer(), data);
+            loadData(profiler.getSizeOfPointer(), profiler.getProfile());
             mDataSaved = false;
         }
     });
 
     QObject::connect(ui.actFileOpen, &QAction::triggered, this, [this]()
     {
-        if (!mDataSaved)
+        if (!confirmDiscard())
         {
-            QMessageBox::StandardButton ret = QMessageBox::question(
-                this,
-                qApp->applicationName(),
-                "Profiling information has not been saved.\n"
-                "Do you want to save?",
-                QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
-
-            if (ret == QMessageBox::Save)
-            {
-                if (!saveData())
-                {
-                    return;
-                }
-            }
-            else if (ret == QMessageBox::Cancel)
-            {
-                return;
-            }
-            else // ret == QMessageBox::Discard
-            {
-                // pass
-            }
+            return;
         }
 
         QSettings settings(GetSettingsFile(), QSettings::IniFormat);
@@ -318,48 +279,217 @@ MainWindow::MainWindow()
                 settings.setValue("last", QFileInfo(fname).path());
             }
 
-            QFile file(fname);
-            if (!file.open(QIODevice::ReadOnly))
+            QString error;
+            if (!loadFile(fname, &error))
             {
-                QMessageBox::critical(this, qApp->applicationName(), file.errorString());
+                QMessageBox::critical(this, qApp->applicationName(), error);
                 return;
             }
 
-            char id[4];
-            uint32_t version;
-            uint32_t pointerSize;
+            mDataSaved = true;
+        }
+    });
 
-            QDataStream in(&file);
-            if (in.readRawData(id, 4) != 4 || memcmp(id, CXX_PROFILER_FILE_ID, 4) != 0)
-            {
-                QMessageBox::critical(this, qApp->applicationName(), "Invalid file header");
-                return;
-            }
+    QObject::connect(ui.actFileImport, &QAction::triggered, this, [this]()
+    {
+        if (!confirmDiscard())
+        {
+            return;
+        }
 
-            in >> version;
-            if (in.status() != QDataStream::Ok || version != CXX_PROFILER_FILE_VERSION)
-            {
-                QMessageBox::critical(this, qApp->applicationName(), "Unsupported file version");
-                return;
-            }
+        QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+        QString lastFolder = settings.value("last", QString()).toString();
 
-            in >> pointerSize;
-            if (in.status() != QDataStream::Ok)
-            {
-                QMessageBox::critical(this, qApp->applicationName(), "Failed to load data");
-                return;
-            }
+        QString fname = QFileDialog::getOpenFileName(this, qApp->applicationName(), lastFolder, GetImportFilter());
+        if (fname.isNull())
+        {
+            return;
+        }
 
-            QByteArray data;
-            in >> data;
-            if (in.status() != QDataStream::Ok)
-            {
-                QMessageBox::critical(this, "Profiler Error", qApp->applicationName());
-                return;
-            }
+        if (settings.isWritable())
+        {
+            settings.setValue("last", QFileInfo(fname).path());
+        }
 
-            loadData(pointerSize, qUncompress(data));
-            mDataSaved = true;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        ProfileData profile;
+        QString error;
+        bool success = ImportProfile(fname, &profile, &error);
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            QMessageBox::critical(this, qApp->applicationName(), error);
+            return;
+        }
+
+        // imported symbols usually have no source files, they would be all hidden otherwise
+        bool hasFiles = false;
+        for (int id = 1; id < profile.symbols.count() && !hasFiles; id++)
+        {
+            hasFiles = profile.symbols[id].file != 0;
+        }
+        if (!hasFiles && !mShowWithEmptyFiles)
+        {
+            mCallGraph->setShowWithEmptyFiles(true);
+            mFlatProfile->setShowWithEmptyFiles(true);
+            mShowWithEmptyFiles = true;
+        }
+
+        loadData(sizeof(uint64_t), profile);
+        mDataSaved = false;
+    });
+
+    QObject::connect(ui.actFileMerge, &QAction::triggered, this, [this]()
+    {
+        if (!confirmDiscard())
+        {
+            return;
+        }
+
+        QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+        QString lastFolder = settings.value("last", QString()).toString();
+
+        QStringList fnames = QFileDialog::getOpenFileNames(this, qApp->applicationName(), lastFolder, "CxxProfiler Data (*.profiler)");
+        if (fnames.isEmpty())
+        {
+            return;
+        }
+
+        if (settings.isWritable())
+        {
+            settings.setValue("last", QFileInfo(fnames.first()).path());
+        }
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        uint32_t pointerSize;
+        ProfileData profile;
+        QString error;
+        bool success = MergeProfileFiles(fnames, &pointerSize, &profile, &error);
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            QMessageBox::critical(this, qApp->applicationName(), error);
+            return;
+        }
+
+        loadData(pointerSize, profile);
+        mDataSaved = false;
+    });
+
+    QObject::connect(ui.actFileOpenRuns, &QAction::triggered, this, [this]()
+    {
+        if (!confirmDiscard())
+        {
+            return;
+        }
+
+        QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+        QString lastFolder = settings.value("last", QString()).toString();
+
+        QStringList fnames = QFileDialog::getOpenFileNames(this, qApp->applicationName(), lastFolder, "CxxProfiler Data (*.profiler)");
+        if (fnames.isEmpty())
+        {
+            return;
+        }
+        if (fnames.count() < 2)
+        {
+            QMessageBox::warning(this, qApp->applicationName(), "Statistics need at least two runs of same workload.");
+            return;
+        }
+
+        if (settings.isWritable())
+        {
+            settings.setValue("last", QFileInfo(fnames.first()).path());
+        }
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        uint32_t pointerSize;
+        ProfileData profile;
+        QVector<CallStack> runs;
+        QString error;
+        bool success = LoadProfileRuns(fnames, &pointerSize, &profile, &runs, &error);
+        if (success)
+        {
+            loadData(pointerSize, profile, runs);
+            mDataSaved = false;
+        }
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            QMessageBox::critical(this, qApp->applicationName(), error);
+        }
+    });
+
+    QObject::connect(ui.actFileResymbolize, &QAction::triggered, this, [this]()
+    {
+        bool ok;
+        QString store = QInputDialog::getText(this, qApp->applicationName(), "Symbol folder or URL:", QLineEdit::Normal, GetSymbolStore(), &ok).trimmed();
+        if (!ok || store.isEmpty())
+        {
+            return;
+        }
+
+        const ProfileData* data = profileData();
+        if (data == nullptr)
+        {
+            return;
+        }
+
+        ProfileData profile = *data;
+        ResymbolizeResult result;
+        QString error;
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        bool success = ResymbolizeProfile(&profile, store, &result, &error);
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            QMessageBox::critical(this, qApp->applicationName(), error);
+            return;
+        }
+
+        if (result.resolved != 0)
+        {
+            loadData(mDataPointerSize, profile);
+            mDataSaved = false;
+        }
+        QMessageBox::information(this, qApp->applicationName(), QString("Resolved %1 of %2 unresolved frames").arg(result.resolved).arg(result.frames));
+    });
+
+    QObject::connect(ui.actFileExport, &QAction::triggered, this, [this]()
+    {
+        QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+        QString lastFolder = settings.value("last", QString()).toString();
+
+        QString fname = QFileDialog::getSaveFileName(this, qApp->applicationName(), lastFolder, GetExportFilter());
+        if (fname.isNull())
+        {
+            return;
+        }
+
+        if (settings.isWritable())
+        {
+            settings.setValue("last", QFileInfo(fname).path());
+        }
+
+        const ProfileData* data = profileData();
+        if (data == nullptr)
+        {
+            return;
+        }
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        QString error;
+        bool success = ExportProfile(fname, *data, &error);
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            QMessageBox::critical(this, qApp->applicationName(), error);
         }
     });
 
@@ -395,7 +525,22 @@ void MainWindow::toggleShowWithEmptyFiles(bool show)
     flatProfile->setShowWithEmptyFiles(show);
 
     mShowWithEmptyFiles = show;
-    loadData(mDataPointerSize, mData);
+    if (mDataFile)
+    {
+        ProfileData profile;
+        ProfileAggregates aggregates;
+        SampleStats stats;
+        if (mDataFile->readAggregates(show, &profile, &aggregates, &stats))
+        {
+            showProfile(SymbolTablePtr(new SymbolTable(profile.symbols)), aggregates, stats);
+            return;
+        }
+    }
+    const ProfileData* data = profileData();
+    if (data != nullptr)
+    {
+        loadData(mDataPointerSize, *data, mRuns);
+    }
 }
 
 void MainWindow::popupAction(QAction* action)
@@ -472,19 +617,97 @@ void MainWindow::popupAction(QAction* action)
     }
 }
 
-void MainWindow::loadData(uint32_t pointerSize, const QByteArray& data)
+void MainWindow::loadData(uint32_t pointerSize, const ProfileData& profile, const QVector<CallStack>& runs)
 {
-    mData = data;
+    mProfile = profile;
     mDataPointerSize = pointerSize;
+    mDataFile.reset();
+    mRuns = runs;
+
+    SymbolTablePtr symbols(new SymbolTable());
+    ProfileAggregates aggregates;
+    SampleStats stats;
+
+    aggregates.sampleCount = CreateProfile(profile, mShowWithEmptyFiles, *symbols,
+        aggregates.flatThreads, aggregates.callGraphThreads, aggregates.fileProfile, stats);
 
+    if (!mRuns.isEmpty())
+    {
+        RunStatistics runStats = ComputeRunStatistics(*symbols, mRuns, mShowWithEmptyFiles, aggregates);
+        showProfile(symbols, aggregates, stats, &runStats);
+        return;
+    }
+
+    showProfile(symbols, aggregates, stats);
+}
+
+bool MainWindow::loadFile(const QString& fileName, QString* error)
+{
+    QSharedPointer<ProfileFile> file(new ProfileFile());
+    if (!file->open(fileName, error))
+    {
+        return false;
+    }
+
+    // precomputed views are shown right away, without decoding call stacks
+    ProfileData profile;
+    ProfileAggregates aggregates;
+    SampleStats stats;
+    if (file->readAggregates(mShowWithEmptyFiles, &profile, &aggregates, &stats))
+    {
+        mProfile = ProfileData();
+        mDataPointerSize = file->pointerSize();
+        mDataFile = file;
+        mRuns.clear();
+
+        showProfile(SymbolTablePtr(new SymbolTable(profile.symbols)), aggregates, stats);
+        return true;
+    }
+
+    // views may be partially read into profile when they are not stored in file
+    profile = ProfileData();
+    if (!file->read(&profile))
+    {
+        *error = "Failed to load data";
+        return false;
+    }
+
+    loadData(file->pointerSize(), profile);
+    return true;
+}
+
+const ProfileData* MainWindow::profileData()
+{
+    if (mDataFile)
+    {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        mProfile = ProfileData();
+        bool success = mDataFile->read(&mProfile);
+        QApplication::restoreOverrideCursor();
+
+        if (!success)
+        {
+            // file is kept, so views shown from it still work
+            mProfile = ProfileData();
+            QMessageBox::critical(this, qApp->applicationName(), "Failed to load data");
+            return nullptr;
+        }
+
+        // file stays unmapped afterwards, so it can be overwritten
+        mDataFile.reset();
+    }
+    return &mProfile;
+}
+
+void MainWindow::showProfile(const SymbolTablePtr& symbols, const ProfileAggregates& aggregates, const SampleStats& stats, const RunStatistics* runStats)
+{
     QTreeWidget* flatWidget = mFlatProfile->getTree();
     QTreeWidget* callGraphWidget = mCallGraph->getTree();
 
-    FlatThreads flatThreads;
-    CallGraphThreads callGraphThreads;
-    FileProfile fileProfile;
-
-    uint32_t totalCount = CreateProfile(pointerSize, mShowWithEmptyFiles, data, flatThreads, callGraphThreads, fileProfile);
+    const FlatThreads& flatThreads = aggregates.flatThreads;
+    const CallGraphThreads& callGraphThreads = aggregates.callGraphThreads;
+    const FileProfile& fileProfile = aggregates.fileProfile;
+    uint32_t totalCount = aggregates.sampleCount;
 
     flatWidget->setUpdatesEnabled(false);
     flatWidget->clear();
@@ -494,6 +717,9 @@ void MainWindow::loadData(uint32_t pointerSize, const QByteArray& data)
 
     SymbolToTreeItem flatItems;
 
+    int runCount = runStats != nullptr ? runStats->runCount : 0;
+    double threshold = GetVariationThreshold();
+
     for (const FlatThread& flatThread : flatThreads)
     {
         if (flatThread.second.isEmpty())
@@ -502,10 +728,24 @@ void MainWindow::loadData(uint32_t pointerSize, const QByteArray& data)
         }
         QTreeWidgetItem* item = new ThreadItem(flatThread.first);
 
-        for (auto it = flatThread.second.begin(), eit = flatThread.second.end(); it != eit; ++it)
+        QVector<ShareStats> selfStats = runCount != 0 ? runStats->flatSelf.value(flatThread.first) : QVector<ShareStats>();
+        QVector<ShareStats> totalStats = runCount != 0 ? runStats->flatTotal.value(flatThread.first) : QVector<ShareStats>();
+
+        for (int id = 1; id < flatThread.second.count(); id++)
         {
-            QTreeWidgetItem* child = new SymbolItem(it.key(), it.key()->file, it.key()->line, it.value().self, it.value().total, totalCount);
-            flatItems.insert(it.key(), child);
+            const FlatSymbol& flat = flatThread.second[id];
+            if (flat.total == 0)
+            {
+                continue;
+            }
+
+            SymbolItem* child = new SymbolItem(symbols, id, symbols->getFile(id), (*symbols)[id].line, flat.self, flat.total, totalCount);
+            if (id < selfStats.count())
+            {
+                bool noisy = IsNoisyShare(selfStats[id], threshold) || IsNoisyShare(totalStats[id], threshold);
+                child->setShareStats(selfStats[id], totalStats[id], runCount, noisy);
+            }
+            flatItems.insert(id, child);
             item->addChild(child);
         }
 
@@ -514,32 +754,65 @@ void MainWindow::loadData(uint32_t pointerSize, const QByteArray& data)
 
     for (const CallGraphThread& callGraphThread : callGraphThreads)
     {
-        if (callGraphThread.second.childs.isEmpty())
+        if (callGraphThread.second.count() <= 1)
         {
             continue;
         }
         struct Creator
         {
-            Creator(uint32_t totalCount) : mTotalCount(totalCount)
+            Creator(const SymbolTablePtr& symbols, const CallGraph& graph, uint32_t totalCount)
+                : mSymbols(symbols)
+                , mGraph(&graph)
+                , mTotalCount(totalCount)
             {
             }
 
-            void addChilds(QTreeWidgetItem* item, const SymbolPtr& parent, const CallGraphSymbol& node)
+            void addChilds(QTreeWidgetItem* item, uint32_t parent)
             {
-                for (auto it = node.childs.begin(), eit = node.childs.end(); it != eit; ++it)
+                const CallGraphNode& node = (*mGraph)[parent];
+
+                QString file;
+                if (node.symbol != 0)
+                {
+                    file = mSymbols->getFile(node.symbol).isEmpty() ? mSymbols->getModule(node.symbol) : mSymbols->getFile(node.symbol);
+                }
+
+                for (uint32_t index = node.child; index != 0; index = (*mGraph)[index].next)
                 {
-                    QString file = parent ? (parent->file.isEmpty() ? parent->module : parent->file) : QString();
-                    QTreeWidgetItem* child = new SymbolItem(it.key().first, file, it.key().second, it.value().self, it.value().total, mTotalCount);
-                    addChilds(child, it.key().first, it.value());
-                    item->addChild(child);
+                    const CallGraphNode& child = (*mGraph)[index];
+                    SymbolItem* childItem = new SymbolItem(mSymbols, child.symbol, file, child.line, child.self, child.total, mTotalCount);
+                    if (index < static_cast<uint32_t>(mSelfStats.count()))
+                    {
+                        bool noisy = IsNoisyShare(mSelfStats[index], mThreshold) || IsNoisyShare(mTotalStats[index], mThreshold);
+                        childItem->setShareStats(mSelfStats[index], mTotalStats[index], mRunCount, noisy);
+                    }
+                    addChilds(childItem, index);
+                    item->addChild(childItem);
                 }
             }
 
+            SymbolTablePtr mSymbols;
+            const CallGraph* mGraph;
             uint32_t mTotalCount;
+
+            // indexed by node, empty without statistics of runs
+            QVector<ShareStats> mSelfStats;
+            QVector<ShareStats> mTotalStats;
+            int mRunCount = 0;
+            double mThreshold = 0;
         };
 
+        Creator creator(symbols, callGraphThread.second, totalCount);
+        if (runCount != 0)
+        {
+            creator.mSelfStats = runStats->callGraphSelf.value(callGraphThread.first);
+            creator.mTotalStats = runStats->callGraphTotal.value(callGraphThread.first);
+            creator.mRunCount = runCount;
+            creator.mThreshold = threshold;
+        }
+
         QTreeWidgetItem* item = new ThreadItem(callGraphThread.first);
-        Creator(totalCount).addChilds(item, SymbolPtr(), callGraphThread.second);
+        creator.addChilds(item, 0);
         callGraphWidget->addTopLevelItem(item);
     }
 
@@ -553,7 +826,23 @@ void MainWindow::loadData(uint32_t pointerSize, const QByteArray& data)
     callGraphWidget->setUpdatesEnabled(true);
     callGraphWidget->setVisible(true);
 
+    QString status = QString("%1 samples, %2 unresolved, %3 lost")
+        .arg(totalCount)
+        .arg(stats.unresolved)
+        .arg(stats.lost);
+    if (stats.hidden != 0)
+    {
+        status += QString(", %1 without source files (shown with all symbols)").arg(stats.hidden);
+    }
+    if (runCount != 0)
+    {
+        status += QString(", statistics of %1 runs").arg(runCount);
+    }
+    ui.statusbar->showMessage(status);
+
     emit ui.actFileSave->setEnabled(true);
+    ui.actFileResymbolize->setEnabled(true);
+    ui.actFileExport->setEnabled(true);
     setCentralWidget(mTabs);
 }
 
@@ -573,38 +862,32 @@ bool MainWindow::saveData()
         settings.setValue("last", QFileInfo(fname).path());
     }
 
-    bool success = false;
-
-    QFile file(fname);
-    if (file.open(QIODevice::WriteOnly))
+    // failed decode must not replace file with empty profile
+    const ProfileData* data = profileData();
+    if (data == nullptr)
     {
-        QDataStream out(&file);
-        out.writeRawData(CXX_PROFILER_FILE_ID, sizeof(CXX_PROFILER_FILE_ID));
-        out << CXX_PROFILER_FILE_VERSION
-            << mDataPointerSize
-            << qCompress(mData);
-
-        success = out.status() == QDataStream::Ok;
+        return false;
     }
 
+    QString error;
+    bool success = WriteProfileFile(fname, mDataPointerSize, *data, &error);
     if (success)
     {
         mDataSaved = true;
     }
     else
     {
-        QMessageBox::critical(this, qApp->applicationName(), file.errorString());
+        QMessageBox::critical(this, qApp->applicationName(), error);
     }
 
     return success;
 }
 
-void MainWindow::closeEvent(QCloseEvent* ev)
+bool MainWindow::confirmDiscard()
 {
     if (mDataSaved)
     {
-        ev->accept();
-        return;
+        return true;
     }
 
     QMessageBox::StandardButton ret = QMessageBox::question(
@@ -616,20 +899,18 @@ void MainWindow::closeEvent(QCloseEvent* ev)
 
     if (ret == QMessageBox::Save)
     {
-        if (saveData())
-        {
-            ev->accept();
-        }
-        else
-        {
-            ev->ignore();
-        }
+        return saveData();
     }
-    else if (ret == QMessageBox::Discard)
+    return ret == QMessageBox::Discard;
+}
+
+void MainWindow::closeEvent(QCloseEvent* ev)
+{
+    if (confirmDiscard())
     {
         ev->accept();
     }
-    else // ret == QMessageBox::Cancel
+    else
     {
         ev->ignore();
     }
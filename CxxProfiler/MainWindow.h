@@ -2,8 +2,12 @@
 
 #include "Precompiled.h"
 #include "ui_MainWindow.h"
+#include "Symbols.h"
+#include "RunStatistics.h"
+#include "ProfileData.h"
 
 class SymbolWidget;
+class ProfileFile;
 
 class MainWindow : public QMainWindow
 {
@@ -39,11 +43,24 @@ private:
 
     bool mShowWithEmptyFiles = false;
 
-    QByteArray mData;
+    ProfileData mProfile;
     bool mDataSaved = true;
     uint32_t mDataPointerSize;
 
-    void loadData(uint32_t pointerSize, const QByteArray& data);
+    // file opened with precomputed views, profile is decoded from it only when needed
+    QSharedPointer<ProfileFile> mDataFile;
+
+    // call stacks of each run, when statistics of several runs of merged profile are shown
+    QVector<CallStack> mRuns;
+
+    void loadData(uint32_t pointerSize, const ProfileData& profile, const QVector<CallStack>& runs = QVector<CallStack>());
+    bool loadFile(const QString& fileName, QString* error);
+    // decodes profile from opened file on first use, nullptr when that fails
+    const ProfileData* profileData();
+    void showProfile(const SymbolTablePtr& symbols, const ProfileAggregates& aggregates, const SampleStats& stats, const RunStatistics* runStats = nullptr);
+
+    // asks to save unsaved profile, false if user cancelled or saving failed
+    bool confirmDiscard();
 
     void closeEvent(QCloseEvent* ev) override;
 };
@@ -128,6 +128,7 @@ NewDialog::NewDialog(QWidget* parent)
         ui.lineRunNewArguments->setText(settings.value("NewDialog/arguments", QString()).toString());
         ui.chkOptionsCapture->setChecked(settings.value("NewDialog/debugOutput", true).toBool());
         ui.chkDownloadSymbols->setChecked(settings.value("NewDialog/downloadSymbols", true).toBool());
+        ui.chkStoreModules->setChecked(settings.value("NewDialog/storeModules", false).toBool());
         ui.spnOptionsSamplingFreq->setValue(settings.value("NewDialog/samplingFrequency", 5).toInt());
     }
 
@@ -277,6 +278,7 @@ void NewDialog::saveSettings() const
         settings.setValue("NewDialog/arguments", ui.lineRunNewArguments->text());
         settings.setValue("NewDialog/debugOutput", ui.chkOptionsCapture->isChecked());
         settings.setValue("NewDialog/downloadSymbols", ui.chkDownloadSymbols->isChecked());
+        settings.setValue("NewDialog/storeModules", ui.chkStoreModules->isChecked());
         settings.setValue("NewDialog/samplingFrequency", ui.spnOptionsSamplingFreq->value());
     }
 }
@@ -307,6 +309,9 @@ ProfilerOptions NewDialog::getOptions() const
     opt.captureDebugOutputString = ui.chkOptionsCapture->isChecked();
     opt.downloadSymbols = ui.chkDownloadSymbols->isChecked();
     opt.samplingFreqInMs = ui.spnOptionsSamplingFreq->value();
+    opt.symbolStore = GetSymbolStore();
+    opt.jitMapFolder = GetJitMapFolder();
+    opt.storeModules = ui.chkStoreModules->isChecked();
     return opt;
 }
 
@@ -0,0 +1,724 @@
+#include "Import.h"
+#include "ElfSymbolizer.h"
+
+namespace
+{
+    const qint64 PERF_CHUNK_SIZE = 16 << 20;
+
+    // executable mapping from PERF_RECORD_MMAP event, applies to samples after it
+    struct PerfMapping
+    {
+        uint32_t pid;
+        uint64_t start;
+        uint64_t size;
+        uint64_t offset;
+        QByteArray path;
+        int sample; // index of first sample of chunk after mapping
+    };
+
+    // part of file parsed by one thread, symbols & events have ids local to chunk
+    struct PerfChunk
+    {
+        const char* begin;
+        const char* end;
+
+        QVector<QByteArray> dsos;
+        QVector<QPair<uint32_t, QByteArray>> symbols; // (dso, name)
+        QVector<QByteArray> events;
+
+        QVector<PerfMapping> mappings;
+
+        QVector<uint32_t> samplePids; // 0 if not known
+        QVector<uint32_t> sampleTids;
+        QVector<uint32_t> sampleEvents;
+        QVector<int64_t> sampleTimes; // microseconds, -1 if not known
+        QVector<CallStackEntry> frames; // symbol is local id + 1, each sample is terminated by 0
+        QVector<uint64_t> frameAddresses; // for each entry of frames
+    };
+
+    bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* SkipSpaces(const char* p, const char* end)
+    {
+        while (p < end && IsSpace(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    const char* SkipToken(const char* p, const char* end)
+    {
+        while (p < end && !IsSpace(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    bool ParseUnsigned(const char* begin, const char* end, uint64_t* value)
+    {
+        *value = 0;
+        for (const char* p = begin; p < end; p++)
+        {
+            if (*p < '0' || *p > '9')
+            {
+                return false;
+            }
+            *value = *value * 10 + (*p - '0');
+        }
+        return begin < end;
+    }
+
+    bool ParseHex(const char* begin, const char* end, uint64_t* value)
+    {
+        if (end - begin > 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X'))
+        {
+            begin += 2;
+        }
+
+        *value = 0;
+        for (const char* p = begin; p < end; p++)
+        {
+            int digit;
+            if (*p >= '0' && *p <= '9')
+            {
+                digit = *p - '0';
+            }
+            else if (*p >= 'a' && *p <= 'f')
+            {
+                digit = *p - 'a' + 10;
+            }
+            else if (*p >= 'A' && *p <= 'F')
+            {
+                digit = *p - 'A' + 10;
+            }
+            else
+            {
+                return false;
+            }
+            *value = (*value << 4) | digit;
+        }
+        return begin < end;
+    }
+
+    // "[cpu]" as printed between tid & time
+    bool IsCpuToken(const char* begin, const char* end)
+    {
+        uint64_t cpu;
+        return end - begin > 2 && *begin == '[' && end[-1] == ']' && ParseUnsigned(begin + 1, end - 1, &cpu);
+    }
+
+    // "seconds.fraction" to microseconds
+    bool ParseTimestamp(const char* begin, const char* end, uint64_t* value)
+    {
+        const char* dot = std::find(begin, end, '.');
+        uint64_t seconds;
+        if (dot == end || !ParseUnsigned(begin, dot, &seconds))
+        {
+            return false;
+        }
+
+        uint64_t micros = 0;
+        int digits = 0;
+        for (const char* p = dot + 1; p < end; p++)
+        {
+            if (*p < '0' || *p > '9')
+            {
+                return false;
+            }
+            if (digits < 6)
+            {
+                micros = micros * 10 + (*p - '0');
+                digits++;
+            }
+        }
+        for (; digits < 6; digits++)
+        {
+            micros *= 10;
+        }
+
+        *value = seconds * 1000000 + micros;
+        return true;
+    }
+
+    // next line that starts a record, records start with comm in first column
+    const char* NextRecord(const char* p, const char* end)
+    {
+        while (p < end)
+        {
+            const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (newline == nullptr)
+            {
+                return end;
+            }
+
+            p = newline + 1;
+            if (p < end && !IsSpace(*p) && *p != '\n')
+            {
+                return p;
+            }
+        }
+        return end;
+    }
+
+    // parses lines of one chunk, hand written as regular expressions are too slow for multi-GB files
+    class PerfChunkParser
+    {
+    public:
+        explicit PerfChunkParser(PerfChunk* chunk)
+            : mChunk(chunk)
+            , mInSample(false)
+            , mSampleFrames(0)
+            , mInlineBegin(nullptr)
+            , mInlineEnd(nullptr)
+        {
+        }
+
+        void parse()
+        {
+            const char* p = mChunk->begin;
+            const char* end = mChunk->end;
+
+            while (p < end)
+            {
+                const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+                if (lineEnd == nullptr)
+                {
+                    lineEnd = end;
+                }
+
+                const char* lineBegin = SkipSpaces(p, lineEnd);
+                const char* trimmedEnd = lineEnd;
+                while (trimmedEnd > lineBegin && IsSpace(trimmedEnd[-1]))
+                {
+                    trimmedEnd--;
+                }
+
+                if (lineBegin == trimmedEnd)
+                {
+                    finishSample();
+                }
+                else if (lineBegin == p)
+                {
+                    finishSample();
+                    if (*p != '#')
+                    {
+                        mInSample = !parseMapping(lineBegin, trimmedEnd) && parseHeader(lineBegin, trimmedEnd);
+                    }
+                }
+                else if (mInSample)
+                {
+                    parseFrame(lineBegin, trimmedEnd);
+                }
+
+                p = lineEnd + 1;
+            }
+
+            finishSample();
+        }
+
+    private:
+        PerfChunk* mChunk;
+
+        QHash<QByteArray, uint32_t> mDsoIds;
+        QHash<QPair<uint32_t, QByteArray>, uint32_t> mSymbolIds;
+        QHash<QByteArray, uint32_t> mEventIds;
+
+        bool mInSample;
+        int mSampleFrames;
+
+        // sample location on header line, when call stacks were not recorded
+        const char* mInlineBegin;
+        const char* mInlineEnd;
+
+        // lookup keys point into file, map owns its bytes
+        uint32_t id(QHash<QByteArray, uint32_t>& ids, QVector<QByteArray>& values, const char* begin, const char* end)
+        {
+            QByteArray key = QByteArray::fromRawData(begin, static_cast<int>(end - begin));
+
+            auto it = ids.constFind(key);
+            if (it == ids.constEnd())
+            {
+                QByteArray value(begin, static_cast<int>(end - begin));
+                it = ids.insert(value, values.count());
+                values.append(value);
+            }
+            return it.value();
+        }
+
+        uint32_t symbolId(uint32_t dso, const char* begin, const char* end)
+        {
+            QPair<uint32_t, QByteArray> key = qMakePair(dso, QByteArray::fromRawData(begin, static_cast<int>(end - begin)));
+
+            auto it = mSymbolIds.constFind(key);
+            if (it == mSymbolIds.constEnd())
+            {
+                key.second = QByteArray(begin, static_cast<int>(end - begin));
+                it = mSymbolIds.insert(key, mChunk->symbols.count());
+                mChunk->symbols.append(key);
+            }
+            return it.value();
+        }
+
+        // "comm pid/tid [cpu] time: PERF_RECORD_MMAP2 pid/tid: [0xstart(0xsize) @ 0xoffset ...]: r-xp path" from --show-mmap-events,
+        // returns false if line is not mapping event
+        bool parseMapping(const char* p, const char* end)
+        {
+            static const char record[] = "PERF_RECORD_MMAP";
+            const char* found = std::search(p, end, record, record + sizeof(record) - 1);
+            if (found == end)
+            {
+                return false;
+            }
+
+            p = SkipSpaces(SkipToken(found, end), end);
+            const char* token = p;
+            p = SkipToken(p, end);
+
+            uint64_t pid;
+            const char* slash = std::find(token, p, '/');
+            if (slash == p || !ParseUnsigned(token, slash, &pid))
+            {
+                return true;
+            }
+
+            uint64_t start;
+            uint64_t size;
+            const char* open = std::find(p, end, '[');
+            const char* paren = std::find(open, end, '(');
+            const char* close = std::find(paren, end, ')');
+            const char* at = std::find(close, end, '@');
+            if (at == end || !ParseHex(open + 1, paren, &start) || !ParseHex(paren + 1, close, &size))
+            {
+                return true;
+            }
+
+            uint64_t offset;
+            token = SkipSpaces(at + 1, end);
+            p = token;
+            while (p < end && !IsSpace(*p) && *p != ']')
+            {
+                p++;
+            }
+            if (!ParseHex(token, p, &offset))
+            {
+                return true;
+            }
+
+            static const char properties[] = "]:";
+            p = std::search(p, end, properties, properties + sizeof(properties) - 1);
+            if (p == end)
+            {
+                return true;
+            }
+
+            // only code mappings matter, path may contain spaces
+            token = SkipSpaces(p + 2, end);
+            p = SkipToken(token, end);
+            const char* path = SkipSpaces(p, end);
+            if (std::find(token, p, 'x') == p || path == end || *path != '/')
+            {
+                return true;
+            }
+
+            PerfMapping mapping;
+            mapping.pid = static_cast<uint32_t>(pid);
+            mapping.start = start;
+            mapping.size = size;
+            mapping.offset = offset;
+            mapping.path = QByteArray(path, static_cast<int>(end - path));
+            mapping.sample = mChunk->sampleTids.count();
+            mChunk->mappings.append(mapping);
+            return true;
+        }
+
+        // "comm tid [cpu] time: period event: ..." where comm may contain spaces & digits, pid/tid, cpu, time & period are optional,
+        // pid/tid is the token just before cpu or time, or before event when both are missing
+        bool parseHeader(const char* p, const char* end)
+        {
+            p = SkipSpaces(SkipToken(p, end), end);
+
+            const char* tidBegin = nullptr;
+            const char* tidEnd = nullptr;
+            while (p < end)
+            {
+                const char* token = p;
+                const char* tokenEnd = SkipToken(p, end);
+                uint64_t value;
+                if (IsCpuToken(token, tokenEnd) || (tokenEnd > token && tokenEnd[-1] == ':'
+                    && (ParseTimestamp(token, tokenEnd - 1, &value) || !ParseUnsigned(token, tokenEnd - 1, &value))))
+                {
+                    break;
+                }
+                tidBegin = token;
+                tidEnd = tokenEnd;
+                p = SkipSpaces(tokenEnd, end);
+            }
+            if (p == end || tidBegin == nullptr)
+            {
+                return false;
+            }
+
+            uint64_t pid = 0;
+            uint64_t tid = 0;
+            const char* slash = std::find(tidBegin, tidEnd, '/');
+            if (slash == tidEnd ? !ParseUnsigned(tidBegin, tidEnd, &tid) : !ParseUnsigned(tidBegin, slash, &pid) || !ParseUnsigned(slash + 1, tidEnd, &tid))
+            {
+                return false;
+            }
+
+            p = SkipSpaces(p, end);
+            if (p < end && *p == '[')
+            {
+                p = SkipSpaces(SkipToken(p, end), end);
+            }
+
+            int64_t time = -1;
+            const char* token = p;
+            const char* tokenEnd = SkipToken(p, end);
+            uint64_t value;
+            if (tokenEnd > token && tokenEnd[-1] == ':' && ParseTimestamp(token, tokenEnd - 1, &value))
+            {
+                time = static_cast<int64_t>(value);
+                p = SkipSpaces(tokenEnd, end);
+            }
+
+            token = p;
+            tokenEnd = SkipToken(p, end);
+            if (ParseUnsigned(token, tokenEnd, &value))
+            {
+                p = SkipSpaces(tokenEnd, end);
+            }
+
+            const char* eventBegin = p;
+            const char* eventEnd = p;
+            token = p;
+            tokenEnd = SkipToken(p, end);
+            if (tokenEnd > token && tokenEnd[-1] == ':')
+            {
+                eventEnd = tokenEnd - 1;
+                p = SkipSpaces(tokenEnd, end);
+            }
+
+            mChunk->samplePids.append(static_cast<uint32_t>(pid));
+            mChunk->sampleTids.append(static_cast<uint32_t>(tid));
+            mChunk->sampleEvents.append(id(mEventIds, mChunk->events, eventBegin, eventEnd));
+            mChunk->sampleTimes.append(time);
+
+            mSampleFrames = 0;
+            mInlineBegin = p;
+            mInlineEnd = end;
+            return true;
+        }
+
+        // "address symbol+0xoffset (dso)", symbol may contain spaces & parentheses
+        bool parseFrame(const char* p, const char* end)
+        {
+            const char* token = p;
+            p = SkipToken(p, end);
+            uint64_t address;
+            if (!ParseHex(token, p, &address))
+            {
+                return false;
+            }
+            p = SkipSpaces(p, end);
+
+            const char* nameEnd = end;
+            const char* dsoBegin = end;
+            const char* dsoEnd = end;
+            if (end > p && end[-1] == ')')
+            {
+                for (const char* s = end - 1; s >= p; s--)
+                {
+                    if (*s == '(' && (s == p || IsSpace(s[-1])))
+                    {
+                        dsoBegin = s + 1;
+                        dsoEnd = end - 1;
+                        nameEnd = s;
+                        break;
+                    }
+                }
+            }
+            while (nameEnd > p && IsSpace(nameEnd[-1]))
+            {
+                nameEnd--;
+            }
+
+            uint64_t offset = 0;
+            for (const char* s = nameEnd - 1; s >= p + 2; s--)
+            {
+                if (s[-2] == '+' && s[-1] == '0' && s[0] == 'x')
+                {
+                    if (ParseHex(s + 1, nameEnd, &offset))
+                    {
+                        nameEnd = s - 2;
+                    }
+                    break;
+                }
+            }
+
+            static const char unknown[] = "[unknown]";
+            if (p == nameEnd)
+            {
+                p = unknown;
+                nameEnd = unknown + sizeof(unknown) - 1;
+            }
+            if (dsoBegin == dsoEnd)
+            {
+                dsoBegin = unknown;
+                dsoEnd = unknown + sizeof(unknown) - 1;
+            }
+
+            CallStackEntry entry;
+            entry.symbol = symbolId(id(mDsoIds, mChunk->dsos, dsoBegin, dsoEnd), p, nameEnd) + 1;
+            entry.offset = static_cast<uint32_t>(offset);
+            mChunk->frames.append(entry);
+            mChunk->frameAddresses.append(address);
+
+            mSampleFrames++;
+            return true;
+        }
+
+        void finishSample()
+        {
+            if (!mInSample)
+            {
+                return;
+            }
+            mInSample = false;
+
+            if (mSampleFrames == 0)
+            {
+                mInlineBegin = SkipSpaces(mInlineBegin, mInlineEnd);
+                if (mInlineBegin == mInlineEnd || !parseFrame(mInlineBegin, mInlineEnd))
+                {
+                    // sample without any location is dropped
+                    mChunk->samplePids.pop_back();
+                    mChunk->sampleTids.pop_back();
+                    mChunk->sampleEvents.pop_back();
+                    mChunk->sampleTimes.pop_back();
+                    return;
+                }
+            }
+
+            mChunk->frames.append(CallStackEntry());
+            mChunk->frameAddresses.append(0);
+        }
+
+        Q_DISABLE_COPY(PerfChunkParser)
+    };
+}
+
+bool ImportPerfScript(const QString& fileName, ProfileData* profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    qint64 size = file.size();
+    const char* begin = size != 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (begin == nullptr)
+    {
+        *error = size != 0 ? file.errorString() : "File is empty";
+        return false;
+    }
+    const char* end = begin + size;
+
+    // chunks are split on record boundaries and parsed in parallel
+    QVector<PerfChunk> chunks;
+    for (const char* chunkBegin = begin; chunkBegin < end; )
+    {
+        PerfChunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = end - chunkBegin > PERF_CHUNK_SIZE ? NextRecord(chunkBegin + PERF_CHUNK_SIZE, end) : end;
+        chunks.append(chunk);
+
+        chunkBegin = chunk.end;
+    }
+
+    QtConcurrent::blockingMap(chunks, [](PerfChunk& chunk)
+    {
+        PerfChunkParser parser(&chunk);
+        parser.parse();
+    });
+
+    // chunks are merged in file order, so threads & symbols get same ids as with sequential parsing
+    SymbolTable& symbols = profile->symbols;
+    QHash<QPair<QByteArray, QByteArray>, uint32_t> symbolIds;
+    QHash<uint32_t, int> threads;
+
+    // with mapping events, frames are resolved to file & line from DSOs, per process
+    QString root = QFileInfo(fileName).absolutePath();
+    QHash<uint32_t, QSharedPointer<ElfSymbolizer>> symbolizers;
+
+    auto addMappings = [&](const PerfChunk& chunk, int* mapping, int sample)
+    {
+        for (; *mapping < chunk.mappings.count() && chunk.mappings[*mapping].sample <= sample; ++*mapping)
+        {
+            const PerfMapping& added = chunk.mappings[*mapping];
+
+            QSharedPointer<ElfSymbolizer>& symbolizer = symbolizers[added.pid];
+            if (!symbolizer)
+            {
+                symbolizer.reset(new ElfSymbolizer(&symbols, root));
+            }
+            symbolizer->addMapping(added.start, added.start + added.size, added.offset, QString::fromUtf8(added.path));
+        }
+    };
+
+    // only samples of first event are imported, mixing different events would make no sense
+    QByteArray event;
+    bool eventFound = false;
+
+    bool allTimes = true;
+    uint64_t firstTime = std::numeric_limits<uint64_t>::max();
+
+    for (const PerfChunk& chunk : chunks)
+    {
+        QVector<uint32_t> ids(chunk.symbols.count() + 1);
+        for (int i = 0; i < chunk.symbols.count(); i++)
+        {
+            QPair<QByteArray, QByteArray> key = qMakePair(chunk.dsos[chunk.symbols[i].first], chunk.symbols[i].second);
+
+            auto it = symbolIds.constFind(key);
+            if (it == symbolIds.constEnd())
+            {
+                Symbol symbol;
+                symbol.address = 0;
+                symbol.size = 0;
+                symbol.name = symbols.addString(QString::fromUtf8(key.second));
+                symbol.file = 0;
+                symbol.module = symbols.addString(QString::fromUtf8(key.first));
+                symbol.line = 0;
+                symbol.lineLast = 0;
+                symbol.flags = key.second == "[unknown]" ? SYMBOL_UNRESOLVED : 0;
+
+                it = symbolIds.insert(key, symbols.addSymbol(symbol));
+            }
+            ids[i + 1] = it.value();
+        }
+
+        if (!eventFound && !chunk.sampleEvents.isEmpty())
+        {
+            event = chunk.events[chunk.sampleEvents.first()];
+            eventFound = true;
+        }
+
+        QVector<bool> events(chunk.events.count());
+        for (int i = 0; i < chunk.events.count(); i++)
+        {
+            events[i] = chunk.events[i] == event;
+        }
+
+        int frame = 0;
+        int mapping = 0;
+        for (int sample = 0; sample < chunk.sampleTids.count(); sample++)
+        {
+            addMappings(chunk, &mapping, sample);
+
+            int first = frame;
+            while (chunk.frames[frame].symbol != 0)
+            {
+                frame++;
+            }
+            frame++;
+
+            if (!events[chunk.sampleEvents[sample]])
+            {
+                continue;
+            }
+
+            auto it = threads.constFind(chunk.sampleTids[sample]);
+            if (it == threads.constEnd())
+            {
+                it = threads.insert(chunk.sampleTids[sample], profile->callStacks.count());
+                profile->callStacks.append(ThreadCallStack());
+                profile->sampleTimes.append(QVector<uint64_t>());
+            }
+
+            // without pid in header, mappings can only be used if they are of single process
+            ElfSymbolizer* symbolizer = nullptr;
+            auto found = symbolizers.constFind(chunk.samplePids[sample]);
+            if (found != symbolizers.constEnd())
+            {
+                symbolizer = found.value().data();
+            }
+            else if (chunk.samplePids[sample] == 0 && symbolizers.count() == 1)
+            {
+                symbolizer = symbolizers.constBegin().value().data();
+            }
+
+            ThreadCallStack& callStack = profile->callStacks[it.value()];
+            for (int k = first; k < frame; k++)
+            {
+                CallStackEntry entry = chunk.frames[k];
+                entry.symbol = ids[entry.symbol];
+
+                uint64_t address = chunk.frameAddresses[k];
+                if (symbolizer != nullptr && entry.symbol != 0 && address != 0)
+                {
+                    // return addresses of callers point after call instruction
+                    uint32_t line = 0;
+                    uint32_t symbol = symbolizer->lookupSymbol(k == first ? address : address - 1, &line);
+                    if (symbol != 0)
+                    {
+                        entry.symbol = symbol;
+                        entry.line = line;
+                        entry.offset = static_cast<uint32_t>(address - symbols[symbol].address);
+                    }
+                }
+
+                callStack.append(entry);
+            }
+
+            const CallStackEntry& leaf = callStack[callStack.count() - (frame - first)];
+            if ((symbols[leaf.symbol].flags & SYMBOL_UNRESOLVED) != 0)
+            {
+                profile->unresolvedSamples++;
+            }
+
+            int64_t time = chunk.sampleTimes[sample];
+            if (time < 0)
+            {
+                allTimes = false;
+            }
+            else
+            {
+                profile->sampleTimes[it.value()].append(static_cast<uint64_t>(time));
+                firstTime = qMin(firstTime, static_cast<uint64_t>(time));
+            }
+        }
+
+        // mappings after last sample of chunk are used by later chunks
+        addMappings(chunk, &mapping, chunk.sampleTids.count());
+    }
+
+    if (profile->callStacks.isEmpty())
+    {
+        *error = "No samples found";
+        return false;
+    }
+
+    // times are relative to first sample, and only kept when every sample has one
+    for (QVector<uint64_t>& times : profile->sampleTimes)
+    {
+        for (uint64_t& time : times)
+        {
+            time -= firstTime;
+        }
+    }
+    if (!allTimes)
+    {
+        profile->sampleTimes.clear();
+    }
+
+    profile->symbolModules.fill(0, symbols.count());
+    return true;
+}
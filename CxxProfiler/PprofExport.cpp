@@ -0,0 +1,389 @@
+#include "Export.h"
+#include "Varint.h"
+
+namespace
+{
+    const int PPROF_CHUNK_SIZE = 1 << 20;
+
+    enum
+    {
+        WIRE_VARINT = 0,
+        WIRE_BYTES = 2,
+    };
+
+    // field numbers from profile.proto
+    enum
+    {
+        PROFILE_SAMPLE_TYPE = 1,
+        PROFILE_SAMPLE = 2,
+        PROFILE_MAPPING = 3,
+        PROFILE_LOCATION = 4,
+        PROFILE_FUNCTION = 5,
+        PROFILE_STRING_TABLE = 6,
+
+        VALUE_TYPE_TYPE = 1,
+        VALUE_TYPE_UNIT = 2,
+
+        SAMPLE_LOCATION_ID = 1,
+        SAMPLE_VALUE = 2,
+        SAMPLE_LABEL = 3,
+
+        LABEL_KEY = 1,
+        LABEL_STR = 2,
+
+        MAPPING_ID = 1,
+        MAPPING_MEMORY_START = 2,
+        MAPPING_MEMORY_LIMIT = 3,
+        MAPPING_FILENAME = 5,
+        MAPPING_BUILD_ID = 6,
+        MAPPING_HAS_FUNCTIONS = 7,
+        MAPPING_HAS_FILENAMES = 8,
+        MAPPING_HAS_LINE_NUMBERS = 9,
+        MAPPING_HAS_INLINE_FRAMES = 10,
+
+        LOCATION_ID = 1,
+        LOCATION_MAPPING_ID = 2,
+        LOCATION_ADDRESS = 3,
+        LOCATION_LINE = 4,
+
+        LINE_FUNCTION_ID = 1,
+        LINE_LINE = 2,
+
+        FUNCTION_ID = 1,
+        FUNCTION_NAME = 2,
+        FUNCTION_SYSTEM_NAME = 3,
+        FUNCTION_FILENAME = 4,
+        FUNCTION_START_LINE = 5,
+    };
+
+    // default values are not written, as in proto3
+    void AppendVarintField(QByteArray& out, uint32_t field, uint64_t value)
+    {
+        if (value != 0)
+        {
+            AppendVarint(out, (field << 3) | WIRE_VARINT);
+            AppendVarint(out, value);
+        }
+    }
+
+    void AppendBytesField(QByteArray& out, uint32_t field, const QByteArray& bytes)
+    {
+        AppendVarint(out, (field << 3) | WIRE_BYTES);
+        AppendVarint(out, bytes.size());
+        out.append(bytes);
+    }
+
+    void AppendLE32(QByteArray& out, uint32_t value)
+    {
+        out.append(static_cast<char>(value));
+        out.append(static_cast<char>(value >> 8));
+        out.append(static_cast<char>(value >> 16));
+        out.append(static_cast<char>(value >> 24));
+    }
+
+    // Writes gzip file as sequence of members, one per chunk, so output is compressed
+    // while it is produced. Readers of gzip (and pprof) concatenate all members.
+    class GzipWriter
+    {
+    public:
+        explicit GzipWriter(QIODevice* device)
+            : mDevice(device)
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int k = 0; k < 8; k++)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xedb88320 : 0);
+                }
+                mCrcTable[i] = crc;
+            }
+        }
+
+        bool write(const QByteArray& data)
+        {
+            // qCompress output is big endian size, 2 byte zlib header, raw deflate stream & adler32
+            QByteArray compressed = qCompress(data);
+
+            static const char header[] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+
+            QByteArray member;
+            member.reserve(compressed.size() + 8);
+            member.append(header, sizeof(header));
+            member.append(compressed.constData() + 6, compressed.size() - 10);
+            AppendLE32(member, crc32(data));
+            AppendLE32(member, data.size());
+
+            return mDevice->write(member) == member.size();
+        }
+
+    private:
+        QIODevice* mDevice;
+        uint32_t mCrcTable[256];
+
+        uint32_t crc32(const QByteArray& data) const
+        {
+            uint32_t crc = 0xffffffff;
+            for (char c : data)
+            {
+                crc = mCrcTable[(crc ^ static_cast<uchar>(c)) & 0xff] ^ (crc >> 8);
+            }
+            return ~crc;
+        }
+    };
+
+    // Functions, locations, mappings & strings are written when they are used first time,
+    // so only their ids are kept in memory and not whole profile message.
+    class PprofWriter
+    {
+        Q_DISABLE_COPY(PprofWriter)
+
+    public:
+        PprofWriter(const ProfileData& profile, GzipWriter* gzip)
+            : mProfile(profile)
+            , mGzip(gzip)
+            , mFunctions(profile.symbols.count())
+            , mValid(true)
+        {
+        }
+
+        bool write()
+        {
+            // string table starts with empty string
+            string(QString());
+
+            {
+                QByteArray type;
+                AppendVarintField(type, VALUE_TYPE_TYPE, string("samples"));
+                AppendVarintField(type, VALUE_TYPE_UNIT, string("count"));
+                AppendBytesField(mOut, PROFILE_SAMPLE_TYPE, type);
+            }
+
+            uint64_t threadKey = string("thread");
+
+            for (int thread = 0; thread < mProfile.callStacks.count() && mValid; thread++)
+            {
+                uint64_t threadName = string(GetThreadName(thread));
+
+                // same consecutive stacks become one sample with bigger count
+                QVector<uint64_t> last;
+                QVector<uint64_t> locations;
+                uint64_t count = 0;
+
+                for (const CallStackEntry& entry : mProfile.callStacks[thread])
+                {
+                    if (entry.symbol != 0)
+                    {
+                        locations.append(location(entry));
+                        continue;
+                    }
+
+                    if (locations != last)
+                    {
+                        sample(last, count, threadKey, threadName);
+                        last.swap(locations);
+                        count = 0;
+                    }
+                    locations.clear();
+                    count += SampleWeight(entry);
+                }
+                sample(last, count, threadKey, threadName);
+            }
+
+            for (const Mapping& mapping : mMappings)
+            {
+                QByteArray message;
+                AppendVarintField(message, MAPPING_ID, mapping.id);
+                AppendVarintField(message, MAPPING_MEMORY_START, mapping.start);
+                AppendVarintField(message, MAPPING_MEMORY_LIMIT, mapping.limit);
+                AppendVarintField(message, MAPPING_FILENAME, mapping.name);
+                AppendVarintField(message, MAPPING_BUILD_ID, mapping.buildId);
+                AppendVarintField(message, MAPPING_HAS_FUNCTIONS, 1);
+                AppendVarintField(message, MAPPING_HAS_FILENAMES, mapping.hasFiles);
+                AppendVarintField(message, MAPPING_HAS_LINE_NUMBERS, mapping.hasFiles);
+                AppendVarintField(message, MAPPING_HAS_INLINE_FRAMES, mapping.hasInlines);
+                AppendBytesField(mOut, PROFILE_MAPPING, message);
+            }
+
+            flush(true);
+            return mValid;
+        }
+
+    private:
+        struct Mapping
+        {
+            uint64_t id;
+            uint64_t start;
+            uint64_t limit;
+            uint64_t name;
+            uint64_t buildId;
+            bool hasFiles;
+            bool hasInlines;
+        };
+
+        const ProfileData& mProfile;
+        GzipWriter* mGzip;
+        QByteArray mOut;
+
+        QHash<QString, uint64_t> mStrings;
+        QVector<bool> mFunctions; // indexed by symbol id, function id is same as symbol id
+        QHash<QPair<uint64_t, uint32_t>, uint64_t> mLocations; // key is (symbol & line, offset)
+        QHash<uint64_t, Mapping> mMappings;
+        bool mValid;
+
+        void flush(bool last)
+        {
+            if (mOut.size() >= PPROF_CHUNK_SIZE || (last && !mOut.isEmpty()))
+            {
+                mValid = mValid && mGzip->write(mOut);
+                mOut.clear();
+            }
+        }
+
+        uint64_t string(const QString& text)
+        {
+            auto it = mStrings.constFind(text);
+            if (it == mStrings.constEnd())
+            {
+                AppendBytesField(mOut, PROFILE_STRING_TABLE, text.toUtf8());
+                it = mStrings.insert(text, mStrings.count());
+            }
+            return it.value();
+        }
+
+        uint64_t function(uint32_t id)
+        {
+            if (!mFunctions[id])
+            {
+                const SymbolTable& symbols = mProfile.symbols;
+
+                QByteArray message;
+                AppendVarintField(message, FUNCTION_ID, id);
+                AppendVarintField(message, FUNCTION_NAME, string(symbols.getDisplayName(id)));
+                AppendVarintField(message, FUNCTION_SYSTEM_NAME, string(symbols.getName(id)));
+                AppendVarintField(message, FUNCTION_FILENAME, string(symbols.getFile(id)));
+                AppendVarintField(message, FUNCTION_START_LINE, symbols[id].line);
+                AppendBytesField(mOut, PROFILE_FUNCTION, message);
+
+                mFunctions[id] = true;
+            }
+            return id;
+        }
+
+        // symbols of stored module images share one mapping, others are grouped by module name
+        uint64_t mapping(uint32_t id, uint64_t address)
+        {
+            const Symbol& symbol = mProfile.symbols[id];
+            if (symbol.module == 0)
+            {
+                return 0;
+            }
+
+            uint32_t module = mProfile.symbolModules.value(id);
+            uint64_t key = module != 0 ? (uint64_t(1) << 32) | module : symbol.module;
+
+            auto it = mMappings.find(key);
+            if (it == mMappings.end())
+            {
+                Mapping mapping;
+                mapping.id = mMappings.count() + 1;
+                mapping.start = address;
+                mapping.limit = address + 1;
+                mapping.name = string(mProfile.symbols.getString(symbol.module));
+                mapping.buildId = 0;
+                mapping.hasFiles = false;
+                mapping.hasInlines = false;
+
+                if (module != 0)
+                {
+                    const ProfileModule& image = mProfile.modules[module - 1];
+                    mapping.start = image.base;
+                    mapping.limit = image.base + image.imageSize;
+                    mapping.buildId = string(image.pdbKey);
+                }
+
+                it = mMappings.insert(key, mapping);
+            }
+
+            Mapping& mapping = it.value();
+            mapping.start = qMin(mapping.start, address);
+            mapping.limit = qMax(mapping.limit, address + 1);
+            mapping.hasFiles = mapping.hasFiles || symbol.file != 0;
+            mapping.hasInlines = mapping.hasInlines || (symbol.flags & SYMBOL_INLINE) != 0;
+            return mapping.id;
+        }
+
+        uint64_t location(const CallStackEntry& entry)
+        {
+            QPair<uint64_t, uint32_t> key = qMakePair((uint64_t(entry.symbol) << 32) | entry.line, entry.offset);
+
+            auto it = mLocations.constFind(key);
+            if (it == mLocations.constEnd())
+            {
+                uint64_t id = mLocations.count() + 1;
+                uint64_t address = mProfile.symbols[entry.symbol].address + entry.offset;
+
+                QByteArray line;
+                AppendVarintField(line, LINE_FUNCTION_ID, function(entry.symbol));
+                AppendVarintField(line, LINE_LINE, entry.line == ~0U ? 0 : entry.line);
+
+                QByteArray message;
+                AppendVarintField(message, LOCATION_ID, id);
+                AppendVarintField(message, LOCATION_MAPPING_ID, mapping(entry.symbol, address));
+                AppendVarintField(message, LOCATION_ADDRESS, address);
+                AppendBytesField(message, LOCATION_LINE, line);
+                AppendBytesField(mOut, PROFILE_LOCATION, message);
+
+                it = mLocations.insert(key, id);
+            }
+            return it.value();
+        }
+
+        void sample(const QVector<uint64_t>& locations, uint64_t count, uint64_t threadKey, uint64_t threadName)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            QByteArray ids;
+            for (uint64_t id : locations)
+            {
+                AppendVarint(ids, id);
+            }
+
+            QByteArray value;
+            AppendVarint(value, count);
+
+            QByteArray label;
+            AppendVarintField(label, LABEL_KEY, threadKey);
+            AppendVarintField(label, LABEL_STR, threadName);
+
+            QByteArray message;
+            AppendBytesField(message, SAMPLE_LOCATION_ID, ids);
+            AppendBytesField(message, SAMPLE_VALUE, value);
+            AppendBytesField(message, SAMPLE_LABEL, label);
+            AppendBytesField(mOut, PROFILE_SAMPLE, message);
+
+            flush(false);
+        }
+    };
+}
+
+bool ExportPprof(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    GzipWriter gzip(&file);
+    if (!PprofWriter(profile, &gzip).write())
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
 
 #pragma warning (push, 0)
 
@@ -15,6 +16,8 @@
 
 #include <QtCore>
 #include <QtConcurrent>
+#include <QtNetwork>
+#include <QtSql>
 #include <QtWidgets>
 #include <QtGui>
 
@@ -22,6 +22,9 @@ Preferences::Preferences(QWidget* parent)
         QString path = settings.value("Preferences/SDK10").toString();
         ui.txtLocationSdk10->setText(QDir::toNativeSeparators(path));
     }
+    ui.txtSymbolStore->setText(GetSymbolStore());
+    ui.txtJitMapFolder->setText(settings.value("Preferences/JitMapFolder").toString());
+    ui.spnVariationThreshold->setValue(GetVariationThreshold());
 
     QObject::connect(ui.btnLocation2013, &QPushButton::clicked, this, [this]()
     {
@@ -92,12 +95,45 @@ Preferences::Preferences(QWidget* parent)
         }
     });
 
+    QObject::connect(ui.btnSymbolStore, &QPushButton::clicked, this, [this]()
+    {
+        QString dir = ui.txtSymbolStore->text();
+        if (dir.isEmpty() || dir.contains("://"))
+        {
+            dir = "C:\\";
+        }
+
+        dir = QFileDialog::getExistingDirectory(this, "Choose local symbol store folder", dir);
+        if (!dir.isNull())
+        {
+            ui.txtSymbolStore->setText(QDir::toNativeSeparators(dir));
+        }
+    });
+
+    QObject::connect(ui.btnJitMapFolder, &QPushButton::clicked, this, [this]()
+    {
+        QString dir = ui.txtJitMapFolder->text();
+        if (dir.isEmpty())
+        {
+            dir = QDir::toNativeSeparators(QDir::tempPath());
+        }
+
+        dir = QFileDialog::getExistingDirectory(this, "Choose folder where JIT runtimes write perf map files", dir);
+        if (!dir.isNull())
+        {
+            ui.txtJitMapFolder->setText(QDir::toNativeSeparators(dir));
+        }
+    });
+
     QObject::connect(this, &QDialog::accepted, this, [this]()
     {
         QSettings settings(GetSettingsFile(), QSettings::IniFormat);
         settings.setValue("Preferences/VS2013", QDir::fromNativeSeparators(ui.txtLocation2013->text()));
         settings.setValue("Preferences/VS2015", QDir::fromNativeSeparators(ui.txtLocation2015->text()));
         settings.setValue("Preferences/SDK10", QDir::fromNativeSeparators(ui.txtLocationSdk10->text()));
+        settings.setValue("Preferences/SymbolStore", ui.txtSymbolStore->text().trimmed());
+        settings.setValue("Preferences/JitMapFolder", QDir::fromNativeSeparators(ui.txtJitMapFolder->text().trimmed()));
+        settings.setValue("Preferences/VariationThreshold", ui.spnVariationThreshold->value());
     });
 }
 
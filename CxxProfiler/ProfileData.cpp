@@ -0,0 +1,161 @@
+#include "ProfileData.h"
+
+bool ReadProfileData(uint32_t pointerSize, const QByteArray& data, ProfileData* profile)
+{
+    QDataStream in(data);
+
+    QVector<uint32_t> strings;
+    {
+        uint32_t stringCount;
+        in >> stringCount;
+        strings.resize(stringCount + 1);
+        for (uint32_t i = 0; i < stringCount && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t index;
+            QString string;
+            in >> index >> string;
+            if (index > stringCount)
+            {
+                return false;
+            }
+            strings[index] = profile->symbols.addString(string);
+        }
+    }
+
+    // ids in data are remapped to dense ids of symbol table
+    QVector<uint32_t> symbols;
+    {
+        uint32_t symbolCount;
+        in >> symbolCount;
+        symbols.resize(symbolCount + 1);
+        for (uint32_t i = 0; i < symbolCount && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t index;
+            in >> index;
+
+            Symbol symbol;
+
+            QString name;
+            in >> name;
+            symbol.name = profile->symbols.addString(name);
+
+            if (pointerSize == sizeof(uint32_t))
+            {
+                uint32_t address;
+                in >> address;
+                symbol.address = address;
+            }
+            else
+            {
+                in >> symbol.address;
+            }
+
+            uint32_t module;
+            uint32_t file;
+            in >> symbol.size >> module >> file >> symbol.line >> symbol.lineLast;
+            if (index > symbolCount || module >= uint32_t(strings.count()) || file >= uint32_t(strings.count()))
+            {
+                return false;
+            }
+            symbol.module = strings[module];
+            symbol.file = strings[file];
+            symbol.flags = 0;
+
+            symbols[index] = profile->symbols.addSymbol(symbol);
+        }
+    }
+
+    {
+        uint32_t threadCount;
+        in >> threadCount;
+        for (uint32_t i = 0; i < threadCount && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t count;
+            in >> count;
+
+            ThreadCallStack callStack;
+            for (uint32_t k = 0; k < count && in.status() == QDataStream::Ok; k++)
+            {
+                uint32_t id;
+                CallStackEntry entry;
+                in >> id >> entry.line >> entry.offset;
+                if (id >= uint32_t(symbols.count()))
+                {
+                    return false;
+                }
+                entry.symbol = symbols[id];
+                callStack.append(entry);
+            }
+            profile->callStacks.append(callStack);
+        }
+    }
+
+    // optional sample counters & symbol flags
+    if (!in.atEnd())
+    {
+        in >> profile->lostSamples >> profile->unresolvedSamples;
+
+        uint32_t flagCount;
+        in >> flagCount;
+        for (uint32_t i = 0; i < flagCount && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t index;
+            uint32_t flags;
+            in >> index >> flags;
+            if (index != 0 && index < uint32_t(symbols.count()))
+            {
+                profile->symbols[symbols[index]].flags = flags;
+            }
+        }
+    }
+
+    // optional module identities
+    profile->symbolModules.fill(0, profile->symbols.count());
+    if (!in.atEnd())
+    {
+        uint32_t moduleCount;
+        in >> moduleCount;
+        for (uint32_t i = 0; i < moduleCount && in.status() == QDataStream::Ok; i++)
+        {
+            ProfileModule module;
+            in >> module.name >> module.timestamp >> module.imageSize >> module.base >> module.pdbName >> module.pdbKey;
+            profile->modules.append(module);
+        }
+
+        uint32_t count;
+        in >> count;
+        for (uint32_t i = 0; i < count && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t index;
+            uint32_t module;
+            in >> index >> module;
+            if (index != 0 && index < uint32_t(symbols.count()) && module <= moduleCount)
+            {
+                profile->symbolModules[symbols[index]] = module;
+            }
+        }
+    }
+
+    // optional sampling interval & sample times
+    if (!in.atEnd())
+    {
+        uint32_t threadCount;
+        in >> profile->samplingInterval >> threadCount;
+        for (uint32_t i = 0; i < threadCount && in.status() == QDataStream::Ok; i++)
+        {
+            uint32_t count;
+            in >> count;
+
+            QVector<uint64_t> times;
+            for (uint32_t k = 0; k < count && in.status() == QDataStream::Ok; k++)
+            {
+                quint64 time;
+                in >> time;
+                times.append(time);
+            }
+            profile->sampleTimes.append(times);
+        }
+    }
+
+    return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "Symbols.h"
+
+// identity of module image, stored so frames can be resolved after capture
+struct ProfileModule
+{
+    QString name;
+    uint32_t timestamp;
+    uint32_t imageSize;
+    uint64_t base; // symbol addresses of module are relative to it
+    QString pdbName;
+    QString pdbKey;
+};
+
+// Content of profile, as it is captured or loaded from .profiler file.
+// Module information is optional, only profiles captured with it can be re-symbolized.
+struct ProfileData
+{
+    SymbolTable symbols;
+    CallStack callStacks;
+    uint32_t lostSamples = 0;
+    uint32_t unresolvedSamples = 0;
+
+    QVector<ProfileModule> modules;
+    QVector<uint32_t> symbolModules; // indexed by symbol id, index of module + 1 or 0
+
+    uint32_t samplingInterval = 0; // in microseconds, 0 if not known
+    QVector<QVector<uint64_t>> sampleTimes; // per thread, microseconds from start for each sample, empty if not known
+};
+
+// decodes data blob of version 1 .profiler file (before compression)
+bool ReadProfileData(uint32_t pointerSize, const QByteArray& data, ProfileData* profile);
@@ -0,0 +1,1171 @@
+#include "ProfileFile.h"
+#include "Varint.h"
+#include "Version.h"
+
+namespace
+{
+    const uint32_t PROFILE_FILE_VERSION_1 = 1;
+    const uint32_t PROFILE_MAX_THREADS = 0x100000;
+
+    const qint64 PROFILE_HEADER_SIZE = sizeof(CXX_PROFILER_FILE_ID) + 3 * sizeof(uint32_t);
+    const qint64 PROFILE_SECTION_ENTRY_SIZE = 3 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+
+    // node in stack table is (parent node, symbol & line, offset)
+    typedef QPair<uint64_t, uint64_t> StackKey;
+
+    struct StackNode
+    {
+        uint32_t parent;
+        CallStackEntry entry;
+    };
+
+    // sections are split to chunks that are compressed independently, so they can be
+    // (de)compressed on all cores and section is not limited by size of single qCompress
+    const int PROFILE_CHUNK_SIZE = 1 << 20;
+    const uint32_t PROFILE_CHUNK_STORED = 1U << 31;
+
+    struct EncodeChunk
+    {
+        int section;
+        int index; // in section
+        const char* source;
+        int size;
+        QByteArray compressed;
+    };
+
+    struct DecodeChunk
+    {
+        const uchar* source;
+        int size;
+        char* target;
+        int rawSize;
+        bool compressed;
+        bool valid;
+    };
+
+    // pieces of section are filled up to this size, so piece with its last record stays below 2GB
+    const int PROFILE_PIECE_SIZE = 1 << 30;
+
+    // piece to append next record to, records are never split between pieces
+    QByteArray& PieceForRecord(QVector<QByteArray>& pieces)
+    {
+        if (pieces.isEmpty() || pieces.last().size() >= PROFILE_PIECE_SIZE)
+        {
+            pieces.append(QByteArray());
+        }
+        return pieces.last();
+    }
+
+    // reads values of section stored in pieces, continues with next piece once current one ends
+    class PieceReader
+    {
+        Q_DISABLE_COPY(PieceReader)
+
+    public:
+        explicit PieceReader(const QVector<QByteArray>& pieces)
+            : mPieces(pieces)
+            , mIndex(0)
+            , mReader(nullptr, 0)
+        {
+            if (!mPieces.isEmpty())
+            {
+                mReader = VarintReader(reinterpret_cast<const uchar*>(mPieces[0].constData()), mPieces[0].size());
+            }
+        }
+
+        bool isValid() const
+        {
+            return mReader.isValid();
+        }
+
+        uint32_t read32()
+        {
+            return next().read32();
+        }
+
+        int64_t readSigned()
+        {
+            return next().readSigned();
+        }
+
+    private:
+        const QVector<QByteArray>& mPieces;
+        int mIndex;
+        VarintReader mReader;
+
+        VarintReader& next()
+        {
+            while (mReader.isValid() && mReader.atEnd() && mIndex + 1 < mPieces.count())
+            {
+                const QByteArray& piece = mPieces[++mIndex];
+                mReader = VarintReader(reinterpret_cast<const uchar*>(piece.constData()), piece.size());
+            }
+            return mReader;
+        }
+    };
+
+    QByteArray EncodeStrings(const SymbolTable& symbols)
+    {
+        QByteArray out;
+        AppendVarint(out, symbols.stringCount() - 1);
+        for (int id = 1; id < symbols.stringCount(); id++)
+        {
+            AppendVarintString(out, symbols.getString(id));
+        }
+        return out;
+    }
+
+    QByteArray EncodeSymbols(const SymbolTable& symbols)
+    {
+        QByteArray out;
+        AppendVarint(out, symbols.count() - 1);
+
+        uint64_t lastAddress = 0;
+        for (int id = 1; id < symbols.count(); id++)
+        {
+            const Symbol& symbol = symbols[id];
+            AppendVarint(out, symbol.name);
+            AppendVarint(out, ZigZag(static_cast<int64_t>(symbol.address - lastAddress)));
+            AppendVarint(out, symbol.size);
+            AppendVarint(out, symbol.module);
+            AppendVarint(out, symbol.file);
+            AppendVarint(out, symbol.line);
+            AppendVarint(out, ZigZag(static_cast<int32_t>(symbol.lineLast - symbol.line)));
+            AppendVarint(out, symbol.flags);
+            lastAddress = symbol.address;
+        }
+        return out;
+    }
+
+    QByteArray EncodeModules(const ProfileData& profile)
+    {
+        QByteArray out;
+        AppendVarint(out, profile.modules.count());
+        for (const ProfileModule& module : profile.modules)
+        {
+            AppendVarintString(out, module.name);
+            AppendVarint(out, module.timestamp);
+            AppendVarint(out, module.imageSize);
+            AppendVarint(out, module.base);
+            AppendVarintString(out, module.pdbName);
+            AppendVarintString(out, module.pdbKey);
+        }
+
+        for (int id = 1; id < profile.symbols.count(); id++)
+        {
+            AppendVarint(out, profile.symbolModules.value(id));
+        }
+        return out;
+    }
+
+    template <typename Map>
+    void EncodeSortedPairs(QByteArray& out, const Map& map)
+    {
+        AppendVarint(out, map.count());
+        uint32_t last = 0;
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it)
+        {
+            AppendVarint(out, it.key() - last);
+            AppendVarint(out, it.value());
+            last = it.key();
+        }
+    }
+
+    void EncodePairs(QByteArray& out, const QHash<uint32_t, uint32_t>& hash)
+    {
+        AppendVarint(out, hash.count());
+        for (auto it = hash.constBegin(); it != hash.constEnd(); ++it)
+        {
+            AppendVarint(out, it.key());
+            AppendVarint(out, it.value());
+        }
+    }
+
+    // flat profile stores only symbols with samples, as deltas of symbol id
+    QByteArray EncodeFlatThreads(const ProfileAggregates& aggregates)
+    {
+        QByteArray out;
+        AppendVarint(out, aggregates.sampleCount);
+        AppendVarint(out, aggregates.flatThreads.count());
+        for (const FlatThread& thread : aggregates.flatThreads)
+        {
+            AppendVarintString(out, thread.first);
+
+            int count = 0;
+            for (const FlatSymbol& flat : thread.second)
+            {
+                if (flat.total != 0)
+                {
+                    count++;
+                }
+            }
+
+            AppendVarint(out, count);
+            int last = 0;
+            for (int id = 1; id < thread.second.count(); id++)
+            {
+                const FlatSymbol& flat = thread.second[id];
+                if (flat.total != 0)
+                {
+                    AppendVarint(out, id - last);
+                    AppendVarint(out, flat.self);
+                    AppendVarint(out, flat.total);
+                    last = id;
+                }
+            }
+        }
+        return out;
+    }
+
+    QByteArray EncodeCallGraphs(const ProfileAggregates& aggregates)
+    {
+        QByteArray out;
+        AppendVarint(out, aggregates.callGraphThreads.count());
+        for (const CallGraphThread& thread : aggregates.callGraphThreads)
+        {
+            AppendVarintString(out, thread.first);
+            AppendVarint(out, thread.second.count());
+            for (const CallGraphNode& node : thread.second)
+            {
+                AppendVarint(out, node.symbol);
+                AppendVarint(out, node.line);
+                AppendVarint(out, node.self);
+                AppendVarint(out, node.total);
+                AppendVarint(out, node.child);
+                AppendVarint(out, node.next);
+            }
+        }
+        return out;
+    }
+
+    QByteArray EncodeFileProfile(const ProfileAggregates& aggregates)
+    {
+        QByteArray out;
+        AppendVarint(out, aggregates.fileProfile.count());
+        for (auto it = aggregates.fileProfile.constBegin(); it != aggregates.fileProfile.constEnd(); ++it)
+        {
+            const FileSamples& samples = it.value();
+            AppendVarintString(out, it.key());
+            EncodeSortedPairs(out, samples.defLineToSymbol);
+            EncodePairs(out, samples.lineToSymbol);
+            EncodePairs(out, samples.perLine);
+            EncodeSortedPairs(out, samples.perAddress);
+        }
+        return out;
+    }
+
+    // Identical stacks and common prefixes of stacks are stored once, as tree
+    // going from root to leaf. Node stores distance to its parent (usually small,
+    // as children follow parents) and line as delta from symbol definition line.
+    // Each sample is then only delta of its leaf node from previous sample. Threads
+    // with imported stacks standing for several samples also get count of each one.
+    void EncodeStacks(const ProfileData& profile, QVector<QByteArray>* stacks, QVector<QVector<QByteArray>>* samples, QVector<QVector<QByteArray>>* weights)
+    {
+        const SymbolTable& symbols = profile.symbols;
+
+        QVector<StackNode> nodes(1);
+        QHash<StackKey, uint32_t> nodeIds;
+
+        for (const ThreadCallStack& callStack : profile.callStacks)
+        {
+            QVector<uint32_t> leaves;
+            QVector<uint32_t> leafWeights;
+            bool weighted = false;
+
+            int first = 0;
+            for (int i = 0; i < callStack.count(); i++)
+            {
+                if (callStack[i].symbol != 0)
+                {
+                    continue;
+                }
+
+                uint32_t node = 0;
+                for (int k = i - 1; k >= first; k--)
+                {
+                    const CallStackEntry& entry = callStack[k];
+                    StackKey key = qMakePair((uint64_t(node) << 32) | entry.symbol, (uint64_t(entry.line) << 32) | entry.offset);
+
+                    auto it = nodeIds.constFind(key);
+                    if (it == nodeIds.constEnd())
+                    {
+                        StackNode child;
+                        child.parent = node;
+                        child.entry = entry;
+                        it = nodeIds.insert(key, nodes.count());
+                        nodes.append(child);
+                    }
+                    node = it.value();
+                }
+
+                leaves.append(node);
+                leafWeights.append(callStack[i].offset);
+                weighted = weighted || callStack[i].offset != 0;
+                first = i + 1;
+            }
+
+            QVector<QByteArray> out;
+            AppendVarint(PieceForRecord(out), leaves.count());
+            uint32_t last = 0;
+            for (uint32_t leaf : leaves)
+            {
+                AppendVarint(PieceForRecord(out), ZigZag(int64_t(leaf) - int64_t(last)));
+                last = leaf;
+            }
+            samples->append(out);
+
+            QVector<QByteArray> weightOut;
+            if (weighted)
+            {
+                AppendVarint(PieceForRecord(weightOut), leafWeights.count());
+                for (uint32_t weight : leafWeights)
+                {
+                    AppendVarint(PieceForRecord(weightOut), weight);
+                }
+            }
+            weights->append(weightOut);
+        }
+
+        AppendVarint(PieceForRecord(*stacks), nodes.count() - 1);
+        for (int i = 1; i < nodes.count(); i++)
+        {
+            const StackNode& node = nodes[i];
+            QByteArray& out = PieceForRecord(*stacks);
+            AppendVarint(out, i - node.parent);
+            AppendVarint(out, node.entry.symbol);
+            AppendVarint(out, ZigZag(static_cast<int32_t>(node.entry.line - symbols[node.entry.symbol].line)));
+            AppendVarint(out, node.entry.offset);
+        }
+    }
+}
+
+ProfileFile::ProfileFile()
+{
+}
+
+ProfileFile::~ProfileFile()
+{
+    if (mData != nullptr)
+    {
+        mFile.unmap(const_cast<uchar*>(mData));
+    }
+}
+
+bool ProfileFile::open(const QString& fileName, QString* error)
+{
+    mFile.setFileName(fileName);
+    if (!mFile.open(QIODevice::ReadOnly))
+    {
+        *error = mFile.errorString();
+        return false;
+    }
+
+    mSize = mFile.size();
+    if (mSize < PROFILE_HEADER_SIZE)
+    {
+        *error = "Invalid file header";
+        return false;
+    }
+
+    mData = mFile.map(0, mSize);
+    if (mData == nullptr)
+    {
+        *error = mFile.errorString();
+        return false;
+    }
+
+    // header stays in QDataStream layout of version 1, so older versions can report unsupported version
+    QByteArray header = QByteArray::fromRawData(reinterpret_cast<const char*>(mData), static_cast<int>(qMin<qint64>(mSize, INT_MAX)));
+    QDataStream in(header);
+
+    char id[4];
+    if (in.readRawData(id, 4) != 4 || memcmp(id, CXX_PROFILER_FILE_ID, 4) != 0)
+    {
+        *error = "Invalid file header";
+        return false;
+    }
+
+    in >> mVersion;
+    if (mVersion != PROFILE_FILE_VERSION_1 && mVersion != CXX_PROFILER_FILE_VERSION)
+    {
+        *error = "Unsupported file version";
+        return false;
+    }
+
+    if (mVersion == PROFILE_FILE_VERSION_1)
+    {
+        QByteArray compressed;
+        in >> mPointerSize >> compressed;
+        if (in.status() != QDataStream::Ok)
+        {
+            *error = "Failed to load data";
+            return false;
+        }
+
+        // blob is decoded only when profile is read
+        mLegacyData = qUncompress(compressed);
+        if (mLegacyData.isEmpty())
+        {
+            *error = "Failed to load data";
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t sectionCount;
+    in >> mPointerSize >> sectionCount;
+    if (in.status() != QDataStream::Ok
+      || (mPointerSize != sizeof(uint32_t) && mPointerSize != sizeof(uint64_t))
+      || sectionCount > (mSize - PROFILE_HEADER_SIZE) / PROFILE_SECTION_ENTRY_SIZE)
+    {
+        *error = "Invalid file header";
+        return false;
+    }
+
+    mSections.reserve(sectionCount);
+    for (uint32_t i = 0; i < sectionCount; i++)
+    {
+        ProfileSection section;
+        in >> section.type >> section.index >> section.flags >> section.offset >> section.size >> section.rawSize;
+        if (section.offset > uint64_t(mSize)
+          || section.size > uint64_t(mSize) - section.offset
+          || section.rawSize > INT_MAX
+          || section.index > PROFILE_MAX_THREADS)
+        {
+            *error = "Invalid file header";
+            return false;
+        }
+
+        if (section.type == PROFILE_SECTION_SAMPLES)
+        {
+            mThreadCount = qMax(mThreadCount, int(section.index) + 1);
+        }
+        mSections.append(section);
+    }
+
+    return true;
+}
+
+uint32_t ProfileFile::pointerSize() const
+{
+    return mPointerSize;
+}
+
+bool ProfileFile::read(ProfileData* profile) const
+{
+    if (mVersion == PROFILE_FILE_VERSION_1)
+    {
+        return ReadProfileData(mPointerSize, mLegacyData, profile);
+    }
+
+    QVector<uint32_t> symbols;
+    QVector<uint32_t> symbolLines;
+    if (!readSymbols(profile, &symbols, &symbolLines))
+    {
+        return false;
+    }
+
+    QByteArray data;
+
+    profile->symbolModules.fill(0, profile->symbols.count());
+    if (section(PROFILE_SECTION_MODULES, 0, &data))
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(data.constData()), data.size());
+        uint32_t count = in.read32();
+        for (uint32_t i = 0; i < count && in.isValid(); i++)
+        {
+            ProfileModule module;
+            module.name = in.readString();
+            module.timestamp = in.read32();
+            module.imageSize = in.read32();
+            module.base = in.read();
+            module.pdbName = in.readString();
+            module.pdbKey = in.readString();
+            profile->modules.append(module);
+        }
+
+        for (int id = 1; id < symbols.count() && in.isValid(); id++)
+        {
+            uint32_t module = in.read32();
+            if (module > count)
+            {
+                return false;
+            }
+            profile->symbolModules[symbols[id]] = module;
+        }
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    QVector<QByteArray> pieces;
+
+    QVector<StackNode> nodes(1);
+    if (mThreadCount != 0 && sectionPieces(PROFILE_SECTION_STACKS, 0, &pieces))
+    {
+        PieceReader in(pieces);
+        uint32_t count = in.read32();
+        nodes.reserve(count + 1);
+        for (uint32_t i = 1; i <= count && in.isValid(); i++)
+        {
+            uint32_t distance = in.read32();
+            uint32_t symbol = in.read32();
+            int64_t line = in.readSigned();
+            uint32_t offset = in.read32();
+            if (distance == 0 || distance > i || symbol == 0 || symbol >= uint32_t(symbols.count()))
+            {
+                return false;
+            }
+
+            StackNode node;
+            node.parent = i - distance;
+            node.entry.symbol = symbols[symbol];
+            node.entry.line = symbolLines[symbol] + static_cast<uint32_t>(line);
+            node.entry.offset = offset;
+            nodes.append(node);
+        }
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    for (int t = 0; t < mThreadCount; t++)
+    {
+        // count of samples of each stack minus one, stored only when some stack has more
+        QVector<uint32_t> weights;
+        if (sectionPieces(PROFILE_SECTION_WEIGHTS, t, &pieces))
+        {
+            PieceReader in(pieces);
+            uint32_t count = in.read32();
+            for (uint32_t i = 0; i < count && in.isValid(); i++)
+            {
+                weights.append(in.read32());
+            }
+            if (!in.isValid())
+            {
+                return false;
+            }
+        }
+
+        ThreadCallStack callStack;
+        if (sectionPieces(PROFILE_SECTION_SAMPLES, t, &pieces))
+        {
+            PieceReader in(pieces);
+            uint32_t count = in.read32();
+
+            int64_t leaf = 0;
+            for (uint32_t i = 0; i < count && in.isValid(); i++)
+            {
+                leaf += in.readSigned();
+                if (leaf <= 0 || leaf >= nodes.count())
+                {
+                    return false;
+                }
+
+                for (uint32_t node = uint32_t(leaf); node != 0; node = nodes[node].parent)
+                {
+                    callStack.append(nodes[node].entry);
+                }
+
+                CallStackEntry end;
+                end.offset = weights.value(static_cast<int>(i));
+                callStack.append(end);
+            }
+            if (!in.isValid())
+            {
+                return false;
+            }
+        }
+        profile->callStacks.append(callStack);
+
+        QVector<uint64_t> times;
+        if (sectionPieces(PROFILE_SECTION_TIMES, t, &pieces))
+        {
+            PieceReader in(pieces);
+            uint32_t count = in.read32();
+
+            uint64_t time = 0;
+            for (uint32_t i = 0; i < count && in.isValid(); i++)
+            {
+                time += static_cast<uint64_t>(in.readSigned());
+                times.append(time);
+            }
+            if (!in.isValid())
+            {
+                return false;
+            }
+        }
+        profile->sampleTimes.append(times);
+    }
+
+    return true;
+}
+
+bool ProfileFile::readAggregates(bool withEmptyFiles, ProfileData* profile, ProfileAggregates* aggregates, SampleStats* stats) const
+{
+    uint32_t variant = withEmptyFiles ? 1 : 0;
+
+    QByteArray flatData;
+    QByteArray callGraphData;
+    QByteArray fileData;
+    if (mVersion == PROFILE_FILE_VERSION_1
+      || !section(PROFILE_SECTION_FLAT, variant, &flatData)
+      || !section(PROFILE_SECTION_CALL_GRAPH, variant, &callGraphData)
+      || !section(PROFILE_SECTION_FILES, variant, &fileData))
+    {
+        return false;
+    }
+
+    QVector<uint32_t> symbols;
+    QVector<uint32_t> symbolLines;
+    if (!readSymbols(profile, &symbols, &symbolLines))
+    {
+        return false;
+    }
+
+    bool valid = true;
+    auto symbolId = [&](uint32_t id) -> uint32_t
+    {
+        if (id >= uint32_t(symbols.count()))
+        {
+            valid = false;
+            return 0U;
+        }
+        return symbols[id];
+    };
+
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(flatData.constData()), flatData.size());
+        aggregates->sampleCount = in.read32();
+
+        uint32_t threadCount = in.read32();
+        for (uint32_t i = 0; i < threadCount && in.isValid() && valid; i++)
+        {
+            QString name = in.readString();
+            FlatSymbols flatSymbols(profile->symbols.count());
+
+            uint32_t count = in.read32();
+            uint32_t id = 0;
+            for (uint32_t k = 0; k < count && in.isValid() && valid; k++)
+            {
+                id += in.read32();
+                FlatSymbol& flat = flatSymbols[symbolId(id)];
+                flat.self = in.read32();
+                flat.total = in.read32();
+            }
+
+            aggregates->flatThreads.append(FlatThread(name, flatSymbols));
+        }
+
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(callGraphData.constData()), callGraphData.size());
+
+        uint32_t threadCount = in.read32();
+        for (uint32_t i = 0; i < threadCount && in.isValid() && valid; i++)
+        {
+            QString name = in.readString();
+
+            uint32_t count = in.read32();
+            if (count > uint32_t(callGraphData.size()))
+            {
+                return false;
+            }
+
+            CallGraph graph(count);
+            for (uint32_t k = 0; k < count && in.isValid() && valid; k++)
+            {
+                CallGraphNode& node = graph[k];
+                node.symbol = symbolId(in.read32());
+                node.line = in.read32();
+                node.self = in.read32();
+                node.total = in.read32();
+                node.child = in.read32();
+                node.next = in.read32();
+                valid = valid && node.child < count && node.next < count;
+            }
+
+            aggregates->callGraphThreads.append(CallGraphThread(name, graph));
+        }
+
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(fileData.constData()), fileData.size());
+
+        uint32_t fileCount = in.read32();
+        for (uint32_t i = 0; i < fileCount && in.isValid() && valid; i++)
+        {
+            FileSamples& samples = aggregates->fileProfile[in.readString()];
+
+            uint32_t count = in.read32();
+            uint32_t line = 0;
+            for (uint32_t k = 0; k < count && in.isValid(); k++)
+            {
+                line += in.read32();
+                samples.defLineToSymbol.insert(line, symbolId(in.read32()));
+            }
+
+            count = in.read32();
+            for (uint32_t k = 0; k < count && in.isValid(); k++)
+            {
+                uint32_t parentLine = in.read32();
+                samples.lineToSymbol.insert(parentLine, symbolId(in.read32()));
+            }
+
+            count = in.read32();
+            for (uint32_t k = 0; k < count && in.isValid(); k++)
+            {
+                uint32_t sampleLine = in.read32();
+                samples.perLine.insert(sampleLine, in.read32());
+            }
+
+            count = in.read32();
+            uint32_t offset = 0;
+            for (uint32_t k = 0; k < count && in.isValid(); k++)
+            {
+                offset += in.read32();
+                samples.perAddress.insert(offset, in.read32());
+            }
+        }
+
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    stats->lost = profile->lostSamples;
+    stats->unresolved = profile->unresolvedSamples;
+    stats->hidden = 0;
+
+    // samples left out of view without empty files are difference to sample count of other view
+    QByteArray allData;
+    if (!withEmptyFiles && section(PROFILE_SECTION_FLAT, 1, &allData))
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(allData.constData()), allData.size());
+        uint32_t all = in.read32();
+        if (in.isValid() && all > aggregates->sampleCount)
+        {
+            stats->hidden = all - aggregates->sampleCount;
+        }
+    }
+
+    return valid;
+}
+
+bool ProfileFile::readSymbols(ProfileData* profile, QVector<uint32_t>* symbols, QVector<uint32_t>* symbolLines) const
+{
+    QByteArray data;
+
+    // ids in file are remapped to ids of symbol table
+    QVector<uint32_t> strings(1);
+    if (section(PROFILE_SECTION_STRINGS, 0, &data))
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(data.constData()), data.size());
+        uint32_t count = in.read32();
+        for (uint32_t i = 0; i < count && in.isValid(); i++)
+        {
+            strings.append(profile->symbols.addString(in.readString()));
+        }
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    symbols->fill(0, 1);
+    symbolLines->fill(0, 1);
+    if (section(PROFILE_SECTION_SYMBOLS, 0, &data))
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(data.constData()), data.size());
+        uint32_t count = in.read32();
+
+        uint64_t lastAddress = 0;
+        for (uint32_t i = 0; i < count && in.isValid(); i++)
+        {
+            uint32_t name = in.read32();
+            lastAddress += static_cast<uint64_t>(in.readSigned());
+
+            Symbol symbol;
+            symbol.address = lastAddress;
+            symbol.size = in.read32();
+            uint32_t module = in.read32();
+            uint32_t file = in.read32();
+            symbol.line = in.read32();
+            symbol.lineLast = symbol.line + static_cast<uint32_t>(in.readSigned());
+            symbol.flags = in.read32();
+
+            if (name >= uint32_t(strings.count()) || module >= uint32_t(strings.count()) || file >= uint32_t(strings.count()))
+            {
+                return false;
+            }
+            symbol.name = strings[name];
+            symbol.module = strings[module];
+            symbol.file = strings[file];
+
+            if (mPointerSize == sizeof(uint32_t))
+            {
+                symbol.address = uint32_t(symbol.address);
+            }
+
+            symbols->append(profile->symbols.addSymbol(symbol));
+            symbolLines->append(symbol.line);
+        }
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    if (section(PROFILE_SECTION_COUNTERS, 0, &data))
+    {
+        VarintReader in(reinterpret_cast<const uchar*>(data.constData()), data.size());
+        profile->lostSamples = in.read32();
+        profile->unresolvedSamples = in.read32();
+        if (!in.atEnd())
+        {
+            profile->samplingInterval = in.read32();
+        }
+        if (!in.isValid())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ProfileFile::section(uint32_t type, uint32_t index, QByteArray* data, uint32_t piece) const
+{
+    for (const ProfileSection& section : mSections)
+    {
+        if (section.type != type || section.index != index || (section.flags >> PROFILE_SECTION_PIECE_SHIFT) != piece)
+        {
+            continue;
+        }
+
+        const uchar* begin = mData + section.offset;
+        if ((section.flags & PROFILE_SECTION_COMPRESSED) == 0)
+        {
+            if (section.size != section.rawSize)
+            {
+                return false;
+            }
+            *data = QByteArray::fromRawData(reinterpret_cast<const char*>(begin), static_cast<int>(section.size));
+            return true;
+        }
+
+        // table of chunk sizes, followed by chunks
+        uint64_t count = (section.rawSize + PROFILE_CHUNK_SIZE - 1) / PROFILE_CHUNK_SIZE;
+        if (section.size < sizeof(uint32_t) || qFromBigEndian<quint32>(begin) != count || (section.size - sizeof(uint32_t)) / sizeof(uint32_t) < count)
+        {
+            return false;
+        }
+
+        data->resize(static_cast<int>(section.rawSize));
+
+        QVector<DecodeChunk> chunks(static_cast<int>(count));
+        uint64_t offset = sizeof(uint32_t) + count * sizeof(uint32_t);
+        for (int i = 0; i < chunks.count(); i++)
+        {
+            uint32_t size = qFromBigEndian<quint32>(begin + sizeof(uint32_t) * (i + 1));
+
+            DecodeChunk& chunk = chunks[i];
+            chunk.compressed = (size & PROFILE_CHUNK_STORED) == 0;
+            chunk.size = size & ~PROFILE_CHUNK_STORED;
+            chunk.source = begin + offset;
+            chunk.target = data->data() + i * PROFILE_CHUNK_SIZE;
+            chunk.rawSize = qMin<int>(PROFILE_CHUNK_SIZE, data->size() - i * PROFILE_CHUNK_SIZE);
+            chunk.valid = false;
+
+            offset += chunk.size;
+            if (offset > section.size)
+            {
+                return false;
+            }
+        }
+
+        QtConcurrent::blockingMap(chunks, [](DecodeChunk& chunk)
+        {
+            if (!chunk.compressed)
+            {
+                chunk.valid = chunk.size == chunk.rawSize;
+                if (chunk.valid)
+                {
+                    memcpy(chunk.target, chunk.source, chunk.size);
+                }
+                return;
+            }
+
+            QByteArray decompressed = qUncompress(chunk.source, chunk.size);
+            chunk.valid = decompressed.size() == chunk.rawSize;
+            if (chunk.valid)
+            {
+                memcpy(chunk.target, decompressed.constData(), chunk.rawSize);
+            }
+        });
+
+        for (const DecodeChunk& chunk : chunks)
+        {
+            if (!chunk.valid)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ProfileFile::sectionPieces(uint32_t type, uint32_t index, QVector<QByteArray>* pieces) const
+{
+    pieces->clear();
+
+    QByteArray data;
+    while (section(type, index, &data, static_cast<uint32_t>(pieces->count())))
+    {
+        pieces->append(data);
+    }
+    return !pieces->isEmpty();
+}
+
+bool WriteProfileFile(const QString& fileName, uint32_t pointerSize, const ProfileData& profile, QString* error)
+{
+    QVector<ProfileSection> sections;
+    QVector<QByteArray> sectionData;
+    auto addPiece = [&](uint32_t type, uint32_t index, uint32_t piece, const QByteArray& data)
+    {
+        ProfileSection section;
+        section.type = type;
+        section.index = index;
+        section.flags = PROFILE_SECTION_COMPRESSED | (piece << PROFILE_SECTION_PIECE_SHIFT);
+        section.offset = 0;
+        section.size = 0;
+        section.rawSize = data.size();
+        sections.append(section);
+        sectionData.append(data);
+    };
+    auto addSection = [&](uint32_t type, uint32_t index, const QByteArray& data)
+    {
+        addPiece(type, index, 0, data);
+    };
+    auto addPieces = [&](uint32_t type, uint32_t index, const QVector<QByteArray>& pieces)
+    {
+        for (int i = 0; i < pieces.count(); i++)
+        {
+            addPiece(type, index, static_cast<uint32_t>(i), pieces[i]);
+        }
+    };
+
+    addSection(PROFILE_SECTION_STRINGS, 0, EncodeStrings(profile.symbols));
+    addSection(PROFILE_SECTION_SYMBOLS, 0, EncodeSymbols(profile.symbols));
+
+    {
+        QByteArray counters;
+        AppendVarint(counters, profile.lostSamples);
+        AppendVarint(counters, profile.unresolvedSamples);
+        AppendVarint(counters, profile.samplingInterval);
+        addSection(PROFILE_SECTION_COUNTERS, 0, counters);
+    }
+
+    for (int i = 0; i < profile.sampleTimes.count(); i++)
+    {
+        QVector<QByteArray> times;
+        AppendVarint(PieceForRecord(times), profile.sampleTimes[i].count());
+        uint64_t last = 0;
+        for (uint64_t time : profile.sampleTimes[i])
+        {
+            AppendVarint(PieceForRecord(times), ZigZag(static_cast<int64_t>(time - last)));
+            last = time;
+        }
+        addPieces(PROFILE_SECTION_TIMES, i, times);
+    }
+
+    if (!profile.modules.isEmpty())
+    {
+        addSection(PROFILE_SECTION_MODULES, 0, EncodeModules(profile));
+    }
+
+    {
+        QVector<QByteArray> stacks;
+        QVector<QVector<QByteArray>> samples;
+        QVector<QVector<QByteArray>> weights;
+        EncodeStacks(profile, &stacks, &samples, &weights);
+
+        addPieces(PROFILE_SECTION_STACKS, 0, stacks);
+        for (int i = 0; i < samples.count(); i++)
+        {
+            addPieces(PROFILE_SECTION_SAMPLES, i, samples[i]);
+            addPieces(PROFILE_SECTION_WEIGHTS, i, weights[i]);
+        }
+    }
+
+    // views with & without frames of files without source, so opening file does not need to aggregate
+    {
+        ProfileAggregates aggregates[2];
+        QFuture<void> withEmptyFiles = QtConcurrent::run([&]()
+        {
+            ProfileAggregates& result = aggregates[1];
+            result.sampleCount = AggregateProfile(profile.symbols, profile.callStacks, true, result.flatThreads, result.callGraphThreads, result.fileProfile);
+        });
+        ProfileAggregates& result = aggregates[0];
+        result.sampleCount = AggregateProfile(profile.symbols, profile.callStacks, false, result.flatThreads, result.callGraphThreads, result.fileProfile);
+        withEmptyFiles.waitForFinished();
+
+        for (uint32_t variant = 0; variant < 2; variant++)
+        {
+            addSection(PROFILE_SECTION_FLAT, variant, EncodeFlatThreads(aggregates[variant]));
+            addSection(PROFILE_SECTION_CALL_GRAPH, variant, EncodeCallGraphs(aggregates[variant]));
+            addSection(PROFILE_SECTION_FILES, variant, EncodeFileProfile(aggregates[variant]));
+        }
+    }
+
+    // chunks of all sections in file order
+    QVector<EncodeChunk> chunks;
+    for (int i = 0; i < sections.count(); i++)
+    {
+        const QByteArray& data = sectionData[i];
+        for (int offset = 0; offset < data.size(); offset += PROFILE_CHUNK_SIZE)
+        {
+            EncodeChunk chunk;
+            chunk.section = i;
+            chunk.index = offset / PROFILE_CHUNK_SIZE;
+            chunk.source = data.constData() + offset;
+            chunk.size = qMin(PROFILE_CHUNK_SIZE, data.size() - offset);
+            chunks.append(chunk);
+        }
+    }
+
+    // written to temporary file first, so failed save does not destroy existing file
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+
+    // header is written last, once offsets & sizes are known
+    qint64 headerSize = PROFILE_HEADER_SIZE + sections.count() * PROFILE_SECTION_ENTRY_SIZE;
+    bool ok = file.write(QByteArray(static_cast<int>(headerSize), 0)) == headerSize;
+
+    // same for chunk table of each section, it is written as placeholder when section starts
+    QVector<QByteArray> chunkTables(sections.count());
+    int nextSection = 0;
+    auto startSections = [&](int last)
+    {
+        for (; nextSection <= last && ok; nextSection++)
+        {
+            ProfileSection& section = sections[nextSection];
+            uint32_t count = static_cast<uint32_t>((section.rawSize + PROFILE_CHUNK_SIZE - 1) / PROFILE_CHUNK_SIZE);
+
+            QByteArray& table = chunkTables[nextSection];
+            table.resize(static_cast<int>(sizeof(uint32_t) * (count + 1)));
+            qToBigEndian<quint32>(count, reinterpret_cast<uchar*>(table.data()));
+
+            section.offset = file.pos();
+            section.size = table.size();
+            ok = file.write(table) == table.size();
+        }
+    };
+
+    // chunks are compressed in parallel batches & written while next batch is not started yet,
+    // so only one batch of compressed chunks is kept in memory
+    int batchSize = qMax(1, QThread::idealThreadCount()) * 4;
+    for (int first = 0; first < chunks.count() && ok; first += batchSize)
+    {
+        auto begin = chunks.begin() + first;
+        auto end = chunks.begin() + qMin(first + batchSize, chunks.count());
+
+        QtConcurrent::blockingMap(begin, end, [](EncodeChunk& chunk)
+        {
+            chunk.compressed = qCompress(reinterpret_cast<const uchar*>(chunk.source), chunk.size);
+        });
+
+        for (auto it = begin; it != end && ok; ++it)
+        {
+            EncodeChunk& chunk = *it;
+            startSections(chunk.section);
+
+            // incompressible chunk is stored as is
+            uint32_t size;
+            if (chunk.compressed.size() < chunk.size)
+            {
+                size = chunk.compressed.size();
+                ok = ok && file.write(chunk.compressed) == chunk.compressed.size();
+            }
+            else
+            {
+                size = chunk.size | PROFILE_CHUNK_STORED;
+                ok = ok && file.write(chunk.source, chunk.size) == chunk.size;
+            }
+            chunk.compressed.clear();
+
+            qToBigEndian<quint32>(size, reinterpret_cast<uchar*>(chunkTables[chunk.section].data()) + sizeof(uint32_t) * (chunk.index + 1));
+            sections[chunk.section].size += size & ~PROFILE_CHUNK_STORED;
+        }
+    }
+    startSections(sections.count() - 1);
+
+    if (ok)
+    {
+        for (int i = 0; i < sections.count() && ok; i++)
+        {
+            ok = file.seek(sections[i].offset) && file.write(chunkTables[i]) == chunkTables[i].size();
+        }
+    }
+
+    if (ok)
+    {
+        QByteArray header;
+        {
+            QDataStream out(&header, QIODevice::WriteOnly);
+            out.writeRawData(CXX_PROFILER_FILE_ID, sizeof(CXX_PROFILER_FILE_ID));
+            out << CXX_PROFILER_FILE_VERSION
+                << pointerSize
+                << uint32_t(sections.count());
+
+            for (const ProfileSection& s : sections)
+            {
+                out << s.type << s.index << s.flags << s.offset << s.size << s.rawSize;
+            }
+        }
+        ok = file.seek(0) && file.write(header) == header.size();
+    }
+
+    if (!ok || !file.commit())
+    {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LoadProfileFile(const QString& fileName, uint32_t* pointerSize, ProfileData* profile, QString* error)
+{
+    ProfileFile file;
+    if (!file.open(fileName, error))
+    {
+        return false;
+    }
+
+    if (!file.read(profile))
+    {
+        *error = "Failed to load data";
+        return false;
+    }
+
+    *pointerSize = file.pointerSize();
+    return true;
+}
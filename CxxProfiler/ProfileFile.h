@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "ProfileData.h"
+
+enum ProfileSectionType
+{
+    PROFILE_SECTION_STRINGS = 1,
+    PROFILE_SECTION_SYMBOLS = 2,
+    PROFILE_SECTION_STACKS = 3,
+    PROFILE_SECTION_SAMPLES = 4, // one per thread, index is thread
+    PROFILE_SECTION_COUNTERS = 5,
+    PROFILE_SECTION_MODULES = 6,
+
+    // optional precomputed views, index is 1 when frames without source files are shown
+    PROFILE_SECTION_FLAT = 7,
+    PROFILE_SECTION_CALL_GRAPH = 8,
+    PROFILE_SECTION_FILES = 9,
+
+    PROFILE_SECTION_TIMES = 10, // optional, one per thread, index is thread
+    PROFILE_SECTION_WEIGHTS = 11, // optional, one per thread with stacks standing for several samples, index is thread
+};
+
+enum ProfileSectionFlags
+{
+    PROFILE_SECTION_COMPRESSED = 1 << 0, // split to independently compressed chunks
+};
+
+// sections that grow with sample count can be stored as several pieces with same type & index,
+// each one below 2GB limit of QByteArray; number of piece is in upper bits of section flags
+const int PROFILE_SECTION_PIECE_SHIFT = 16;
+
+struct ProfileSection
+{
+    uint32_t type;
+    uint32_t index;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t rawSize;
+};
+
+// Reader of .profiler files. Version 2 file is header with index of sections
+// followed by sections themselves, compressed in chunks on all cores. File is
+// memory mapped and only sections that are needed get decompressed & decoded,
+// unknown section types are ignored. Version 1 file is single compressed blob,
+// it is always decoded whole and is only read, never written.
+class ProfileFile
+{
+    Q_DISABLE_COPY(ProfileFile)
+
+public:
+    ProfileFile();
+    ~ProfileFile();
+
+    bool open(const QString& fileName, QString* error);
+
+    uint32_t pointerSize() const;
+
+    // decodes whole profile
+    bool read(ProfileData* profile) const;
+
+    // decodes only symbols, counters & precomputed views, false if file does not have them
+    bool readAggregates(bool withEmptyFiles, ProfileData* profile, ProfileAggregates* aggregates, SampleStats* stats) const;
+
+private:
+    QFile mFile;
+    const uchar* mData = nullptr;
+    qint64 mSize = 0;
+
+    uint32_t mVersion = 0;
+    uint32_t mPointerSize = 0;
+    int mThreadCount = 0;
+    QVector<ProfileSection> mSections;
+
+    // uncompressed blob of version 1 file
+    QByteArray mLegacyData;
+
+    bool readSymbols(ProfileData* profile, QVector<uint32_t>* symbols, QVector<uint32_t>* symbolLines) const;
+    bool section(uint32_t type, uint32_t index, QByteArray* data, uint32_t piece = 0) const;
+    bool sectionPieces(uint32_t type, uint32_t index, QVector<QByteArray>* pieces) const;
+};
+
+// file is replaced only once it is fully written
+bool WriteProfileFile(const QString& fileName, uint32_t pointerSize, const ProfileData& profile, QString* error);
+
+bool LoadProfileFile(const QString& fileName, uint32_t* pointerSize, ProfileData* profile, QString* error);
@@ -0,0 +1,181 @@
+#include "ProfileMerge.h"
+#include "ProfileFile.h"
+
+namespace
+{
+    // (name, file) & (module, line), string ids of target
+    typedef QPair<QPair<uint32_t, uint32_t>, QPair<uint32_t, uint32_t>> SymbolKey;
+
+    SymbolKey MakeSymbolKey(const Symbol& symbol)
+    {
+        return qMakePair(qMakePair(symbol.name, symbol.file), qMakePair(symbol.module, symbol.line));
+    }
+
+    bool SameModule(const ProfileModule& a, const ProfileModule& b)
+    {
+        return a.name == b.name
+            && a.timestamp == b.timestamp
+            && a.imageSize == b.imageSize
+            && a.pdbName == b.pdbName
+            && a.pdbKey == b.pdbKey;
+    }
+
+    struct ReadInput
+    {
+        QString fileName;
+        uint32_t pointerSize = 0;
+        ProfileData profile;
+        QString error;
+    };
+}
+
+void MergeProfileData(ProfileData* target, const ProfileData& source)
+{
+    SymbolTable& symbols = target->symbols;
+
+    QVector<uint32_t> strings(source.symbols.stringCount());
+    for (int i = 0; i < strings.count(); i++)
+    {
+        strings[i] = symbols.addString(source.symbols.getString(i));
+    }
+
+    QVector<uint32_t> modules(source.modules.count() + 1);
+    for (int i = 0; i < source.modules.count(); i++)
+    {
+        const ProfileModule& module = source.modules[i];
+
+        int index = 0;
+        while (index < target->modules.count() && !SameModule(target->modules[index], module))
+        {
+            index++;
+        }
+        if (index == target->modules.count())
+        {
+            target->modules.append(module);
+        }
+        modules[i + 1] = index + 1;
+    }
+
+    QHash<SymbolKey, uint32_t> symbolIds;
+    for (int id = 1; id < symbols.count(); id++)
+    {
+        symbolIds.insert(MakeSymbolKey(symbols[id]), id);
+    }
+    target->symbolModules.resize(symbols.count());
+
+    QVector<uint32_t> ids(source.symbols.count());
+    for (int id = 1; id < source.symbols.count(); id++)
+    {
+        Symbol symbol = source.symbols[id];
+        symbol.name = strings[symbol.name];
+        symbol.file = strings[symbol.file];
+        symbol.module = strings[symbol.module];
+
+        SymbolKey key = MakeSymbolKey(symbol);
+        auto it = symbolIds.constFind(key);
+        if (it == symbolIds.constEnd())
+        {
+            it = symbolIds.insert(key, symbols.addSymbol(symbol));
+            target->symbolModules.append(modules[source.symbolModules.value(id)]);
+        }
+        ids[id] = it.value();
+    }
+
+    if (target->callStacks.count() < source.callStacks.count())
+    {
+        target->callStacks.resize(source.callStacks.count());
+    }
+    for (int thread = 0; thread < source.callStacks.count(); thread++)
+    {
+        ThreadCallStack& callStack = target->callStacks[thread];
+        callStack.reserve(callStack.count() + source.callStacks[thread].count());
+
+        for (CallStackEntry entry : source.callStacks[thread])
+        {
+            entry.symbol = ids[entry.symbol];
+            callStack.append(entry);
+        }
+    }
+
+    target->lostSamples += source.lostSamples;
+    target->unresolvedSamples += source.unresolvedSamples;
+
+    if (target->samplingInterval != source.samplingInterval)
+    {
+        target->samplingInterval = 0;
+    }
+    target->sampleTimes.clear();
+}
+
+bool ReadProfileFiles(const QStringList& fileNames, uint32_t* pointerSize, QVector<ProfileData>* profiles, QString* error)
+{
+    if (fileNames.isEmpty())
+    {
+        *error = "No files to read";
+        return false;
+    }
+
+    QVector<ReadInput> inputs(fileNames.count());
+    for (int i = 0; i < fileNames.count(); i++)
+    {
+        inputs[i].fileName = fileNames.at(i);
+    }
+
+    QtConcurrent::blockingMap(inputs, [](ReadInput& input)
+    {
+        ProfileFile file;
+        if (!file.open(input.fileName, &input.error))
+        {
+            return;
+        }
+        if (!file.read(&input.profile))
+        {
+            input.error = "Failed to load data";
+            return;
+        }
+        input.pointerSize = file.pointerSize();
+    });
+
+    *pointerSize = 0;
+    profiles->clear();
+    for (const ReadInput& input : inputs)
+    {
+        if (!input.error.isEmpty())
+        {
+            *error = QString("%1: %2").arg(QFileInfo(input.fileName).fileName()).arg(input.error);
+            return false;
+        }
+        *pointerSize = qMax(*pointerSize, input.pointerSize);
+        profiles->append(input.profile);
+    }
+    return true;
+}
+
+bool MergeProfileFiles(const QStringList& fileNames, uint32_t* pointerSize, ProfileData* profile, QString* error)
+{
+    QVector<ProfileData> profiles;
+    if (!ReadProfileFiles(fileNames, pointerSize, &profiles, error))
+    {
+        return false;
+    }
+
+    // each level merges pairs in parallel, so work per level is size of all inputs spread over all cores
+    ProfileData* data = profiles.data();
+    for (int step = 1; step < profiles.count(); step *= 2)
+    {
+        QVector<int> targets;
+        for (int i = 0; i + step < profiles.count(); i += 2 * step)
+        {
+            targets.append(i);
+        }
+
+        QtConcurrent::blockingMap(targets, [data, step](int& i)
+        {
+            MergeProfileData(&data[i], data[i + step]);
+            data[i + step] = ProfileData();
+        });
+    }
+
+    *profile = profiles[0];
+    return true;
+}
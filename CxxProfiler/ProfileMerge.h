@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "ProfileData.h"
+
+// Adds samples of source to target. Symbols are unified by module, name, file & line,
+// samples of thread with same index go to same thread. Sample times can not be combined
+// so they are dropped.
+void MergeProfileData(ProfileData* target, const ProfileData& source);
+
+// reads .profiler files in parallel, pointer size is largest of inputs
+bool ReadProfileFiles(const QStringList& fileNames, uint32_t* pointerSize, QVector<ProfileData>* profiles, QString* error);
+
+// reads .profiler files in parallel and merges them pairwise in a tree, pointer size is largest of inputs
+bool MergeProfileFiles(const QStringList& fileNames, uint32_t* pointerSize, ProfileData* profile, QString* error);
@@ -1,8 +1,11 @@
 #include "Profiler.h"
+#include "Utils.h"
 
 Profiler::Profiler(const ProfilerOptions& options)
     : mOptions(options)
 {
+    mSymbolLookup.resize(1 << SYMBOL_LOOKUP_BITS);
+
     moveToThread(this);
     start(QThread::TimeCriticalPriority);
 }
@@ -90,103 +93,44 @@ uint64_t Profiler::getCollectedSamples() const
     return mCollectedSamples;
 }
 
-QByteArray Profiler::serializeCallStacks() const
+ProfileData Profiler::getProfile() const
 {
-    QHash<Symbol*, uint32_t> symbolId;
-    QHash<QString, uint32_t> stringId;
-
-    // collecting symbols that are used
-    symbolId[nullptr] = 0;
-    stringId[QString()] = 0;
-    for (const ThreadCallStack& threadCallStack : mCallStack)
+    ProfileData profile;
+    profile.symbols = mSymbols;
+    profile.callStacks = mCallStack;
+    profile.lostSamples = mLostSamples;
+    profile.unresolvedSamples = mUnresolvedSamples;
+    profile.samplingInterval = mOptions.samplingFreqInMs * 1000;
+    profile.sampleTimes = mSampleTimes;
+
+    // module identities allow to resolve frames after capture
+    if (mOptions.storeModules)
     {
-        for (const CallStackEntry& entry : threadCallStack)
+        profile.symbolModules.fill(0, mSymbols.count());
+        for (const ModuleImagePtr& image : mImages)
         {
-            if (entry.symbol)
+            ProfileModule module;
+            module.name = image->name;
+            module.timestamp = image->timestamp;
+            module.imageSize = image->imageSize;
+            module.base = image->base;
+            module.pdbName = image->pdb.name;
+            module.pdbKey = image->pdb.key;
+            profile.modules.append(module);
+
+            uint32_t index = profile.modules.count();
+            for (const ModuleSymbol& symbol : image->symbols)
             {
-                Symbol* symbol = entry.symbol.data();
-
-                if (!symbolId.contains(symbol))
-                {
-                    symbolId.insert(symbol, symbolId.count());
-                }
-
-                if (!stringId.contains(symbol->module))
-                {
-                    stringId.insert(symbol->module, stringId.count());
-                }
-
-                if (!stringId.contains(symbol->file))
-                {
-                    stringId.insert(symbol->file, stringId.count());
-                }
+                profile.symbolModules[symbol.symbol] = index;
             }
-        }
-    }
-
-    QByteArray result;
-    {
-        QBuffer buffer(&result);
-        buffer.open(QIODevice::WriteOnly);
-
-        QDataStream out(&buffer);
-
-        // writing strings - filenames & modules
-        out << uint32_t(stringId.count() - 1);
-        {
-            QHashIterator<QString, uint32_t> it(stringId);
-            while (it.hasNext())
+            for (uint32_t symbol : image->unresolvedSymbols)
             {
-                it.next();
-                if (!it.key().isEmpty())
-                {
-                    out << it.value() << it.key();
-                }
-            }
-        }
-
-        // writing symbols
-        out << uint32_t(symbolId.count() - 1);
-        {
-            QHashIterator<Symbol*, uint32_t> it(symbolId);
-            while (it.hasNext())
-            {
-                it.next();
-                const Symbol* symbol = it.key();
-                if (symbol)
-                {
-                    out << it.value();
-                    out << symbol->name;
-                    if (mIsWow64)
-                    {
-                        out << uint32_t(symbol->address);
-                    }
-                    else
-                    {
-                        out << uint64_t(symbol->address);
-                    }
-                    out << symbol->size
-                        << stringId[symbol->module]
-                        << stringId[symbol->file]
-                        << symbol->line
-                        << symbol->lineLast;
-                }
-            }
-        }
-
-        // writing call stack
-        out << (uint32_t)(mCallStack.count());
-        for (const ThreadCallStack& threadCallStack : mCallStack)
-        {
-            out << uint32_t(threadCallStack.count());
-            for (const CallStackEntry& entry : threadCallStack)
-            {
-                out << symbolId[entry.symbol.data()] << entry.line << entry.offset;
+                profile.symbolModules[symbol] = index;
             }
         }
     }
 
-    return result;
+    return profile;
 }
 
 void Profiler::stop()
@@ -273,19 +217,38 @@ void Profiler::process()
                 emit message("WaitForDebugEvent failed - " + qt_error_string(err));
             }
         }
+
+        if (mPendingModules != 0)
+        {
+            loadPendingModules(false);
+        }
+
+        if (mJitReader && mJitPollTimer.elapsed() >= JIT_POLL_INTERVAL_MS)
+        {
+            loadJitSymbols();
+            mJitPollTimer.restart();
+        }
     }
 
     if (mProcess != nullptr)
     {
+        loadPendingModules(true);
+        for (const Module& module : mModules)
+        {
+            saveSymbolCache(*module.image);
+        }
         SymCleanup(mProcess);
         mProcess = nullptr;
     }
+    mSymbolStore.reset();
 
     timeEndPeriod(1);
 }
 
 void Profiler::sample()
 {
+    uint64_t time = mCaptureTimer.nsecsElapsed() / 1000;
+
     for (auto it = mThreads.begin(), eit = mThreads.end(); it != eit; ++it)
     {
         DWORD threadId = it.key();
@@ -337,12 +300,13 @@ void Profiler::sample()
         if (ctx == nullptr)
         {
             emit message("GetThreadContext failed - " + qt_error_string());
+            ++mLostSamples;
         }
         else
         {
-            ThreadCallStack& callstack = mCallStack[mCallStackIndex[threadId]];
+            uint32_t index = mCallStackIndex[threadId];
+            ThreadCallStack& callstack = mCallStack[index];
             bool good = false;
-            int delta = 0;
             DWORD64 lastStack = 0;
             while (StackWalk64(machine, mProcess, thread, &frame, ctx, nullptr, 
                 SymFunctionTableAccess64, SymGetModuleBase64, nullptr))
@@ -355,31 +319,59 @@ void Profiler::sample()
                 }
                 lastStack = frame.AddrStack.Offset;
 
-                uint64_t address = frame.AddrPC.Offset;
+                uint32_t symbol = appendFrame(callstack, frame.AddrPC.Offset, !good);
 
-                CallStackEntry entry;
-                entry.symbol = lookupSymbol(address - delta);
-                if (entry.symbol)
+                // pending leaves are counted once their module symbols are loaded
+                if (!good && (mSymbols[symbol].flags & (SYMBOL_UNRESOLVED | SYMBOL_PENDING)) == SYMBOL_UNRESOLVED)
                 {
-                    entry.line = lookupLine(address - delta);
-                    entry.offset = static_cast<uint32_t>(address - entry.symbol->line);
-                    callstack.append(entry);
-                    good = true;
+                    ++mUnresolvedSamples;
                 }
-                delta = 1;
+                good = true;
             }
 
             if (good)
             {
                 callstack.append(CallStackEntry());
+                mSampleTimes[index].append(time);
                 ++mCollectedSamples;
             }
+            else
+            {
+                ++mLostSamples;
+            }
         }
 
         ResumeThread(thread);
     }
 }
 
+uint32_t Profiler::appendFrame(ThreadCallStack& callstack, uint64_t address, bool leaf)
+{
+    // return addresses point after call instruction, which can be already in next function or line
+    const SymbolLookup& lookup = lookupSymbol(leaf ? address : address - 1);
+    uint32_t offset = static_cast<uint32_t>(address - lookup.start);
+
+    // inlined functions are separate frames above function they were inlined into
+    for (uint32_t i = 0; i < lookup.inlines.count; i++)
+    {
+        const InlineFrame& frame = mInlineFrames[lookup.inlines.first + i];
+
+        CallStackEntry entry;
+        entry.symbol = frame.symbol;
+        entry.line = frame.line;
+        entry.offset = offset;
+        callstack.append(entry);
+    }
+
+    CallStackEntry entry;
+    entry.symbol = lookup.symbol;
+    entry.line = lookup.line;
+    entry.offset = offset;
+    callstack.append(entry);
+
+    return lookup.symbol;
+}
+
 void Profiler::createProcess(DWORD processId, DWORD threadId, const CREATE_PROCESS_DEBUG_INFO* info)
 {
     emit message(QString("Process attached, pid=0x%1, tid=0x%2")
@@ -388,6 +380,8 @@ void Profiler::createProcess(DWORD processId, DWORD threadId, const CREATE_PROCE
     mThreads.insert(threadId, info->hThread);
     mCallStackIndex.insert(threadId, mCallStack.count());
     mCallStack.append(ThreadCallStack());
+    mSampleTimes.append(QVector<uint64_t>());
+    mCaptureTimer.start();
 
     mThreadCount = 1;
 
@@ -396,7 +390,9 @@ void Profiler::createProcess(DWORD processId, DWORD threadId, const CREATE_PROCE
     mProcessBase = (DWORD64)info->lpBaseOfImage;
     IsWow64Process(mProcess, &mIsWow64);
 
-    DWORD options = SYMOPT_UNDNAME | SYMOPT_LOAD_LINES;
+    // deferred loads allow to skip debug information for modules that are in symbol cache
+    // names are kept decorated, they are undecorated only when displayed
+    DWORD options = SYMOPT_LOAD_LINES | SYMOPT_DEFERRED_LOADS;
     if (mOptions.downloadSymbols)
     {
         options |= SYMOPT_FAVOR_COMPRESSED | SYMOPT_IGNORE_NT_SYMPATH;
@@ -407,26 +403,18 @@ void Profiler::createProcess(DWORD processId, DWORD threadId, const CREATE_PROCE
     };
     SymSetOptions(options);
 
-    BOOL initialized;
-    if (mOptions.downloadSymbols)
+    // symbol server is not given to dbghelp, downloading from it would block sampling
+    // pdb files are fetched in background and dbghelp loads them from local folders
+    if (mOptions.downloadSymbols && !mOptions.symbolStore.isEmpty())
     {
-        QDir appFolder = qApp->applicationDirPath();
-        appFolder.mkdir("symbols");
-
-        QString server = "https://msdl.microsoft.com/download/symbols";
-
-        QString path = QString("SRV*%1*%2").arg(QDir::toNativeSeparators(appFolder.filePath("symbols"))).arg(server);
-        QVarLengthArray<wchar_t> pathArray(path.length() + 1);
-        pathArray[path.toWCharArray(pathArray.data())] = 0;
-
-        initialized = SymInitializeW(mProcess, pathArray.constData(), FALSE);
-    }
-    else
-    {
-        initialized = SymInitializeW(mProcess, nullptr, FALSE);
+        mSymbolStore.reset(new SymbolStore(mOptions.symbolStore, GetSymbolDownloadFolder()));
     }
 
-    if (initialized)
+    // JIT runtimes write perf map & jitdump files to temp folder unless configured otherwise
+    mJitReader.reset(new JitSymbolReader(mOptions.jitMapFolder.isEmpty() ? QDir::tempPath() : mOptions.jitMapFolder, processId));
+    mJitPollTimer.start();
+
+    if (SymInitializeW(mProcess, nullptr, FALSE))
     {
         QString name = getFileNameFromHandle(info->hFile);
         loadModule(info->hFile, name, (DWORD64)info->lpBaseOfImage);
@@ -446,10 +434,16 @@ void Profiler::exitProcess(DWORD threadId, const EXIT_PROCESS_DEBUG_INFO* info)
 
     if (mSymbolsInitialized)
     {
+        loadPendingModules(true);
+        for (const Module& module : mModules)
+        {
+            saveSymbolCache(*module.image);
+        }
         unloadModule(mProcessBase);
         SymCleanup(mProcess);
         mSymbolsInitialized = false;
     }
+    mSymbolStore.reset();
 
     mThreads.remove(threadId);
     mCallStackIndex.remove(threadId);
@@ -464,6 +458,7 @@ void Profiler::createThread(DWORD threadId, const CREATE_THREAD_DEBUG_INFO* info
     mThreads.insert(threadId, info->hThread);
     mCallStackIndex.insert(threadId, mCallStack.count());
     mCallStack.append(ThreadCallStack());
+    mSampleTimes.append(QVector<uint64_t>());
     ++mThreadCount;
 }
 
@@ -594,94 +589,390 @@ QString Profiler::formatAddress(uint64_t address) const
     return QString("0x%1").arg(address, mIsWow64 ? 8 : 16, 16, QChar('0'));
 }
 
-SymbolPtr Profiler::lookupSymbol(uint64_t address)
+const Profiler::SymbolLookup& Profiler::lookupSymbol(uint64_t address)
+{
+    // direct mapped cache in front of module symbol indices, hot loops hit same addresses over and over
+    SymbolLookup& cached = mSymbolLookup[static_cast<int>((address * 0x9E3779B97F4A7C15ULL) >> (64 - SYMBOL_LOOKUP_BITS))];
+    if (cached.address != address || cached.generation != mGeneration || cached.symbol == 0)
+    {
+        cached.address = address;
+        cached.generation = mGeneration;
+
+        Module* module = findModule(address);
+        const ModuleSymbol* resolved = module == nullptr ? nullptr : resolveSymbol(module, address);
+        int jit = module == nullptr ? mJitSymbols.find(address) : -1;
+        if (jit >= 0)
+        {
+            cached.symbol = mJitSymbols[jit];
+            cached.start = mJitSymbols.address(jit);
+            cached.line = ~(uint32_t)0;
+            cached.inlines = InlineFrames();
+        }
+        else if (resolved == nullptr)
+        {
+            cached.symbol = unresolvedSymbol(module, address, &cached.start);
+            cached.line = ~(uint32_t)0;
+            cached.inlines = InlineFrames();
+        }
+        else
+        {
+            cached.symbol = resolved->symbol;
+            cached.start = module->address + resolved->rva;
+            cached.line = resolved->lines.find(static_cast<uint32_t>(address - cached.start));
+            cached.inlines = resolveInlineFrames(module, address);
+        }
+    }
+
+    return cached;
+}
+
+InlineFrames Profiler::resolveInlineFrames(Module* module, uint64_t address)
 {
-    // check for cached symbol
+    // inline frames are expanded once per address, direct mapped lookup cache can evict them
+    uint32_t rva = static_cast<uint32_t>(address - module->address);
+    auto it = module->image->inlineSites.constFind(rva);
+    if (it != module->image->inlineSites.constEnd())
+    {
+        return it.value();
+    }
+
+    // asking dbghelp would load module without its pdb
+    if (module->pending)
+    {
+        return InlineFrames();
+    }
+
+    InlineFrames frames;
+    frames.first = mInlineFrames.count();
+
+    DWORD count = SymAddrIncludeInlineTrace(mProcess, address);
+    DWORD context;
+    DWORD frameIndex;
+    if (count != 0 && SymQueryInlineTrace(mProcess, address, 0, address, address, &context, &frameIndex))
     {
-        auto it = mSymbols.upperBound(address);
-        if (it-- != mSymbols.begin())
+        for (DWORD i = 0; i < count; i++, context++)
         {
-            if (address >= it.key() && address < it.key() + it.value()->size)
+            SYMBOL_INFO_PACKAGEW info;
+            info.si.SizeOfStruct = sizeof(info.si);
+            info.si.MaxNameLen = MAX_SYM_NAME;
+            DWORD64 displacement;
+            if (!SymFromInlineContextW(mProcess, address, context, &displacement, &info.si))
             {
-                return it.value();
+                break;
             }
+
+            // line is inside of inlined function, for outer frames it is where next frame was inlined
+            IMAGEHLP_LINEW64 line;
+            line.SizeOfStruct = sizeof(line);
+            DWORD lineDisplacement;
+            QString file;
+            InlineFrame frame;
+            frame.line = ~(uint32_t)0;
+            if (SymGetLineFromInlineContextW(mProcess, address, context, 0, &lineDisplacement, &line))
+            {
+                file = QString::fromWCharArray(line.FileName);
+                frame.line = line.LineNumber;
+            }
+
+            QString name = QString::fromWCharArray(info.si.Name, info.si.NameLen);
+            frame.symbol = inlineSymbol(module->image->nameId, name, file, frame.line);
+
+            mInlineFrames.append(frame);
+            frames.count++;
+        }
+    }
+
+    module->image->inlineSites.insert(rva, frames);
+    return frames;
+}
+
+uint32_t Profiler::inlineSymbol(uint32_t module, const QString& name, const QString& file, uint32_t line)
+{
+    // all sites where function was inlined share one symbol, so they aggregate together
+    QPair<uint32_t, uint32_t> key = qMakePair(module, mSymbols.addString(name));
+
+    auto it = mInlineSymbols.constFind(key);
+    if (it == mInlineSymbols.constEnd())
+    {
+        Symbol symbol;
+        symbol.address = 0;
+        symbol.size = 0;
+        symbol.name = key.second;
+        symbol.file = mSymbols.addString(file);
+        symbol.module = module;
+        symbol.line = line == ~(uint32_t)0 ? 0 : line;
+        symbol.lineLast = symbol.line;
+        symbol.flags = SYMBOL_INLINE;
+
+        it = mInlineSymbols.insert(key, mSymbols.addSymbol(symbol));
+    }
+
+    // definition range is not known, it grows with lines that were sampled
+    Symbol& symbol = mSymbols[it.value()];
+    if (line != ~(uint32_t)0 && mSymbols.getString(symbol.file) == file)
+    {
+        symbol.line = symbol.line == 0 ? line : qMin(symbol.line, line);
+        symbol.lineLast = qMax(symbol.lineLast, line);
+    }
+
+    return it.value();
+}
+
+const ModuleSymbol* Profiler::resolveSymbol(Module* module, uint64_t address)
+{
+    ModuleImage& image = *module->image;
+
+    // check for already resolved symbol, also in earlier loads of same image
+    int index = image.symbols.find(address - module->address);
+    if (index >= 0)
+    {
+        return &image.symbols[index];
+    }
+
+    // check persistent symbol cache
+    if (image.cache)
+    {
+        const CachedFunction* function = image.cache->findFunction(static_cast<uint32_t>(address - module->address));
+        if (function != nullptr)
+        {
+            Symbol symbol;
+            symbol.address = image.base + function->rva;
+            symbol.size = function->size;
+            symbol.name = mSymbols.addString(image.cache->getString(function->name));
+            symbol.file = mSymbols.addString(image.cache->getString(function->file));
+            symbol.module = image.nameId;
+            symbol.line = function->line;
+            symbol.lineLast = function->lineLast;
+            symbol.flags = 0;
+
+            ModuleSymbol resolved;
+            resolved.symbol = mSymbols.addSymbol(symbol);
+            resolved.rva = function->rva;
+            resolved.lines = LineTable(image.cache->getLines(function), function->rva);
+
+            return &image.symbols.insert(function->rva, symbol.size, resolved);
         }
     }
 
+    if (module->pending)
+    {
+        return nullptr;
+    }
+
     // resolve symbol
 
     SYMBOL_INFO_PACKAGEW info;
     info.si.SizeOfStruct = sizeof(info.si);
     info.si.MaxNameLen = MAX_SYM_NAME;
     DWORD64 displacement;
-    if (!SymFromAddrW(mProcess, address, &displacement, &info.si))
+    BOOL found = SymFromAddrW(mProcess, address, &displacement, &info.si);
+
+    // stripped modules without pdb resolve to nearest export, unwind table knows real function range
+    if (!found || (info.si.Flags & SYMFLAG_EXPORT) != 0)
     {
-        return SymbolPtr();
+        IMAGE_RUNTIME_FUNCTION_ENTRY function;
+        IMAGE_RUNTIME_FUNCTION_ENTRY primary;
+        if (findUnwindEntry(*module, address, &function, &primary))
+        {
+            if (!found || info.si.Address != module->address + primary.BeginAddress)
+            {
+                return resolveUnwindSymbol(module, function, primary);
+            }
+
+            // export is real function start, keep its name
+            if (info.si.Size == 0)
+            {
+                info.si.Size = primary.EndAddress - primary.BeginAddress;
+            }
+        }
+        else if (!found)
+        {
+            return nullptr;
+        }
     }
 
+    uint32_t rva = static_cast<uint32_t>(info.si.Address - module->address);
+
     // for weird pdb info (function size == 0) try looking up symbol by address
     if (info.si.Size == 0)
     {
-        auto it = mSymbols.upperBound(address);
-        if (it-- != mSymbols.begin() && it.value()->address == info.si.Address)
+        index = image.symbols.indexOf(rva);
+        if (index >= 0)
         {
-            return it.value();
+            return &image.symbols[index];
         }
     }
 
-    SymbolPtr symbol(new Symbol());
-    symbol->name = QString::fromWCharArray(info.si.Name, info.si.NameLen);
-    symbol->address = info.si.Address;
-    symbol->size = info.si.Size;
-    symbol->module = QString::null;
+    // whole line table of function is collected once, later lines are looked up locally
 
-    IMAGEHLP_LINEW64 line;
-    line.SizeOfStruct = sizeof(line);
-    DWORD offset;
-    if (SymGetLineFromAddrW64(mProcess, info.si.Address, &offset, &line))
+    QString name = QString::fromWCharArray(info.si.Name, info.si.NameLen);
+    QString file;
+
+    Symbol symbol;
+    symbol.address = image.base + rva;
+    symbol.size = info.si.Size;
+    symbol.module = image.nameId;
+    symbol.flags = 0;
+
+    CachedLines lines = CollectLines(mProcess, info.si.Address, symbol.size, module->address, &file);
+    if (lines.isEmpty())
     {
-        symbol->file = QString::fromWCharArray(line.FileName);
-        symbol->line = line.LineNumber;
-        symbol->lineLast = line.LineNumber;
+        symbol.line = 0;
+        symbol.lineLast = 0;
     }
     else
     {
-        symbol->line = 0;
+        symbol.line = lines.first().line;
+        symbol.lineLast = lines.last().line;
     }
 
-    if (SymGetLineFromAddrW64(mProcess, info.si.Address + info.si.Size - 1, &offset, &line))
+    // exports are only a fallback when pdb is missing, caching them would hide pdb symbols in later runs
+    if (image.cache && symbol.size != 0 && (info.si.Flags & SYMFLAG_EXPORT) == 0)
     {
-        symbol->lineLast = line.LineNumber;
+        image.cache->addFunction(rva, symbol.size, name, file, symbol.line, symbol.lineLast, lines);
+    }
+
+    symbol.name = mSymbols.addString(name);
+    symbol.file = mSymbols.addString(file);
+
+    ModuleSymbol resolved;
+    resolved.symbol = mSymbols.addSymbol(symbol);
+    resolved.rva = rva;
+    resolved.lines = LineTable(lines, rva);
+
+    return &image.symbols.insert(rva, symbol.size, resolved);
+}
+
+uint32_t Profiler::unresolvedSymbol(Module* module, uint64_t address, uint64_t* start)
+{
+    // addresses without symbols are grouped in small ranges inside modules, outside of modules (JIT code) in larger ones
+    uint64_t base = module == nullptr ? 0 : module->address;
+    uint64_t range = module == nullptr ? UNRESOLVED_RANGE : UNRESOLVED_MODULE_RANGE;
+    *start = base + ((address - base) & ~(range - 1));
+
+    // ranges of pending modules are resolved again when their symbols are loaded, so they are kept per load
+    bool pending = module != nullptr && module->pending;
+    uint32_t* found = nullptr;
+    if (module == nullptr || pending)
+    {
+        QHash<uint64_t, uint32_t>& symbols = pending ? mPendingSymbols : mUnresolvedSymbols;
+        found = &symbols[*start];
+    }
+    else
+    {
+        found = &module->image->unresolvedSymbols[static_cast<uint32_t>(*start - base)];
+    }
+
+    if (*found != 0)
+    {
+        return *found;
+    }
+
+    Symbol symbol;
+    if (module == nullptr)
+    {
+        symbol.name = mSymbols.addString(QString("[unresolved] %1").arg(formatAddress(*start)));
+        symbol.module = mSymbols.addString("[unknown]");
     }
     else
     {
-        symbol->lineLast = symbol->line;
+        symbol.name = mSymbols.addString(QString("[%1] %2+0x%3").arg(pending ? "pending" : "unresolved").arg(module->image->name).arg(*start - base, 0, 16));
+        symbol.module = module->image->nameId;
     }
+    symbol.address = module == nullptr || pending ? *start : module->image->base + (*start - base);
+    symbol.size = static_cast<uint32_t>(range);
+    symbol.file = 0;
+    symbol.line = 0;
+    symbol.lineLast = 0;
+    symbol.flags = pending ? SYMBOL_UNRESOLVED | SYMBOL_PENDING : SYMBOL_UNRESOLVED;
+
+    *found = mSymbols.addSymbol(symbol);
+    return *found;
+}
 
-    // resolve module
-    auto it = mModules.upperBound(address);
-    if (it-- != mModules.begin())
+bool Profiler::findUnwindEntry(const Module& module, uint64_t address, IMAGE_RUNTIME_FUNCTION_ENTRY* function, IMAGE_RUNTIME_FUNCTION_ENTRY* primary) const
+{
+    // x86 images have no .pdata section
+    if (mIsWow64)
     {
-        if (address >= it->address && address < it->address + it->size)
+        return false;
+    }
+
+    const IMAGE_RUNTIME_FUNCTION_ENTRY* entry = static_cast<const IMAGE_RUNTIME_FUNCTION_ENTRY*>(SymFunctionTableAccess64(mProcess, address));
+    if (entry == nullptr)
+    {
+        return false;
+    }
+
+    uint64_t rva = address - module.address;
+    if (rva < entry->BeginAddress || rva >= entry->EndAddress)
+    {
+        return false;
+    }
+
+    *function = *entry;
+    *primary = *entry;
+
+    // chained entries describe function parts that were moved away from its start
+    for (int depth = 0; depth < 32; depth++)
+    {
+        uint8_t header[4];
+        if (!ReadProcessMemory(mProcess, (LPCVOID)(module.address + primary->UnwindData), header, sizeof(header), nullptr)
+            || ((header[0] >> 3) & UNW_FLAG_CHAININFO) == 0)
         {
-            symbol->module = it->name;
+            break;
+        }
+
+        uint64_t chained = module.address + primary->UnwindData + 4 + ((header[2] + 1) & ~1) * sizeof(uint16_t);
+        if (!ReadProcessMemory(mProcess, (LPCVOID)chained, primary, sizeof(*primary), nullptr))
+        {
+            *primary = *function;
+            break;
         }
     }
 
-    return mSymbols.insert(symbol->address, symbol).value();
+    return true;
 }
 
-uint32_t Profiler::lookupLine(uint64_t address) const
+const ModuleSymbol* Profiler::resolveUnwindSymbol(Module* module, const IMAGE_RUNTIME_FUNCTION_ENTRY& function, const IMAGE_RUNTIME_FUNCTION_ENTRY& primary)
 {
-    DWORD offset;
-    IMAGEHLP_LINEW64 info;
-    info.SizeOfStruct = sizeof(info);
-    if (SymGetLineFromAddrW64(mProcess, address, &offset, &info))
+    ModuleImage& image = *module->image;
+
+    // all parts of function share same symbol so samples aggregate together
+    ModuleSymbol resolved;
+    resolved.rva = primary.BeginAddress;
+    int index = image.symbols.indexOf(primary.BeginAddress);
+    if (index >= 0)
     {
-        return info.LineNumber;
+        resolved.symbol = image.symbols[index].symbol;
+    }
+    else
+    {
+        Symbol symbol;
+        symbol.address = image.base + primary.BeginAddress;
+        symbol.size = primary.EndAddress - primary.BeginAddress;
+        symbol.name = mSymbols.addString(QString("%1+0x%2").arg(image.name).arg(primary.BeginAddress, 0, 16));
+        symbol.file = 0;
+        symbol.module = image.nameId;
+        symbol.line = 0;
+        symbol.lineLast = 0;
+        symbol.flags = 0;
+
+        resolved.symbol = mSymbols.addSymbol(symbol);
+
+        if (function.BeginAddress != primary.BeginAddress)
+        {
+            image.symbols.insert(primary.BeginAddress, symbol.size, resolved);
+        }
     }
 
-    return ~(uint32_t)0;
+    return &image.symbols.insert(function.BeginAddress, function.EndAddress - function.BeginAddress, resolved);
+}
+
+Module* Profiler::findModule(uint64_t address)
+{
+    int index = mModules.find(address);
+    return index < 0 ? nullptr : &mModules[index];
 }
 
 void Profiler::loadModule(HANDLE file, const QString& name, uint64_t base)
@@ -691,7 +982,7 @@ void Profiler::loadModule(HANDLE file, const QString& name, uint64_t base)
 
     Module module;
     module.handle = file;
-    module.name = "[unknown]";
+    module.path = name;
     module.address = base;
     module.size = 0;
 
@@ -705,9 +996,46 @@ void Profiler::loadModule(HANDLE file, const QString& name, uint64_t base)
         moduleInfo.SizeOfStruct = sizeof(moduleInfo);
         if (SymGetModuleInfoW64(mProcess, base, &moduleInfo))
         {
-            module.name = QString::fromWCharArray(moduleInfo.ModuleName);
+            QString moduleName = QString::fromWCharArray(moduleInfo.ModuleName);
             module.address = moduleInfo.BaseOfImage;
             module.size = moduleInfo.ImageSize;
+
+            if (module.path.isEmpty())
+            {
+                module.path = QString::fromWCharArray(moduleInfo.ImageName);
+            }
+
+            // symbols resolved in earlier loads of same image are reused
+            QString key = QString("%1/%2/%3").arg(moduleName.toLower()).arg(moduleInfo.TimeDateStamp).arg(moduleInfo.ImageSize);
+            ModuleImagePtr& image = mImages[key];
+            if (!image)
+            {
+                image.reset(new ModuleImage());
+                image->name = moduleName;
+                image->nameId = mSymbols.addString(moduleName);
+                image->timestamp = moduleInfo.TimeDateStamp;
+                image->imageSize = moduleInfo.ImageSize;
+                image->base = module.address;
+                if (mOptions.storeModules)
+                {
+                    ReadPdbIdentity(module.path, &image->pdb);
+                }
+                image->cache.reset(new SymbolCache(GetSymbolCacheFolder(), moduleName, moduleInfo.TimeDateStamp, moduleInfo.ImageSize));
+                if (image->cache->isLoaded())
+                {
+                    emit message(QString("Using cached symbols for %1").arg(moduleName));
+                }
+            }
+            module.image = image;
+
+            // module is loaded again once its pdb is fetched, symbol cache is used meanwhile
+            // later loads of image find fetched pdb in search path
+            if (mSymbolStore && image->loadCount == 0 && moduleInfo.SymType == SymDeferred && !module.path.isEmpty())
+            {
+                module.pdb = mSymbolStore->fetch(module.path);
+                module.pending = true;
+                ++mPendingModules;
+            }
         }
         else
         {
@@ -715,37 +1043,284 @@ void Profiler::loadModule(HANDLE file, const QString& name, uint64_t base)
         }
     }
 
-    mModules.insert(module.address, module);
+    if (!module.image)
+    {
+        module.image.reset(new ModuleImage());
+        module.image->name = "[unknown]";
+        module.image->nameId = mSymbols.addString(module.image->name);
+        module.image->timestamp = 0;
+        module.image->imageSize = module.size;
+        module.image->base = module.address;
+    }
+    module.generation = ++module.image->loadCount;
+    if (module.generation > 1)
+    {
+        emit message(QString("Reusing symbols of %1, load %2").arg(module.image->name).arg(module.generation));
+    }
+
+    mModules.insert(module.address, module.size, module);
+    ++mGeneration;
 }
 
 void Profiler::unloadModule(uint64_t base)
 {
+    int index = mModules.indexOf(base);
+
     if (mSymbolsInitialized)
     {
+        // samples in module are resolved before its symbols are gone
+        if (index >= 0 && mModules[index].pending)
+        {
+            finishPendingModule(&mModules[index]);
+        }
+
+        // line tables for new functions are collected while module is still loaded
+        if (index >= 0)
+        {
+            saveSymbolCache(*mModules[index].image);
+        }
+
         if (!SymUnloadModule64(mProcess, base))
         {
             emit message("SymUnloadModule64 failed - " + qt_error_string());
         }
     }
 
-    auto module = mModules.find(base);
-    if (module == mModules.end())
+    if (index < 0)
     {
         return;
     }
 
-    CloseHandle(module->handle);
+    // symbols stay with image, only lookups cached for this load are invalidated
+    CloseHandle(mModules[index].handle);
+    mModules.removeAt(index);
+    ++mGeneration;
+}
 
-    uint32_t size = module->size;
-    mModules.erase(module);
+void Profiler::loadPendingModules(bool wait)
+{
+    for (Module& module : mModules)
+    {
+        if (module.pending && (wait || module.pdb.isFinished()))
+        {
+            finishPendingModule(&module);
+        }
+    }
+}
+
+void Profiler::finishPendingModule(Module* module)
+{
+    QString pdb = module->pdb.result();
+    module->pending = false;
+    --mPendingModules;
 
-    auto it = mSymbols.lowerBound(base);
-    auto eit = mSymbols.lowerBound(base + size);
-    if (it != mSymbols.end() && eit != it)
+    if (pdb.isEmpty())
     {
-        while (it != eit)
+        emit message(QString("Symbols for %1 were not found").arg(module->image->name));
+    }
+    else
+    {
+        // folder of fetched pdb must be in search path when dbghelp loads module again
+        QString folder = QDir::toNativeSeparators(QFileInfo(pdb).path());
+
+        wchar_t buffer[32 * 1024];
+        QString searchPath;
+        if (SymGetSearchPathW(mProcess, buffer, _countof(buffer)))
+        {
+            searchPath = QString::fromWCharArray(buffer);
+        }
+
+        if (!searchPath.split(';', QString::SkipEmptyParts).contains(folder, Qt::CaseInsensitive))
+        {
+            searchPath = searchPath.isEmpty() ? folder : searchPath + ';' + folder;
+
+            QVarLengthArray<wchar_t> searchPathArray(searchPath.length() + 1);
+            searchPathArray[searchPath.toWCharArray(searchPathArray.data())] = 0;
+            SymSetSearchPathW(mProcess, searchPathArray.constData());
+        }
+
+        QVarLengthArray<wchar_t> pathArray(module->path.size() + 1);
+        pathArray[module->path.toWCharArray(pathArray.data())] = 0;
+
+        SymUnloadModule64(mProcess, module->address);
+        if (SymLoadModuleExW(mProcess, module->handle, pathArray.constData(), nullptr, module->address, module->size, nullptr, 0) == 0)
         {
-            it = mSymbols.erase(it);
+            emit message(QString("SymLoadModuleEx failed - %1").arg(qt_error_string()));
+        }
+        else
+        {
+            emit message(QString("Loaded symbols for %1").arg(module->image->name));
         }
     }
+
+    resolvePendingSamples(module->address, module->address + module->size);
+}
+
+void Profiler::resolvePendingSamples(uint64_t base, uint64_t end)
+{
+    QSet<uint32_t> pending;
+    for (auto it = mPendingSymbols.begin(); it != mPendingSymbols.end(); )
+    {
+        if (it.key() >= base && it.key() < end)
+        {
+            pending.insert(it.value());
+            it = mPendingSymbols.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // lookup cache still points to pending symbols
+    ++mGeneration;
+
+    if (pending.isEmpty())
+    {
+        return;
+    }
+
+    // exact address of pending frame is its range start + offset, entries are replaced with resolved frames
+    for (ThreadCallStack& callstack : mCallStack)
+    {
+        auto isPending = [&](const CallStackEntry& entry)
+        {
+            return pending.contains(entry.symbol);
+        };
+        if (std::none_of(callstack.constBegin(), callstack.constEnd(), isPending))
+        {
+            continue;
+        }
+
+        ThreadCallStack resolved;
+        resolved.reserve(callstack.count());
+
+        bool leaf = true;
+        for (const CallStackEntry& entry : callstack)
+        {
+            if (isPending(entry))
+            {
+                uint64_t address = mSymbols[entry.symbol].address + entry.offset;
+                uint32_t symbol = appendFrame(resolved, address, leaf);
+                if (leaf && (mSymbols[symbol].flags & SYMBOL_UNRESOLVED) != 0)
+                {
+                    ++mUnresolvedSamples;
+                }
+                leaf = false;
+            }
+            else
+            {
+                resolved.append(entry);
+                leaf = entry.symbol == 0;
+            }
+        }
+
+        callstack.swap(resolved);
+    }
+}
+
+void Profiler::saveSymbolCache(const ModuleImage& image)
+{
+    if (image.cache && image.cache->hasChanges() && !image.cache->save())
+    {
+        emit message(QString("Failed to save symbol cache for %1").arg(image.name));
+    }
+}
+
+void Profiler::loadJitSymbols()
+{
+    QVector<JitSymbol> symbols = mJitReader->poll();
+    if (symbols.isEmpty())
+    {
+        return;
+    }
+
+    // function compiled again shares symbol with its earlier code, so samples aggregate together
+    auto symbolId = [this](const JitSymbol& jit) -> uint32_t
+    {
+        uint32_t name = mSymbols.addString(jit.name);
+        auto it = mJitSymbolIds.constFind(name);
+        if (it == mJitSymbolIds.constEnd())
+        {
+            Symbol symbol;
+            symbol.address = jit.address;
+            symbol.size = jit.size;
+            symbol.name = name;
+            symbol.file = 0;
+            symbol.module = mSymbols.addString("[jit]");
+            symbol.line = 0;
+            symbol.lineLast = 0;
+            symbol.flags = 0;
+
+            it = mJitSymbolIds.insert(name, mSymbols.addSymbol(symbol));
+        }
+        return it.value();
+    };
+
+    if (symbols.count() < mJitSymbols.count() / 8)
+    {
+        for (const JitSymbol& jit : symbols)
+        {
+            mJitSymbols.replace(jit.address, jit.size, symbolId(jit));
+        }
+    }
+    else
+    {
+        // big batch (like first read of large map) is sorted and index is rebuilt by appending
+        struct Range
+        {
+            uint64_t address;
+            uint32_t size;
+            uint32_t symbol;
+            int order;
+        };
+
+        QVector<Range> ranges;
+        ranges.reserve(mJitSymbols.count() + symbols.count());
+        for (int i = 0; i < mJitSymbols.count(); i++)
+        {
+            Range range;
+            range.address = mJitSymbols.address(i);
+            range.size = mJitSymbols.size(i);
+            range.symbol = mJitSymbols[i];
+            range.order = ranges.count();
+            ranges.append(range);
+        }
+        for (const JitSymbol& jit : symbols)
+        {
+            Range range;
+            range.address = jit.address;
+            range.size = jit.size;
+            range.symbol = symbolId(jit);
+            range.order = ranges.count();
+            ranges.append(range);
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b)
+        {
+            return a.address < b.address || (a.address == b.address && a.order < b.order);
+        });
+
+        // code emitted later at reused addresses replaces older code it overlaps
+        // index stays non-overlapping, so only last appended range can overlap next one
+        mJitSymbols.clear();
+        int lastOrder = -1;
+        for (const Range& range : ranges)
+        {
+            int last = mJitSymbols.count() - 1;
+            if (last >= 0 && (mJitSymbols.address(last) == range.address || mJitSymbols.address(last) + mJitSymbols.size(last) > range.address))
+            {
+                if (lastOrder > range.order)
+                {
+                    continue;
+                }
+                mJitSymbols.removeAt(last);
+            }
+            mJitSymbols.insert(range.address, range.size, range.symbol);
+            lastOrder = range.order;
+        }
+    }
+
+    // addresses that were unresolved before can have symbols now
+    ++mGeneration;
 }
@@ -2,32 +2,72 @@
 
 #include "Precompiled.h"
 #include "Symbols.h"
+#include "SymbolCache.h"
+#include "AddressIndex.h"
+#include "LineTable.h"
+#include "SymbolStore.h"
+#include "ProfileData.h"
+#include "JitSymbols.h"
 
 struct ProfilerOptions
 {
     uint32_t samplingFreqInMs;
     bool captureDebugOutputString;
     bool downloadSymbols;
+    QString symbolStore;
+    QString jitMapFolder;
+    bool storeModules;
 };
 
+struct ModuleSymbol
+{
+    uint32_t symbol;
+    uint32_t rva; // start of symbol, offsets and lines are relative to it
+    LineTable lines;
+};
+
+// frames of functions inlined at address, innermost first
+struct InlineFrames
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// Image is identified by name, PE timestamp & size. It is kept when module is unloaded,
+// so module loaded again (even at different base) resolves to same symbols and its
+// samples aggregate together. Everything here is indexed by rva.
+struct ModuleImage
+{
+    QString name;
+    uint32_t nameId;
+    uint32_t timestamp;
+    uint32_t imageSize;
+    uint64_t base; // of first load, symbol addresses are relative to it
+    PdbIdentity pdb;
+    uint32_t loadCount = 0;
+    SymbolCachePtr cache;
+    AddressIndex<ModuleSymbol> symbols;
+    QHash<uint32_t, uint32_t> unresolvedSymbols;
+    QHash<uint32_t, InlineFrames> inlineSites;
+};
+
+typedef QSharedPointer<ModuleImage> ModuleImagePtr;
+
+// one load of image in process
 struct Module
 {
     HANDLE handle;
-    QString name;
+    QString path;
     uint64_t address;
     uint32_t size;
-};
+    uint32_t generation; // 1 for first load of image
+    ModuleImagePtr image;
 
-struct CallStackEntry
-{
-    SymbolPtr symbol;
-    uint32_t line = 0;
-    uint32_t offset = 0;
+    // pdb is being fetched in background, dbghelp is not asked about module until it arrives
+    bool pending = false;
+    QFuture<QString> pdb;
 };
 
-typedef QVector<CallStackEntry> ThreadCallStack;
-typedef QVector<ThreadCallStack> CallStack;
-
 class Profiler : public QThread
 {
     Q_OBJECT
@@ -43,7 +83,7 @@ public:
     uint32_t getSizeOfPointer() const;
     uint32_t getThreadCount() const;
     uint64_t getCollectedSamples() const;
-    QByteArray serializeCallStacks() const;
+    ProfileData getProfile() const;
 
 public slots:
     void stop();
@@ -56,6 +96,7 @@ signals:
 private:
     void process();
     void sample();
+    uint32_t appendFrame(ThreadCallStack& callstack, uint64_t address, bool leaf);
 
     void createProcess(DWORD processId, DWORD threadId, const CREATE_PROCESS_DEBUG_INFO* info);
     void exitProcess(DWORD threadId, const EXIT_PROCESS_DEBUG_INFO* info);
@@ -85,15 +126,73 @@ private:
 
     QHash<DWORD, uint32_t> mCallStackIndex;
     CallStack mCallStack;
+    QVector<QVector<uint64_t>> mSampleTimes; // same indices as mCallStack
+    QElapsedTimer mCaptureTimer;
     QAtomicInteger<uint64_t> mCollectedSamples = 0;
+    uint32_t mLostSamples = 0;
+    uint32_t mUnresolvedSamples = 0;
 
     // symbol cache
-    QMap<uint64_t, SymbolPtr> mSymbols;
-    QMap<uint64_t, Module> mModules;
-
-    SymbolPtr lookupSymbol(uint64_t address);
-    uint32_t lookupLine(uint64_t address) const;
-
+    enum
+    {
+        SYMBOL_LOOKUP_BITS = 12,
+        UNRESOLVED_MODULE_RANGE = 0x1000,
+        UNRESOLVED_RANGE = 0x10000,
+        JIT_POLL_INTERVAL_MS = 100,
+    };
+
+    struct InlineFrame
+    {
+        uint32_t symbol;
+        uint32_t line;
+    };
+
+    struct SymbolLookup
+    {
+        uint64_t address = 0;
+        uint64_t start = 0;
+        uint32_t generation = 0;
+        uint32_t symbol = 0;
+        uint32_t line = 0;
+        InlineFrames inlines;
+    };
+
+    SymbolTable mSymbols;
+    QVector<SymbolLookup> mSymbolLookup;
+    AddressIndex<Module> mModules;
+    QHash<QString, ModuleImagePtr> mImages;
+    QHash<uint64_t, uint32_t> mUnresolvedSymbols;
+    QHash<uint64_t, uint32_t> mPendingSymbols;
+
+    // incremented on every module load & unload, lookups cached in older generation are stale
+    uint32_t mGeneration = 1;
+
+    QScopedPointer<SymbolStore> mSymbolStore;
+    uint32_t mPendingModules = 0;
+
+    // code generated at runtime, outside of modules
+    QScopedPointer<JitSymbolReader> mJitReader;
+    QElapsedTimer mJitPollTimer;
+    AddressIndex<uint32_t> mJitSymbols;
+    QHash<uint32_t, uint32_t> mJitSymbolIds; // by name string id
+
+    QVector<InlineFrame> mInlineFrames;
+    QHash<QPair<uint32_t, uint32_t>, uint32_t> mInlineSymbols;
+
+    const SymbolLookup& lookupSymbol(uint64_t address);
+    InlineFrames resolveInlineFrames(Module* module, uint64_t address);
+    uint32_t inlineSymbol(uint32_t module, const QString& name, const QString& file, uint32_t line);
+    const ModuleSymbol* resolveSymbol(Module* module, uint64_t address);
+    uint32_t unresolvedSymbol(Module* module, uint64_t address, uint64_t* start);
+    bool findUnwindEntry(const Module& module, uint64_t address, IMAGE_RUNTIME_FUNCTION_ENTRY* function, IMAGE_RUNTIME_FUNCTION_ENTRY* primary) const;
+    const ModuleSymbol* resolveUnwindSymbol(Module* module, const IMAGE_RUNTIME_FUNCTION_ENTRY& function, const IMAGE_RUNTIME_FUNCTION_ENTRY& primary);
+
+    Module* findModule(uint64_t address);
     void loadModule(HANDLE file, const QString& name, uint64_t base);
     void unloadModule(uint64_t base);
+    void loadPendingModules(bool wait);
+    void finishPendingModule(Module* module);
+    void resolvePendingSamples(uint64_t base, uint64_t end);
+    void saveSymbolCache(const ModuleImage& image);
+    void loadJitSymbols();
 };
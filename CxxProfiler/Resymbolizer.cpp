@@ -0,0 +1,286 @@
+#include "Resymbolizer.h"
+#include "ProfileData.h"
+#include "AddressIndex.h"
+#include "LineTable.h"
+#include "SymbolCache.h"
+#include "SymbolStore.h"
+#include "Utils.h"
+
+namespace
+{
+    struct ResolvedFunction
+    {
+        uint32_t symbol = 0; // id in profile, assigned when frames are rewritten
+        QString name;
+        QString file;
+        uint32_t line;
+        uint32_t lineLast;
+        LineTable lines;
+    };
+
+    struct ModuleWork
+    {
+        ProfileModule module;
+        QVector<uint32_t> addresses; // rva of frames
+        AddressIndex<ResolvedFunction> functions;
+    };
+
+    // all dbghelp functions are single threaded
+    QMutex DbgHelpLock;
+
+    ResolvedFunction FromCache(const SymbolCache& cache, const CachedFunction* function)
+    {
+        ResolvedFunction resolved;
+        resolved.name = cache.getString(function->name);
+        resolved.file = cache.getString(function->file);
+        resolved.line = function->line;
+        resolved.lineLast = function->lineLast;
+        resolved.lines = LineTable(cache.getLines(function), function->rva);
+        return resolved;
+    }
+
+    void ResolveModule(HANDLE process, const SymbolStore& store, ModuleWork* work)
+    {
+        const ProfileModule& module = work->module;
+
+        // functions resolved on this machine earlier (while profiling or resymbolizing) are in symbol cache
+        SymbolCache cache(GetSymbolCacheFolder(), module.name, module.timestamp, module.imageSize);
+
+        QVector<uint32_t> missing;
+        for (uint32_t rva : work->addresses)
+        {
+            if (work->functions.find(rva) >= 0)
+            {
+                continue;
+            }
+
+            const CachedFunction* function = cache.findFunction(rva);
+            if (function == nullptr)
+            {
+                missing.append(rva);
+            }
+            else
+            {
+                work->functions.insert(function->rva, function->size, FromCache(cache, function));
+            }
+        }
+
+        if (missing.isEmpty() || module.pdbName.isEmpty())
+        {
+            return;
+        }
+
+        PdbIdentity identity;
+        identity.name = module.pdbName;
+        identity.key = module.pdbKey;
+
+        QString pdb = store.fetchPdb(identity, QString());
+        if (pdb.isEmpty())
+        {
+            return;
+        }
+
+        QVarLengthArray<wchar_t> pdbArray(pdb.length() + 1);
+        pdbArray[QDir::toNativeSeparators(pdb).toWCharArray(pdbArray.data())] = 0;
+
+        QMutexLocker lock(&DbgHelpLock);
+
+        DWORD64 base = SymLoadModuleExW(process, nullptr, pdbArray.constData(), nullptr, module.base, module.imageSize, nullptr, 0);
+        if (base == 0)
+        {
+            return;
+        }
+
+        for (uint32_t rva : missing)
+        {
+            if (work->functions.find(rva) >= 0)
+            {
+                continue;
+            }
+
+            SYMBOL_INFO_PACKAGEW info;
+            info.si.SizeOfStruct = sizeof(info.si);
+            info.si.MaxNameLen = MAX_SYM_NAME;
+            DWORD64 displacement;
+            if (!SymFromAddrW(process, base + rva, &displacement, &info.si))
+            {
+                continue;
+            }
+
+            uint32_t start = static_cast<uint32_t>(info.si.Address - base);
+
+            ResolvedFunction resolved;
+            resolved.name = QString::fromWCharArray(info.si.Name, info.si.NameLen);
+
+            CachedLines lines = CollectLines(process, info.si.Address, info.si.Size, base, &resolved.file);
+            resolved.line = lines.isEmpty() ? 0 : lines.first().line;
+            resolved.lineLast = lines.isEmpty() ? 0 : lines.last().line;
+            resolved.lines = LineTable(lines, start);
+
+            // function without size covers only addresses that were asked for
+            uint32_t size = info.si.Size;
+            if (size == 0)
+            {
+                size = static_cast<uint32_t>(displacement) + 1;
+            }
+            else
+            {
+                cache.addFunction(start, size, resolved.name, resolved.file, resolved.line, resolved.lineLast, lines);
+            }
+
+            work->functions.insert(start, size, resolved);
+        }
+
+        SymUnloadModule64(process, base);
+        lock.unlock();
+
+        if (cache.hasChanges())
+        {
+            cache.save();
+        }
+    }
+
+    // calls f(entry, module index, rva) for each frame that is unresolved in one of modules
+    // rva is lookup address, for return addresses it is inside of call instruction
+    template <typename F>
+    void ForUnresolvedFrames(ProfileData& profile, F f)
+    {
+        for (ThreadCallStack& callStack : profile.callStacks)
+        {
+            bool leaf = true;
+            for (CallStackEntry& entry : callStack)
+            {
+                if (entry.symbol == 0)
+                {
+                    leaf = true;
+                    continue;
+                }
+
+                const Symbol& symbol = profile.symbols[entry.symbol];
+                uint32_t module = profile.symbolModules[entry.symbol];
+                if (module != 0 && (symbol.flags & SYMBOL_UNRESOLVED) != 0)
+                {
+                    uint32_t rva = static_cast<uint32_t>(symbol.address - profile.modules[module - 1].base + entry.offset);
+                    f(entry, module - 1, leaf ? rva : rva - 1);
+                }
+                leaf = false;
+            }
+        }
+    }
+}
+
+bool ResymbolizeProfile(ProfileData* profileData, const QString& symbolStore, ResymbolizeResult* result, QString* error)
+{
+    ProfileData& profile = *profileData;
+    if (profile.modules.isEmpty())
+    {
+        *error = "Profile has no module information, capture it with 'Store module information' option";
+        return false;
+    }
+
+    QVector<ModuleWork> work(profile.modules.count());
+    for (int i = 0; i < work.count(); i++)
+    {
+        work[i].module = profile.modules[i];
+    }
+
+    ForUnresolvedFrames(profile, [&](CallStackEntry&, uint32_t module, uint32_t rva)
+    {
+        work[module].addresses.append(rva);
+        result->frames++;
+    });
+
+    HANDLE process = GetCurrentProcess();
+    SymSetOptions(SYMOPT_LOAD_LINES);
+    if (!SymInitializeW(process, nullptr, FALSE))
+    {
+        *error = "SymInitialize failed - " + qt_error_string();
+        return false;
+    }
+
+    {
+        SymbolStore store(symbolStore, GetSymbolDownloadFolder());
+
+        QList<QFuture<void>> futures;
+        for (ModuleWork& module : work)
+        {
+            if (!module.addresses.isEmpty())
+            {
+                std::sort(module.addresses.begin(), module.addresses.end());
+                module.addresses.erase(std::unique(module.addresses.begin(), module.addresses.end()), module.addresses.end());
+
+                ModuleWork* modulePtr = &module;
+                futures.append(QtConcurrent::run([process, &store, modulePtr]()
+                {
+                    ResolveModule(process, store, modulePtr);
+                }));
+            }
+        }
+
+        for (QFuture<void>& future : futures)
+        {
+            future.waitForFinished();
+        }
+    }
+
+    SymCleanup(process);
+
+    // frames are rewritten to new symbols, old unresolved symbols stay in table without samples
+    ForUnresolvedFrames(profile, [&](CallStackEntry& entry, uint32_t module, uint32_t rva)
+    {
+        ModuleWork& moduleWork = work[module];
+        int index = moduleWork.functions.find(rva);
+        if (index < 0)
+        {
+            return;
+        }
+
+        uint32_t start = static_cast<uint32_t>(moduleWork.functions.address(index));
+        ResolvedFunction& function = moduleWork.functions[index];
+        if (function.symbol == 0)
+        {
+            Symbol symbol;
+            symbol.address = moduleWork.module.base + start;
+            symbol.size = moduleWork.functions.size(index);
+            symbol.name = profile.symbols.addString(function.name);
+            symbol.file = profile.symbols.addString(function.file);
+            symbol.module = profile.symbols[entry.symbol].module;
+            symbol.line = function.line;
+            symbol.lineLast = function.lineLast;
+            symbol.flags = 0;
+
+            function.symbol = profile.symbols.addSymbol(symbol);
+            profile.symbolModules.append(module + 1);
+        }
+
+        // offset is from exact frame address, line is looked up with same address as symbol
+        uint32_t address = static_cast<uint32_t>(profile.symbols[entry.symbol].address - moduleWork.module.base + entry.offset);
+        entry.symbol = function.symbol;
+        entry.offset = address - start;
+        entry.line = function.lines.find(rva - start);
+        result->resolved++;
+    });
+
+    // leaf frames that are still unresolved
+    profile.unresolvedSamples = 0;
+    for (const ThreadCallStack& callStack : profile.callStacks)
+    {
+        bool leaf = true;
+        bool unresolved = false;
+        for (const CallStackEntry& entry : callStack)
+        {
+            if (entry.symbol == 0)
+            {
+                profile.unresolvedSamples += unresolved ? SampleWeight(entry) : 0;
+                unresolved = false;
+            }
+            else if (leaf)
+            {
+                unresolved = (profile.symbols[entry.symbol].flags & SYMBOL_UNRESOLVED) != 0;
+            }
+            leaf = entry.symbol == 0;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Precompiled.h"
+
+struct ResymbolizeResult
+{
+    uint32_t frames = 0;   // frames that were unresolved in modules
+    uint32_t resolved = 0; // frames that got symbol
+};
+
+// Resolves frames that had no symbols at capture time. Profile must be captured with module
+// information, pdb files are looked up by their identity in symbol store (local folder or url).
+// Modules are processed in parallel, only calls to dbghelp are serialized as it is single threaded.
+struct ProfileData;
+
+bool ResymbolizeProfile(ProfileData* profile, const QString& symbolStore, ResymbolizeResult* result, QString* error);
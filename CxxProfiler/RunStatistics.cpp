@@ -0,0 +1,214 @@
+#include "RunStatistics.h"
+#include "ProfileMerge.h"
+
+namespace
+{
+    // two-sided 95% quantiles of Student's t distribution for 1..30 degrees of freedom
+    const double StudentT95[] =
+    {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    const double NORMAL95 = 1.960;
+
+    // sums of shares & their squares over runs
+    struct ShareSums
+    {
+        double sum = 0;
+        double squares = 0;
+
+        void add(double share)
+        {
+            sum += share;
+            squares += share * share;
+        }
+
+        ShareStats stats(int runCount) const
+        {
+            ShareStats result;
+            result.mean = sum / runCount;
+            if (runCount > 1)
+            {
+                double variance = (squares - runCount * result.mean * result.mean) / (runCount - 1);
+                result.deviation = qSqrt(qMax(variance, 0.0));
+
+                int freedom = runCount - 1;
+                double t = freedom <= static_cast<int>(_countof(StudentT95)) ? StudentT95[freedom - 1] : NORMAL95;
+                result.confidence = t * result.deviation / qSqrt(static_cast<double>(runCount));
+            }
+            return result;
+        }
+    };
+
+    QVector<ShareStats> ToStats(const QVector<ShareSums>& sums, int runCount)
+    {
+        QVector<ShareStats> result(sums.count());
+        for (int i = 0; i < sums.count(); i++)
+        {
+            result[i] = sums[i].stats(runCount);
+        }
+        return result;
+    }
+
+    const FlatSymbols* FindFlatThread(const FlatThreads& threads, const QString& name)
+    {
+        for (const FlatThread& thread : threads)
+        {
+            if (thread.first == name)
+            {
+                return &thread.second;
+            }
+        }
+        return nullptr;
+    }
+
+    const CallGraph* FindCallGraphThread(const CallGraphThreads& threads, const QString& name)
+    {
+        for (const CallGraphThread& thread : threads)
+        {
+            if (thread.first == name)
+            {
+                return &thread.second;
+            }
+        }
+        return nullptr;
+    }
+}
+
+bool LoadProfileRuns(const QStringList& fileNames, uint32_t* pointerSize, ProfileData* merged, QVector<CallStack>* runs, QString* error)
+{
+    QVector<ProfileData> profiles;
+    if (!ReadProfileFiles(fileNames, pointerSize, &profiles, error))
+    {
+        return false;
+    }
+
+    // samples of each run are appended after previous runs, so they are cut out from merged call stacks
+    *merged = profiles[0];
+    runs->clear();
+    runs->append(profiles[0].callStacks);
+
+    for (int i = 1; i < profiles.count(); i++)
+    {
+        QVector<int> starts;
+        for (const ThreadCallStack& callStack : merged->callStacks)
+        {
+            starts.append(callStack.count());
+        }
+
+        MergeProfileData(merged, profiles[i]);
+        profiles[i] = ProfileData();
+
+        CallStack run;
+        for (int thread = 0; thread < merged->callStacks.count(); thread++)
+        {
+            run.append(merged->callStacks[thread].mid(starts.value(thread)));
+        }
+        runs->append(run);
+    }
+
+    return true;
+}
+
+RunStatistics ComputeRunStatistics(const SymbolTable& symbols, const QVector<CallStack>& runs, bool withEmptyFiles, const ProfileAggregates& merged)
+{
+    QVector<ProfileAggregates> aggregates(runs.count());
+    QVector<int> indices(runs.count());
+    for (int i = 0; i < indices.count(); i++)
+    {
+        indices[i] = i;
+    }
+
+    ProfileAggregates* data = aggregates.data();
+    QtConcurrent::blockingMap(indices, [&symbols, &runs, withEmptyFiles, data](int& i)
+    {
+        ProfileAggregates& run = data[i];
+        run.sampleCount = AggregateProfile(symbols, runs[i], withEmptyFiles, run.flatThreads, run.callGraphThreads, run.fileProfile);
+    });
+
+    RunStatistics result;
+    result.runCount = runs.count();
+
+    // runs without thread or symbol have zero share of it
+    for (const FlatThread& thread : merged.flatThreads)
+    {
+        QVector<ShareSums> self(thread.second.count());
+        QVector<ShareSums> total(thread.second.count());
+
+        for (const ProfileAggregates& run : aggregates)
+        {
+            const FlatSymbols* flat = FindFlatThread(run.flatThreads, thread.first);
+            if (flat == nullptr || run.sampleCount == 0)
+            {
+                continue;
+            }
+
+            for (int id = 1; id < flat->count() && id < self.count(); id++)
+            {
+                self[id].add(100.0 * (*flat)[id].self / run.sampleCount);
+                total[id].add(100.0 * (*flat)[id].total / run.sampleCount);
+            }
+        }
+
+        result.flatSelf.insert(thread.first, ToStats(self, result.runCount));
+        result.flatTotal.insert(thread.first, ToStats(total, result.runCount));
+    }
+
+    // nodes of run call graph are found in merged graph by same path of (symbol, line) from root
+    for (const CallGraphThread& thread : merged.callGraphThreads)
+    {
+        const CallGraph& graph = thread.second;
+
+        QHash<QPair<uint32_t, uint64_t>, uint32_t> childs;
+        for (uint32_t parent = 0; parent < static_cast<uint32_t>(graph.count()); parent++)
+        {
+            for (uint32_t index = graph[parent].child; index != 0; index = graph[index].next)
+            {
+                childs.insert(qMakePair(parent, (uint64_t(graph[index].symbol) << 32) | graph[index].line), index);
+            }
+        }
+
+        QVector<ShareSums> self(graph.count());
+        QVector<ShareSums> total(graph.count());
+
+        for (const ProfileAggregates& run : aggregates)
+        {
+            const CallGraph* runGraph = FindCallGraphThread(run.callGraphThreads, thread.first);
+            if (runGraph == nullptr || run.sampleCount == 0)
+            {
+                continue;
+            }
+
+            // (node of run graph, node of merged graph)
+            QVector<QPair<uint32_t, uint32_t>> stack;
+            stack.append(qMakePair(0U, 0U));
+            while (!stack.isEmpty())
+            {
+                QPair<uint32_t, uint32_t> nodes = stack.takeLast();
+                for (uint32_t index = (*runGraph)[nodes.first].child; index != 0; index = (*runGraph)[index].next)
+                {
+                    const CallGraphNode& node = (*runGraph)[index];
+
+                    auto it = childs.constFind(qMakePair(nodes.second, (uint64_t(node.symbol) << 32) | node.line));
+                    if (it != childs.constEnd())
+                    {
+                        self[it.value()].add(100.0 * node.self / run.sampleCount);
+                        total[it.value()].add(100.0 * node.total / run.sampleCount);
+                        stack.append(qMakePair(index, it.value()));
+                    }
+                }
+            }
+        }
+
+        result.callGraphSelf.insert(thread.first, ToStats(self, result.runCount));
+        result.callGraphTotal.insert(thread.first, ToStats(total, result.runCount));
+    }
+
+    return result;
+}
+
+bool IsNoisyShare(const ShareStats& stats, double threshold)
+{
+    return stats.mean > 0 && stats.deviation > stats.mean * threshold / 100.0;
+}
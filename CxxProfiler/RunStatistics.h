@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Precompiled.h"
+#include "ProfileData.h"
+
+// share of samples over several runs, in percent of samples of each run
+struct ShareStats
+{
+    double mean = 0;
+    double deviation = 0;  // sample standard deviation
+    double confidence = 0; // half width of 95% confidence interval of mean
+};
+
+// statistics for views of merged runs, threads are matched by name
+struct RunStatistics
+{
+    int runCount = 0;
+
+    // indexed by symbol id
+    QHash<QString, QVector<ShareStats>> flatSelf;
+    QHash<QString, QVector<ShareStats>> flatTotal;
+
+    // indexed by node of merged call graph
+    QHash<QString, QVector<ShareStats>> callGraphSelf;
+    QHash<QString, QVector<ShareStats>> callGraphTotal;
+};
+
+// Reads runs of same workload. Merged profile contains all of them, call stacks
+// of each run are returned separately with symbol ids of merged profile.
+bool LoadProfileRuns(const QStringList& fileNames, uint32_t* pointerSize, ProfileData* merged, QVector<CallStack>* runs, QString* error);
+
+// every run is aggregated on its own in parallel, its shares are matched to views of merged profile
+RunStatistics ComputeRunStatistics(const SymbolTable& symbols, const QVector<CallStack>& runs, bool withEmptyFiles, const ProfileAggregates& merged);
+
+// share is noisy when its deviation is larger than threshold percent of its mean
+bool IsNoisyShare(const ShareStats& stats, double threshold);
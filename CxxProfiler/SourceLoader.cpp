@@ -22,13 +22,13 @@ SourceLoader::~SourceLoader()
 {
 }
 
-SymbolPtr SourceLoader::findSymbol(const QString& fname, int line) const
+uint32_t SourceLoader::findSymbol(const QString& fname, int line) const
 {
     auto& samples = fileProfile[fname];
     auto it = samples.lineToSymbol.find(line);
     if (it == samples.lineToSymbol.end())
     {
-        return SymbolPtr();
+        return 0;
     }
     else
     {
@@ -21,7 +21,7 @@ public:
 
     QFuture<LoadResult> load(const QString& fname, int lineFrom, int lineTo);
 
-    SymbolPtr findSymbol(const QString& fname, int line) const;
+    uint32_t findSymbol(const QString& fname, int line) const;
 
 private:
     uint32_t totalSamples;
@@ -0,0 +1,317 @@
+#include "Export.h"
+
+namespace
+{
+    const int SQL_BATCH_SIZE = 10000;
+
+    // symbol names, files & module names are string ids, module_id is set only for symbols that can be re-symbolized
+    const char* const SqlTables[] =
+    {
+        "CREATE TABLE strings (id INTEGER PRIMARY KEY, value TEXT)",
+        "CREATE TABLE modules (id INTEGER PRIMARY KEY, name TEXT, timestamp INTEGER, image_size INTEGER, base INTEGER, pdb_name TEXT, pdb_key TEXT)",
+        "CREATE TABLE symbols (id INTEGER PRIMARY KEY, address INTEGER, size INTEGER, name_id INTEGER, file_id INTEGER, module_name_id INTEGER, module_id INTEGER, line INTEGER, line_last INTEGER, flags INTEGER)",
+        "CREATE TABLE threads (id INTEGER PRIMARY KEY, name TEXT)",
+        "CREATE TABLE stacks (id INTEGER PRIMARY KEY, depth INTEGER)",
+        "CREATE TABLE stack_frames (stack_id INTEGER, depth INTEGER, symbol_id INTEGER, line INTEGER, offset INTEGER)",
+        "CREATE TABLE samples (id INTEGER PRIMARY KEY, thread_id INTEGER, stack_id INTEGER, time INTEGER, count INTEGER)",
+    };
+
+    // created after bulk load, so inserts don't need to update them
+    const char* const SqlIndexes[] =
+    {
+        "CREATE INDEX symbols_name ON symbols (name_id)",
+        "CREATE INDEX stack_frames_stack ON stack_frames (stack_id, depth)",
+        "CREATE INDEX stack_frames_symbol ON stack_frames (symbol_id)",
+        "CREATE INDEX samples_thread ON samples (thread_id)",
+        "CREATE INDEX samples_stack ON samples (stack_id)",
+    };
+
+    // rows are collected per column and inserted with one prepared statement execution per batch
+    class SqlBatch
+    {
+    public:
+        SqlBatch(const QSqlDatabase& db, const QString& table, int columnCount)
+            : mQuery(db)
+            , mColumns(columnCount)
+            , mRows(0)
+        {
+            QStringList values;
+            for (int i = 0; i < columnCount; i++)
+            {
+                values.append("?");
+            }
+            mPrepared = mQuery.prepare(QString("INSERT INTO %1 VALUES (%2)").arg(table).arg(values.join(',')));
+        }
+
+        bool add(const QVariantList& row)
+        {
+            for (int i = 0; i < mColumns.count(); i++)
+            {
+                mColumns[i].append(row[i]);
+            }
+            return mPrepared && (++mRows < SQL_BATCH_SIZE || flush());
+        }
+
+        bool flush()
+        {
+            if (!mPrepared)
+            {
+                return false;
+            }
+            if (mRows == 0)
+            {
+                return true;
+            }
+
+            for (QVariantList& column : mColumns)
+            {
+                mQuery.addBindValue(column);
+                column.clear();
+            }
+            mRows = 0;
+            return mQuery.execBatch();
+        }
+
+        QString errorString() const
+        {
+            return mQuery.lastError().text();
+        }
+
+    private:
+        QSqlQuery mQuery;
+        QVector<QVariantList> mColumns;
+        int mRows;
+        bool mPrepared;
+
+        Q_DISABLE_COPY(SqlBatch)
+    };
+
+    QVariant SqlInteger(uint64_t value)
+    {
+        // SQLite driver binds only signed 64-bit integers as numbers
+        return QVariant(static_cast<qlonglong>(value));
+    }
+
+    bool ExecuteSql(QSqlDatabase& db, const QString& sql, QString* error)
+    {
+        QSqlQuery query(db);
+        if (!query.exec(sql))
+        {
+            *error = query.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    bool WriteSqlite(QSqlDatabase& db, const ProfileData& profile, QString* error)
+    {
+        // file is written from scratch, journal is not needed
+        if (!ExecuteSql(db, "PRAGMA journal_mode = OFF", error) ||
+            !ExecuteSql(db, "PRAGMA synchronous = OFF", error))
+        {
+            return false;
+        }
+
+        for (const char* sql : SqlTables)
+        {
+            if (!ExecuteSql(db, sql, error))
+            {
+                return false;
+            }
+        }
+
+        if (!db.transaction())
+        {
+            *error = db.lastError().text();
+            return false;
+        }
+
+        const SymbolTable& symbols = profile.symbols;
+
+        {
+            SqlBatch strings(db, "strings", 2);
+            for (int i = 0; i < symbols.stringCount(); i++)
+            {
+                if (!strings.add({ i, symbols.getString(i) }))
+                {
+                    *error = strings.errorString();
+                    return false;
+                }
+            }
+            if (!strings.flush())
+            {
+                *error = strings.errorString();
+                return false;
+            }
+        }
+
+        {
+            SqlBatch modules(db, "modules", 7);
+            for (int i = 0; i < profile.modules.count(); i++)
+            {
+                const ProfileModule& module = profile.modules[i];
+                if (!modules.add({ i + 1, module.name, module.timestamp, module.imageSize, SqlInteger(module.base), module.pdbName, module.pdbKey }))
+                {
+                    *error = modules.errorString();
+                    return false;
+                }
+            }
+            if (!modules.flush())
+            {
+                *error = modules.errorString();
+                return false;
+            }
+        }
+
+        {
+            SqlBatch rows(db, "symbols", 10);
+            for (int id = 1; id < symbols.count(); id++)
+            {
+                const Symbol& symbol = symbols[id];
+                uint32_t module = profile.symbolModules.value(id);
+                if (!rows.add({ id, SqlInteger(symbol.address), symbol.size, symbol.name, symbol.file, symbol.module,
+                    module != 0 ? QVariant(module) : QVariant(QVariant::UInt), symbol.line, symbol.lineLast, symbol.flags }))
+                {
+                    *error = rows.errorString();
+                    return false;
+                }
+            }
+            if (!rows.flush())
+            {
+                *error = rows.errorString();
+                return false;
+            }
+        }
+
+        {
+            SqlBatch threads(db, "threads", 2);
+            SqlBatch stacks(db, "stacks", 2);
+            SqlBatch frames(db, "stack_frames", 5);
+            SqlBatch samples(db, "samples", 5);
+
+            auto failed = [&](const SqlBatch& batch) -> bool
+            {
+                *error = batch.errorString();
+                return false;
+            };
+
+            // identical stacks are stored once, key is raw bytes of their entries
+            QHash<QByteArray, uint32_t> stackIds;
+            uint64_t sampleId = 0;
+
+            for (int thread = 0; thread < profile.callStacks.count(); thread++)
+            {
+                if (!threads.add({ thread, GetThreadName(thread) }))
+                {
+                    return failed(threads);
+                }
+
+                const ThreadCallStack& callStack = profile.callStacks[thread];
+                const QVector<uint64_t> times = profile.sampleTimes.value(thread);
+
+                int sample = 0;
+                int first = 0;
+                for (int i = 0; i < callStack.count(); i++)
+                {
+                    if (callStack[i].symbol != 0)
+                    {
+                        continue;
+                    }
+
+                    QByteArray key(reinterpret_cast<const char*>(callStack.constData() + first), static_cast<int>((i - first) * sizeof(CallStackEntry)));
+
+                    auto it = stackIds.constFind(key);
+                    if (it == stackIds.constEnd())
+                    {
+                        uint32_t stackId = stackIds.count() + 1;
+                        it = stackIds.insert(key, stackId);
+
+                        if (!stacks.add({ stackId, i - first }))
+                        {
+                            return failed(stacks);
+                        }
+                        for (int k = first; k < i; k++)
+                        {
+                            const CallStackEntry& entry = callStack[k];
+                            if (!frames.add({ stackId, k - first, entry.symbol, entry.line, entry.offset }))
+                            {
+                                return failed(frames);
+                            }
+                        }
+                    }
+
+                    QVariant time = sample < times.count() ? SqlInteger(times[sample]) : QVariant(QVariant::LongLong);
+                    if (!samples.add({ SqlInteger(++sampleId), thread, it.value(), time, SampleWeight(callStack[i]) }))
+                    {
+                        return failed(samples);
+                    }
+
+                    sample++;
+                    first = i + 1;
+                }
+            }
+
+            for (SqlBatch* batch : { &threads, &stacks, &frames, &samples })
+            {
+                if (!batch->flush())
+                {
+                    return failed(*batch);
+                }
+            }
+        }
+
+        for (const char* sql : SqlIndexes)
+        {
+            if (!ExecuteSql(db, sql, error))
+            {
+                return false;
+            }
+        }
+
+        if (!db.commit())
+        {
+            *error = db.lastError().text();
+            return false;
+        }
+        return true;
+    }
+}
+
+bool ExportSqlite(const QString& fileName, const ProfileData& profile, QString* error)
+{
+    if (QFile::exists(fileName) && !QFile::remove(fileName))
+    {
+        *error = "Cannot overwrite existing file";
+        return false;
+    }
+
+    // connection must not be used anymore when it is removed
+    QString connection = QString("CxxProfilerExport%1").arg(reinterpret_cast<quintptr>(&profile));
+    bool result;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(fileName);
+
+        if (!db.open())
+        {
+            *error = db.lastError().text();
+            result = false;
+        }
+        else
+        {
+            result = WriteSqlite(db, profile, error);
+            if (!result)
+            {
+                db.rollback();
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+
+    if (!result)
+    {
+        QFile::remove(fileName);
+    }
+    return result;
+}
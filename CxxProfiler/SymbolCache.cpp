@@ -1,6 +1,256 @@
 #include "SymbolCache.h"
 
-SymbolCache::SymbolCache()
+namespace
 {
+    const char SYMBOL_CACHE_ID[4] = { 'C', 'X', 'X', 'S' };
+    const uint32_t SYMBOL_CACHE_VERSION = 2; // names are stored decorated since version 2
 }
 
+SymbolCache::SymbolCache(const QString& folder, const QString& moduleName, uint32_t timestamp, uint32_t imageSize)
+    : mTimestamp(timestamp)
+    , mImageSize(imageSize)
+{
+    QString identity = QString("%1%2").arg(timestamp, 8, 16, QChar('0')).arg(imageSize, 0, 16).toUpper();
+    mFile.setFileName(QDir(folder).filePath(QString("%1-%2.cache").arg(moduleName).arg(identity)));
+
+    open();
+}
+
+SymbolCache::~SymbolCache()
+{
+    close();
+}
+
+bool SymbolCache::isLoaded() const
+{
+    return mData != nullptr;
+}
+
+bool SymbolCache::hasChanges() const
+{
+    return !mNewFunctions.isEmpty();
+}
+
+const CachedFunction* SymbolCache::findFunction(uint32_t rva) const
+{
+    const CachedFunction* it = std::upper_bound(mFunctions, mFunctions + mFunctionCount, rva, [](uint32_t value, const CachedFunction& function)
+    {
+        return value < function.rva;
+    });
+    if (it != mFunctions)
+    {
+        --it;
+        if (rva - it->rva < it->size)
+        {
+            return it;
+        }
+    }
+
+    return nullptr;
+}
+
+CachedLines SymbolCache::getLines(const CachedFunction* function) const
+{
+    CachedLines lines;
+    if (uint64_t(function->firstLine) + function->lineCount <= mLineCount)
+    {
+        lines.reserve(function->lineCount);
+        for (uint32_t i = 0; i < function->lineCount; i++)
+        {
+            lines.append(mLines[function->firstLine + i]);
+        }
+    }
+    return lines;
+}
+
+QString SymbolCache::getString(uint32_t offset) const
+{
+    if (offset >= mStringsSize)
+    {
+        return QString();
+    }
+
+    return QString::fromUtf8(mStrings + offset);
+}
+
+void SymbolCache::addFunction(uint32_t rva, uint32_t size, const QString& name, const QString& file, uint32_t line, uint32_t lineLast, const CachedLines& lines)
+{
+    NewFunction function;
+    function.function.rva = rva;
+    function.function.size = size;
+    function.function.name = 0;
+    function.function.file = 0;
+    function.function.line = line;
+    function.function.lineLast = lineLast;
+    function.function.firstLine = 0;
+    function.function.lineCount = 0;
+    function.name = name.toUtf8();
+    function.file = file.toUtf8();
+    function.lines = lines;
+    mNewFunctions.append(function);
+}
+
+bool SymbolCache::save()
+{
+    QVector<NewFunction> functions;
+    functions.reserve(mFunctionCount + mNewFunctions.count());
+
+    // old records must be copied out before mapped file is replaced
+    for (uint32_t i = 0; i < mFunctionCount; i++)
+    {
+        const CachedFunction& cached = mFunctions[i];
+
+        NewFunction function;
+        function.function = cached;
+        function.name = QByteArray(cached.name < mStringsSize ? mStrings + cached.name : "");
+        function.file = QByteArray(cached.file < mStringsSize ? mStrings + cached.file : "");
+        function.lines = getLines(&cached);
+        functions.append(function);
+    }
+    functions += mNewFunctions;
+
+    std::stable_sort(functions.begin(), functions.end(), [](const NewFunction& a, const NewFunction& b)
+    {
+        return a.function.rva < b.function.rva;
+    });
+
+    QByteArray strings(1, '\0');
+    QHash<QByteArray, uint32_t> stringOffsets;
+    stringOffsets.insert(QByteArray(), 0);
+
+    QVector<CachedFunction> records;
+    CachedLines lines;
+    records.reserve(functions.count());
+
+    for (const NewFunction& function : functions)
+    {
+        if (!records.isEmpty() && records.last().rva == function.function.rva)
+        {
+            continue;
+        }
+
+        CachedFunction record = function.function;
+
+        auto name = stringOffsets.find(function.name);
+        if (name == stringOffsets.end())
+        {
+            name = stringOffsets.insert(function.name, strings.size());
+            strings.append(function.name).append('\0');
+        }
+        record.name = name.value();
+
+        auto file = stringOffsets.find(function.file);
+        if (file == stringOffsets.end())
+        {
+            file = stringOffsets.insert(function.file, strings.size());
+            strings.append(function.file).append('\0');
+        }
+        record.file = file.value();
+
+        record.firstLine = lines.count();
+        record.lineCount = function.lines.count();
+        lines += function.lines;
+
+        records.append(record);
+    }
+
+    close();
+
+    QDir().mkpath(QFileInfo(mFile).path());
+
+    QSaveFile file(mFile.fileName());
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    SymbolCacheHeader header;
+    memcpy(header.id, SYMBOL_CACHE_ID, sizeof(header.id));
+    header.version = SYMBOL_CACHE_VERSION;
+    header.timestamp = mTimestamp;
+    header.imageSize = mImageSize;
+    header.functionCount = records.count();
+    header.lineCount = lines.count();
+    header.stringsSize = strings.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.constData()), records.count() * sizeof(CachedFunction));
+    file.write(reinterpret_cast<const char*>(lines.constData()), lines.count() * sizeof(CachedLine));
+    file.write(strings);
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    mNewFunctions.clear();
+    return open();
+}
+
+bool SymbolCache::open()
+{
+    if (!mFile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 size = mFile.size();
+    if (size < qint64(sizeof(SymbolCacheHeader)))
+    {
+        close();
+        return false;
+    }
+
+    mData = mFile.map(0, size);
+    if (mData == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    const SymbolCacheHeader* header = reinterpret_cast<const SymbolCacheHeader*>(mData);
+
+    uint64_t expectedSize = sizeof(SymbolCacheHeader)
+        + uint64_t(header->functionCount) * sizeof(CachedFunction)
+        + uint64_t(header->lineCount) * sizeof(CachedLine)
+        + header->stringsSize;
+
+    if (memcmp(header->id, SYMBOL_CACHE_ID, sizeof(header->id)) != 0
+      || header->version != SYMBOL_CACHE_VERSION
+      || header->timestamp != mTimestamp
+      || header->imageSize != mImageSize
+      || header->stringsSize == 0
+      || expectedSize != uint64_t(size)
+      || mData[size - 1] != 0)
+    {
+        close();
+        return false;
+    }
+
+    mFunctionCount = header->functionCount;
+    mLineCount = header->lineCount;
+    mStringsSize = header->stringsSize;
+
+    mFunctions = reinterpret_cast<const CachedFunction*>(mData + sizeof(SymbolCacheHeader));
+    mLines = reinterpret_cast<const CachedLine*>(mFunctions + mFunctionCount);
+    mStrings = reinterpret_cast<const char*>(mLines + mLineCount);
+
+    return true;
+}
+
+void SymbolCache::close()
+{
+    if (mData != nullptr)
+    {
+        mFile.unmap(const_cast<uchar*>(mData));
+    }
+    mFile.close();
+
+    mData = nullptr;
+    mFunctions = nullptr;
+    mLines = nullptr;
+    mStrings = nullptr;
+    mFunctionCount = 0;
+    mLineCount = 0;
+    mStringsSize = 0;
+}
@@ -2,15 +2,87 @@
 
 #include "Precompiled.h"
 
+// on-disk records, file layout is:
+// SymbolCacheHeader, CachedFunction[functionCount], CachedLine[lineCount], strings (utf-8, zero terminated)
 
+struct SymbolCacheHeader
+{
+    char id[4];
+    uint32_t version;
+    uint32_t timestamp;
+    uint32_t imageSize;
+    uint32_t functionCount;
+    uint32_t lineCount;
+    uint32_t stringsSize;
+};
+
+struct CachedFunction
+{
+    uint32_t rva;
+    uint32_t size;
+    uint32_t name;
+    uint32_t file;
+    uint32_t line;
+    uint32_t lineLast;
+    uint32_t firstLine;
+    uint32_t lineCount;
+};
+
+struct CachedLine
+{
+    uint32_t rva;
+    uint32_t line;
+};
+
+typedef QVector<CachedLine> CachedLines;
+
+// Persistent cache of resolved functions and their line tables for one module.
+// Module is identified by its name, PE timestamp and image size. Existing cache
+// file is memory mapped, newly resolved functions are collected and written
+// together with old ones when module is unloaded.
 class SymbolCache
 {
     Q_DISABLE_COPY(SymbolCache)
 
 public:
-    SymbolCache();
+    SymbolCache(const QString& folder, const QString& moduleName, uint32_t timestamp, uint32_t imageSize);
+    ~SymbolCache();
+
+    bool isLoaded() const;
+    bool hasChanges() const;
+
+    const CachedFunction* findFunction(uint32_t rva) const;
+    CachedLines getLines(const CachedFunction* function) const;
+    QString getString(uint32_t offset) const;
 
+    void addFunction(uint32_t rva, uint32_t size, const QString& name, const QString& file, uint32_t line, uint32_t lineLast, const CachedLines& lines);
+
+    bool save();
 
 private:
+    QFile mFile;
+    uint32_t mTimestamp;
+    uint32_t mImageSize;
+
+    const uchar* mData = nullptr;
+    const CachedFunction* mFunctions = nullptr;
+    const CachedLine* mLines = nullptr;
+    const char* mStrings = nullptr;
+    uint32_t mFunctionCount = 0;
+    uint32_t mLineCount = 0;
+    uint32_t mStringsSize = 0;
 
+    struct NewFunction
+    {
+        CachedFunction function;
+        QByteArray name;
+        QByteArray file;
+        CachedLines lines;
+    };
+    QVector<NewFunction> mNewFunctions;
+
+    bool open();
+    void close();
 };
+
+typedef QSharedPointer<SymbolCache> SymbolCachePtr;
@@ -0,0 +1,280 @@
+#include "SymbolStore.h"
+
+namespace
+{
+    const int FETCH_THREADS = 4;
+    const int DOWNLOAD_TIMEOUT_MS = 30 * 1000;
+    const qint64 PREFETCH_CHUNK = 1024 * 1024;
+
+    struct CodeViewRecord
+    {
+        DWORD signature;
+        GUID guid;
+        DWORD age;
+    };
+
+    const DWORD CODEVIEW_RSDS = 0x53445352; // 'RSDS'
+
+    bool ReadAt(QFile& file, qint64 offset, void* data, qint64 size)
+    {
+        return file.seek(offset) && file.read(static_cast<char*>(data), size) == size;
+    }
+
+    // file offset of rva, if it is in one of sections
+    bool RvaToOffset(const QVector<IMAGE_SECTION_HEADER>& sections, DWORD rva, DWORD* offset)
+    {
+        for (const IMAGE_SECTION_HEADER& section : sections)
+        {
+            DWORD size = qMax(section.Misc.VirtualSize, section.SizeOfRawData);
+            if (rva >= section.VirtualAddress && rva - section.VirtualAddress < size)
+            {
+                *offset = rva - section.VirtualAddress + section.PointerToRawData;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // reading whole file brings it to OS file cache, dbghelp later loads it from memory
+    void Prefetch(const QString& path)
+    {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly))
+        {
+            QByteArray buffer(static_cast<int>(PREFETCH_CHUNK), Qt::Uninitialized);
+            while (file.read(buffer.data(), buffer.size()) > 0)
+            {
+            }
+        }
+    }
+}
+
+bool ReadPdbIdentity(const QString& imagePath, PdbIdentity* identity)
+{
+    QFile file(imagePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    IMAGE_DOS_HEADER dos;
+    if (!ReadAt(file, 0, &dos, sizeof(dos)) || dos.e_magic != IMAGE_DOS_SIGNATURE)
+    {
+        return false;
+    }
+
+    DWORD signature;
+    IMAGE_FILE_HEADER header;
+    WORD magic;
+    qint64 offset = dos.e_lfanew;
+    if (!ReadAt(file, offset, &signature, sizeof(signature))
+      || signature != IMAGE_NT_SIGNATURE
+      || !ReadAt(file, offset + sizeof(signature), &header, sizeof(header))
+      || !ReadAt(file, offset + sizeof(signature) + sizeof(header), &magic, sizeof(magic)))
+    {
+        return false;
+    }
+    offset += sizeof(signature) + sizeof(header);
+
+    IMAGE_DATA_DIRECTORY debug;
+    if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+    {
+        IMAGE_OPTIONAL_HEADER32 optional;
+        if (header.SizeOfOptionalHeader < sizeof(optional) || !ReadAt(file, offset, &optional, sizeof(optional)))
+        {
+            return false;
+        }
+        debug = optional.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+    }
+    else if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    {
+        IMAGE_OPTIONAL_HEADER64 optional;
+        if (header.SizeOfOptionalHeader < sizeof(optional) || !ReadAt(file, offset, &optional, sizeof(optional)))
+        {
+            return false;
+        }
+        debug = optional.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+    }
+    else
+    {
+        return false;
+    }
+    offset += header.SizeOfOptionalHeader;
+
+    QVector<IMAGE_SECTION_HEADER> sections(header.NumberOfSections);
+    if (!ReadAt(file, offset, sections.data(), sections.count() * sizeof(IMAGE_SECTION_HEADER)))
+    {
+        return false;
+    }
+
+    DWORD debugOffset;
+    if (debug.Size == 0 || !RvaToOffset(sections, debug.VirtualAddress, &debugOffset))
+    {
+        return false;
+    }
+
+    for (DWORD i = 0; i < debug.Size / sizeof(IMAGE_DEBUG_DIRECTORY); i++)
+    {
+        IMAGE_DEBUG_DIRECTORY entry;
+        if (!ReadAt(file, debugOffset + i * sizeof(entry), &entry, sizeof(entry)))
+        {
+            return false;
+        }
+
+        CodeViewRecord record;
+        if (entry.Type != IMAGE_DEBUG_TYPE_CODEVIEW
+          || entry.SizeOfData <= sizeof(record)
+          || !ReadAt(file, entry.PointerToRawData, &record, sizeof(record))
+          || record.signature != CODEVIEW_RSDS)
+        {
+            continue;
+        }
+
+        QByteArray path(static_cast<int>(entry.SizeOfData - sizeof(record)), '\0');
+        if (!ReadAt(file, entry.PointerToRawData + sizeof(record), path.data(), path.size()))
+        {
+            return false;
+        }
+
+        const GUID& guid = record.guid;
+        identity->path = QString::fromUtf8(path.constData());
+        identity->name = QFileInfo(QDir::fromNativeSeparators(identity->path)).fileName();
+        identity->key = QString("%1%2%3").arg(guid.Data1, 8, 16, QChar('0')).arg(guid.Data2, 4, 16, QChar('0')).arg(guid.Data3, 4, 16, QChar('0'));
+        for (int k = 0; k < 8; k++)
+        {
+            identity->key += QString("%1").arg(uint(guid.Data4[k]), 2, 16, QChar('0'));
+        }
+        identity->key = (identity->key + QString::number(record.age, 16)).toUpper();
+        return !identity->name.isEmpty();
+    }
+
+    return false;
+}
+
+SymbolStore::SymbolStore(const QString& store, const QString& downloadFolder)
+    : mStore(store)
+    , mDownloadFolder(downloadFolder)
+{
+    mIsUrl = store.startsWith("http://", Qt::CaseInsensitive) || store.startsWith("https://", Qt::CaseInsensitive);
+    if (mIsUrl && mStore.endsWith('/'))
+    {
+        mStore.chop(1);
+    }
+
+    mPool.setMaxThreadCount(FETCH_THREADS);
+}
+
+SymbolStore::~SymbolStore()
+{
+    mPool.waitForDone();
+}
+
+QFuture<QString> SymbolStore::fetch(const QString& imagePath)
+{
+    return QtConcurrent::run(&mPool, [this, imagePath]()
+    {
+        PdbIdentity identity;
+        if (!ReadPdbIdentity(imagePath, &identity))
+        {
+            return QString();
+        }
+        return fetchPdb(identity, QFileInfo(imagePath).path());
+    });
+}
+
+QString SymbolStore::fetchPdb(const PdbIdentity& identity, const QString& imageFolder) const
+{
+    QString layout = QString("%1/%2/%1").arg(identity.name).arg(identity.key);
+
+    // exact matches from stores first, then where pdb was built or next to image
+    QStringList candidates;
+    if (!mStore.isEmpty() && !mIsUrl)
+    {
+        candidates << QDir(mStore).filePath(layout);
+    }
+    candidates << QDir(mDownloadFolder).filePath(layout);
+    if (!mStore.isEmpty() && !mIsUrl)
+    {
+        candidates << QDir(mStore).filePath(identity.name);
+    }
+    if (!identity.path.isEmpty())
+    {
+        candidates << identity.path;
+    }
+    if (!imageFolder.isEmpty())
+    {
+        candidates << QDir(imageFolder).filePath(identity.name);
+    }
+
+    QString found;
+    for (const QString& candidate : candidates)
+    {
+        if (QFileInfo(candidate).isFile())
+        {
+            found = candidate;
+            break;
+        }
+    }
+
+    if (found.isEmpty() && mIsUrl)
+    {
+        QString target = QDir(mDownloadFolder).filePath(layout);
+        if (download(mStore + "/" + layout, target))
+        {
+            found = target;
+        }
+    }
+
+    if (!found.isEmpty())
+    {
+        Prefetch(found);
+    }
+    return found;
+}
+
+bool SymbolStore::download(const QString& url, const QString& target) const
+{
+    QDir().mkpath(QFileInfo(target).path());
+
+    QSaveFile file(target);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    // pool thread has no event loop of its own, request runs in local one
+    QNetworkAccessManager manager;
+    QEventLoop loop;
+
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    request.setRawHeader("User-Agent", "Microsoft-Symbol-Server/10.0.0.0");
+
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    timeout.setInterval(DOWNLOAD_TIMEOUT_MS);
+
+    QNetworkReply* reply = manager.get(request);
+    QObject::connect(reply, &QNetworkReply::readyRead, &loop, [&]()
+    {
+        file.write(reply->readAll());
+        timeout.start();
+    });
+    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&timeout, &QTimer::timeout, reply, &QNetworkReply::abort);
+
+    timeout.start();
+    loop.exec();
+
+    file.write(reply->readAll());
+    bool ok = reply->error() == QNetworkReply::NoError
+        && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200;
+    delete reply;
+
+    if (!ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
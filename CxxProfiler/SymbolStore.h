@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Precompiled.h"
+
+// identity of pdb file from CodeView (RSDS) record in image debug directory
+struct PdbIdentity
+{
+    QString path;
+    QString name;
+    QString key; // guid & age as used in symbol store layout
+};
+
+bool ReadPdbIdentity(const QString& imagePath, PdbIdentity* identity);
+
+// Fetches pdb files of modules in background, so sampling thread is not blocked
+// while they are located or downloaded. Store is local folder or http(s) url in
+// symbol server layout (name.pdb/KEY/name.pdb). Downloaded files are kept in
+// download folder with same layout. Only files are fetched here, dbghelp itself
+// is not thread safe and it loads them later on sampling thread.
+class SymbolStore
+{
+    Q_DISABLE_COPY(SymbolStore)
+
+public:
+    SymbolStore(const QString& store, const QString& downloadFolder);
+    ~SymbolStore();
+
+    // result is local path of pdb, or empty string if it was not found
+    QFuture<QString> fetch(const QString& imagePath);
+
+    // same as fetch, but blocks calling thread, image folder is optional
+    QString fetchPdb(const PdbIdentity& identity, const QString& imageFolder) const;
+
+private:
+    QString mStore;
+    QString mDownloadFolder;
+    bool mIsUrl;
+
+    // must be last, destructor waits for running fetches
+    QThreadPool mPool;
+
+    bool download(const QString& url, const QString& target) const;
+};
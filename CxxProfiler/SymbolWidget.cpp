@@ -2,6 +2,24 @@
 #include "Utils.h"
 #include "Symbols.h"
 
+namespace
+{
+    QString FormatShare(const ShareStats& stats)
+    {
+        return QString("%1 %2 %3").arg(stats.mean, 0, 'f', 2).arg(QChar(0x00B1)).arg(stats.confidence, 0, 'f', 2);
+    }
+
+    QString DescribeShare(const ShareStats& stats, int runCount)
+    {
+        return QString("Mean %1%, standard deviation %2%, 95% confidence interval %3% to %4% over %5 runs")
+            .arg(stats.mean, 0, 'f', 2)
+            .arg(stats.deviation, 0, 'f', 2)
+            .arg(qMax(stats.mean - stats.confidence, 0.0), 0, 'f', 2)
+            .arg(stats.mean + stats.confidence, 0, 'f', 2)
+            .arg(runCount);
+    }
+}
+
 ThreadItem::ThreadItem(const QString& name)
     : mName(name)
 {
@@ -17,8 +35,9 @@ QVariant ThreadItem::data(int column, int role) const
     return QTreeWidgetItem::data(column, role);
 }
 
-SymbolItem::SymbolItem(const SymbolPtr& symbol, const QString& file, uint32_t line, uint32_t self, uint32_t total, uint32_t all)
-    : mSymbol(symbol)
+SymbolItem::SymbolItem(const SymbolTablePtr& symbols, uint32_t symbol, const QString& file, uint32_t line, uint32_t self, uint32_t total, uint32_t all)
+    : mSymbols(symbols)
+    , mSymbol(symbol)
     , mFile(file)
     , mLine(line)
     , mSelf(self)
@@ -49,17 +68,17 @@ const QString& SymbolItem::getFilename() const
 
 const QString& SymbolItem::getDefinitionFilename() const
 {
-    return mSymbol->file;
+    return mSymbols->getFile(mSymbol);
 }
 
 uint32_t SymbolItem::getDefinitionLine() const
 {
-    return mSymbol->line;
+    return (*mSymbols)[mSymbol].line;
 }
 
 uint32_t SymbolItem::getDefinitionLineLast() const
 {
-    return mSymbol->lineLast;
+    return (*mSymbols)[mSymbol].lineLast;
 }
 
 uint32_t SymbolItem::getLine() const
@@ -74,21 +93,40 @@ QVariant SymbolItem::data(int column, int role) const
         switch (column)
         {
         case 0:
-            return mSymbol->name;
+            return mSymbols->getDisplayName(mSymbol);
         case 1:
             return mSelf;
         case 2:
             return mTotal;
         case 3:
-            return QString::number(100.0 * mSelf / mAll, 'f', 2);
+            return mRunCount != 0 ? FormatShare(mSelfStats) : QString::number(100.0 * mSelf / mAll, 'f', 2);
         case 4:
-            return QString::number(100.0 * mTotal / mAll, 'f', 2);
+            return mRunCount != 0 ? FormatShare(mTotalStats) : QString::number(100.0 * mTotal / mAll, 'f', 2);
         case 5:
-            return mSymbol->module;
+            return mSymbols->getModule(mSymbol);
         case 6:
             return mLine == 0 || mLine == ~0U ? mFile : QString("%1:%2").arg(mFile).arg(mLine);
         }
     }
+    else if (role == Qt::ForegroundRole && ((*mSymbols)[mSymbol].flags & SYMBOL_UNRESOLVED) != 0)
+    {
+        return QBrush(Qt::gray);
+    }
+    else if (role == Qt::ForegroundRole && mNoisy)
+    {
+        return QBrush(Qt::darkYellow);
+    }
+    else if (role == Qt::ToolTipRole && mRunCount != 0 && (column == 3 || column == 4))
+    {
+        QString text = DescribeShare(column == 3 ? mSelfStats : mTotalStats, mRunCount);
+        return mNoisy ? text + "\nShare varies between runs more than threshold" : text;
+    }
+    else if (role == Qt::FontRole && column == 0 && ((*mSymbols)[mSymbol].flags & SYMBOL_INLINE) != 0)
+    {
+        QFont font;
+        font.setItalic(true);
+        return font;
+    }
 
     return QTreeWidgetItem::data(column, role);
 }
@@ -118,7 +156,7 @@ bool SymbolItem::operator < (const QTreeWidgetItem& otherItem) const
         break;
 
     case 5:
-        cmp = QString::compare(mSymbol->module, other.mSymbol->module, Qt::CaseInsensitive);
+        cmp = QString::compare(mSymbols->getModule(mSymbol), other.mSymbols->getModule(other.mSymbol), Qt::CaseInsensitive);
         break;
 
     case 6:
@@ -132,12 +170,20 @@ bool SymbolItem::operator < (const QTreeWidgetItem& otherItem) const
 
     if (cmp == 0)
     {
-        cmp = QString::compare(mSymbol->name, other.mSymbol->name, Qt::CaseInsensitive);
+        cmp = QString::compare(mSymbols->getDisplayName(mSymbol), other.mSymbols->getDisplayName(other.mSymbol), Qt::CaseInsensitive);
     }
 
     return cmp < 0;
 }
 
+void SymbolItem::setShareStats(const ShareStats& self, const ShareStats& total, int runCount, bool noisy)
+{
+    mSelfStats = self;
+    mTotalStats = total;
+    mRunCount = runCount;
+    mNoisy = noisy;
+}
+
 SymbolWidget::SymbolWidget(QMenu* menu, QWidget* parent)
     : QWidget(parent)
     , mMenu(menu)
@@ -325,9 +371,9 @@ SymbolWidget::SymbolWidget(QMenu* menu, QWidget* parent)
 
             if (!changed)
             {
-                SymbolPtr symbol = mCodeLoader->findSymbol(mCodeLoaded.split('@')[0], line);
+                uint32_t symbol = mCodeLoader->findSymbol(mCodeLoaded.split('@')[0], line);
 
-                if (symbol && mSymbolToTreeItem.contains(symbol))
+                if (symbol != 0 && mSymbolToTreeItem.contains(symbol))
                 {
                     rememberInHistory();
                     ui.treeWidget->setCurrentItem(mSymbolToTreeItem[symbol]);
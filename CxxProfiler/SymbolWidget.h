@@ -3,11 +3,12 @@
 #include "Precompiled.h"
 #include "ui_SymbolWidget.h"
 #include "SourceLoader.h"
+#include "RunStatistics.h"
 
 class SourceViewer;
 
-struct Symbol;
-typedef QSharedPointer<Symbol> SymbolPtr;
+class SymbolTable;
+typedef QSharedPointer<SymbolTable> SymbolTablePtr;
 
 class ThreadItem : public QTreeWidgetItem
 {
@@ -19,12 +20,12 @@ private:
     QString mName;
 };
 
-typedef QHash<SymbolPtr, QTreeWidgetItem*> SymbolToTreeItem;
+typedef QHash<uint32_t, QTreeWidgetItem*> SymbolToTreeItem;
 
 class SymbolItem : public QTreeWidgetItem
 {
 public:
-    explicit SymbolItem(const SymbolPtr& symbol, const QString& file, uint32_t line, uint32_t self, uint32_t total, uint32_t all);
+    explicit SymbolItem(const SymbolTablePtr& symbols, uint32_t symbol, const QString& file, uint32_t line, uint32_t self, uint32_t total, uint32_t all);
 
     void exploreToFile() const;
     void openVSFile() const;
@@ -37,14 +38,23 @@ public:
     QVariant data(int column, int role) const;
     bool operator < (const QTreeWidgetItem& otherItem) const;
 
+    // percents show mean share over runs with its confidence interval instead of share of all samples
+    void setShareStats(const ShareStats& self, const ShareStats& total, int runCount, bool noisy);
+
 private:
-    SymbolPtr mSymbol;
+    SymbolTablePtr mSymbols;
+    uint32_t mSymbol;
     QString mFile;
     uint32_t mLine;
 
     uint32_t mSelf;
     uint32_t mTotal;
     uint32_t mAll;
+
+    ShareStats mSelfStats;
+    ShareStats mTotalStats;
+    int mRunCount = 0;
+    bool mNoisy = false;
 };
 
 class SymbolWidget : public QWidget
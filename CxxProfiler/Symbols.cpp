@@ -1,108 +1,148 @@
 #include "Symbols.h"
+#include "Demangler.h"
+#include "ProfileData.h"
 
-uint32_t CreateProfile(uint32_t pointerSize, bool withEmptyFiles, const QByteArray& data,
-    FlatThreads& flatThreads,
-    CallGraphThreads& callGraphThreads,
-    FileProfile& fileProfile)
+SymbolTable::SymbolTable()
 {
-    uint32_t sampleCount = 0;
-
-    QDataStream in(data);
+    // id 0 is empty string & no symbol
+    mStrings.append(QString());
+    mStringIds.insert(QString(), 0);
+    mSymbols.append(Symbol());
+}
 
-    // load strings
-    QVector<QString> strings;
+uint32_t SymbolTable::addString(const QString& string)
+{
+    auto it = mStringIds.constFind(string);
+    if (it != mStringIds.constEnd())
     {
-        uint32_t stringCount;
-        in >> stringCount;
-        strings.resize(stringCount + 1);
-        for (uint32_t i = 0; i<stringCount; i++)
-        {
-            uint32_t  index;
-            in >> index;
-            in >> strings[index];
-        }
+        return it.value();
     }
 
-    // load symbols
-    QVector<SymbolPtr> symbols;
-    {
-        uint32_t symbolCount;
-        in >> symbolCount;
-        symbols.resize(symbolCount + 1);
-        for (uint32_t i = 0; i<symbolCount; i++)
-        {
-            uint32_t index;
-            in >> index;
+    uint32_t id = mStrings.count();
+    mStrings.append(string);
+    mStringIds.insert(string, id);
+    return id;
+}
 
-            SymbolPtr& symbol = symbols[index] = SymbolPtr(new Symbol);
+const QString& SymbolTable::getString(uint32_t id) const
+{
+    return mStrings[id];
+}
 
-            in >> symbol->name;
+int SymbolTable::stringCount() const
+{
+    return mStrings.count();
+}
 
-            if (pointerSize == sizeof(uint32_t))
-            {
-                uint32_t address;
-                in >> address;
-                symbol->address = address;
-            }
-            else
-            {
-                in >> symbol->address;
-            }
-            in >> symbol->size;
+uint32_t SymbolTable::addSymbol(const Symbol& symbol)
+{
+    mSymbols.append(symbol);
+    return mSymbols.count() - 1;
+}
+
+int SymbolTable::count() const
+{
+    return mSymbols.count();
+}
 
-            in >> index;
-            symbol->module = strings[index];
+Symbol& SymbolTable::operator [] (uint32_t id)
+{
+    return mSymbols[id];
+}
 
-            in >> index;
-            symbol->file = strings[index];
+const Symbol& SymbolTable::operator [] (uint32_t id) const
+{
+    return mSymbols[id];
+}
 
-            in >> symbol->line >> symbol->lineLast;
-        }
+const QString& SymbolTable::getName(uint32_t id) const
+{
+    return mStrings[mSymbols[id].name];
+}
+
+const QString& SymbolTable::getFile(uint32_t id) const
+{
+    return mStrings[mSymbols[id].file];
+}
+
+const QString& SymbolTable::getModule(uint32_t id) const
+{
+    return mStrings[mSymbols[id].module];
+}
+
+const QString& SymbolTable::getDisplayName(uint32_t id) const
+{
+    uint32_t name = mSymbols[id].name;
+    const QString& string = mStrings[name];
+    if (!IsMangledName(string))
+    {
+        return string;
+    }
+
+    auto it = mDisplayNames.constFind(name);
+    if (it == mDisplayNames.constEnd())
+    {
+        it = mDisplayNames.insert(name, DemangleName(string));
     }
+    return it.value();
+}
+
+QString GetThreadName(uint32_t index)
+{
+    return index == 0 ? "Main Thread" : QString("Thread #%1").arg(index);
+}
+
+uint32_t CreateProfile(const ProfileData& profile, bool withEmptyFiles,
+    SymbolTable& symbolTable,
+    FlatThreads& flatThreads,
+    CallGraphThreads& callGraphThreads,
+    FileProfile& fileProfile,
+    SampleStats& stats)
+{
+    symbolTable = profile.symbols;
+    stats.lost = profile.lostSamples;
+    stats.unresolved = profile.unresolvedSamples;
+
+    return AggregateProfile(symbolTable, profile.callStacks, withEmptyFiles, flatThreads, callGraphThreads, fileProfile, &stats.hidden);
+}
+
+uint32_t AggregateProfile(const SymbolTable& symbolTable, const CallStack& threadCallStacks, bool withEmptyFiles,
+    FlatThreads& flatThreads,
+    CallGraphThreads& callGraphThreads,
+    FileProfile& fileProfile,
+    uint32_t* hiddenCount)
+{
+    uint32_t sampleCount = 0;
+    uint32_t hidden = 0;
 
-    // load threads
     {
-        uint32_t threadCount;
-        in >> threadCount;
+        uint32_t threadCount = threadCallStacks.count();
 
         flatThreads.reserve(threadCount);
         callGraphThreads.reserve(threadCount);
 
         for (uint32_t i = 0; i<threadCount; i++)
         {
-            QString threadName = (i == 0 ? "Main Thread" : QString("Thread #%1").arg(i));
+            QString threadName = GetThreadName(i);
 
-            uint32_t count;
-            in >> count;
+            QVector<ThreadCallStack> callStacks;
+            QVector<uint32_t> weights;
 
-            struct CallStackEntry
+            // split callstacks
             {
-                SymbolPtr symbol;
-                uint32_t line;
-                uint32_t offset;
-            };
-
-            typedef QVector<CallStackEntry> CallStack;
-            QVector<CallStack> callStacks;
-
-            // load callstacks
-            {
-                CallStack callStack;
+                ThreadCallStack callStack;
                 bool startingWithEmptyFile = true;
 
-                CallStackEntry lastEntryWithFile = {};
+                CallStackEntry lastEntryWithFile;
+                bool hasFrames = false;
 
-                for (uint32_t k = 0; k<count; k++)
+                for (const CallStackEntry& entry : threadCallStacks[i])
                 {
-                    CallStackEntry entry;
-                    uint32_t id;
-                    in >> id >> entry.line >> entry.offset;
-
-                    if (id == 0)
+                    if (entry.symbol == 0)
                     {
                         if (!withEmptyFiles)
                         {
-                            while (!callStack.isEmpty() && callStack.last().symbol->file.isEmpty())
+                            while (!callStack.isEmpty() && symbolTable.getFile(callStack.last().symbol).isEmpty())
                             {
                                 callStack.pop_back();
                             }
@@ -111,122 +151,142 @@ uint32_t CreateProfile(uint32_t pointerSize, bool withEmptyFiles, const QByteArr
                         if (!callStack.isEmpty())
                         {
                             callStacks.append(callStack);
+                            weights.append(SampleWeight(entry));
+                            sampleCount += SampleWeight(entry);
                             callStack.clear();
                         }
+                        else if (hasFrames)
+                        {
+                            hidden += SampleWeight(entry);
+                        }
                         startingWithEmptyFile = true;
+                        hasFrames = false;
                     }
                     else
                     {
-                        entry.symbol = symbols[id];
+                        hasFrames = true;
+                        bool emptyFile = symbolTable.getFile(entry.symbol).isEmpty();
 
-                        if (startingWithEmptyFile && entry.symbol->file.isEmpty())
+                        if (startingWithEmptyFile && emptyFile)
                         {
                             lastEntryWithFile = entry;
                         }
 
-                        if (startingWithEmptyFile && !entry.symbol->file.isEmpty())
+                        if (startingWithEmptyFile && !emptyFile)
                         {
                             startingWithEmptyFile = false;
                         }
 
                         if (!startingWithEmptyFile || startingWithEmptyFile && withEmptyFiles)
                         {
-                            if (lastEntryWithFile.symbol)
+                            if (lastEntryWithFile.symbol != 0)
                             {
                                 callStack.append(lastEntryWithFile);
-                                lastEntryWithFile = {};
+                                lastEntryWithFile = CallStackEntry();
                             }
                             callStack.append(entry);
                         }
                     }
                 }
-
-                sampleCount += callStacks.count();
             }
 
             // calculate flat profile
+            if (!callStacks.isEmpty())
             {
-                FlatSymbols flatSymbols;
+                FlatSymbols flatSymbols(symbolTable.count());
 
-                for (const CallStack& callStack : callStacks)
+                for (int sample = 0; sample < callStacks.count(); sample++)
                 {
-                    SymbolPtr symbol = callStack[0].symbol;
+                    const ThreadCallStack& callStack = callStacks[sample];
+                    uint32_t weight = weights[sample];
+                    uint32_t symbol = callStack[0].symbol;
 
-                    flatSymbols[symbol].self += 1;
-                    flatSymbols[symbol].total += 1;
+                    flatSymbols[symbol].self += weight;
+                    flatSymbols[symbol].total += weight;
 
-                    SymbolPtr prev = symbol;
+                    uint32_t prev = symbol;
 
                     for (int k = 1; k<callStack.count(); k++)
                     {
                         symbol = callStack[k].symbol;
                         if (prev != symbol)
                         {
-                            flatSymbols[symbol].total += 1;
+                            flatSymbols[symbol].total += weight;
                             prev = symbol;
                         }
                     }
                 }
 
-                if (!flatSymbols.isEmpty())
-                {
-                    flatThreads.append(FlatThread(threadName, flatSymbols));
-                }
+                flatThreads.append(FlatThread(threadName, flatSymbols));
             }
 
             // calculate call graph
             {
-                CallGraphSymbol root;
+                CallGraph graph(1);
 
-                for (const CallStack& callStack : callStacks)
+                // child lookup is needed only while building, key is (parent node, symbol & line)
+                QHash<QPair<uint32_t, uint64_t>, uint32_t> childs;
+
+                for (int sample = 0; sample < callStacks.count(); sample++)
                 {
-                    CallGraphSymbol* node = &root;
+                    const ThreadCallStack& callStack = callStacks[sample];
+                    uint32_t node = 0;
 
                     uint32_t parentLine = 0;
 
                     for (int k = callStack.count() - 1; k >= 0; k--)
                     {
                         const CallStackEntry& entry = callStack[k];
-                        const SymbolPtr& symbol = entry.symbol;
 
-                        QPair<SymbolPtr, quint32> key = qMakePair(symbol, parentLine);
+                        QPair<uint32_t, uint64_t> key = qMakePair(node, (uint64_t(entry.symbol) << 32) | parentLine);
 
-                        CallGraphSymbols::iterator it = node->childs.find(key);
-                        if (it == node->childs.end())
+                        auto it = childs.constFind(key);
+                        if (it == childs.constEnd())
                         {
-                            it = node->childs.insert(key, CallGraphSymbol());
+                            CallGraphNode child;
+                            child.symbol = entry.symbol;
+                            child.line = parentLine;
+                            child.next = graph[node].child;
+
+                            uint32_t index = graph.count();
+                            graph[node].child = index;
+                            graph.append(child);
+
+                            it = childs.insert(key, index);
                         }
 
-                        node = &it.value();
-                        node->total += 1;
+                        node = it.value();
+                        graph[node].total += weights[sample];
 
                         parentLine = entry.line;
                     }
 
-                    node->self += 1;
+                    graph[node].self += weights[sample];
                 }
 
-                if (!root.childs.isEmpty())
+                if (graph.count() > 1)
                 {
-                    callGraphThreads.append(CallGraphThread(threadName, root));
+                    graph.squeeze();
+                    callGraphThreads.append(CallGraphThread(threadName, graph));
                 }
             }
 
             // calculate file samples
             {
-                for (const CallStack& callStack : callStacks)
+                for (int sample = 0; sample < callStacks.count(); sample++)
                 {
+                    const ThreadCallStack& callStack = callStacks[sample];
                     for (const CallStackEntry& entry : callStack)
                     {
-                        const SymbolPtr& symbol = entry.symbol;
-                        if (!symbol->file.isEmpty())
+                        const QString& file = symbolTable.getFile(entry.symbol);
+                        if (!file.isEmpty())
                         {
-                            FileSamples& samples = fileProfile[symbol->file];
+                            FileSamples& samples = fileProfile[file];
                             if (entry.line != 0)
                             {
-                                samples.perLine[entry.line] += 1;
+                                samples.perLine[entry.line] += weights[sample];
                             }
-                            samples.perAddress[entry.offset] += 1;
+                            samples.perAddress[entry.offset] += weights[sample];
                         }
                     }
 
@@ -236,29 +296,33 @@ uint32_t CreateProfile(uint32_t pointerSize, bool withEmptyFiles, const QByteArr
                     for (int k = callStack.count() - 1; k >= 0; k--)
                     {
                         const CallStackEntry& entry = callStack[k];
-                        const SymbolPtr& symbol = entry.symbol;
 
                         if (!parentFname.isEmpty() && parentLine != 0)
                         {
-                            fileProfile[parentFname].lineToSymbol[parentLine] = symbol;
+                            fileProfile[parentFname].lineToSymbol[parentLine] = entry.symbol;
                         }
 
                         parentLine = entry.line;
-                        parentFname = symbol->file;
+                        parentFname = symbolTable.getFile(entry.symbol);
                     }
                 }
             }
+        }
 
-            // symbol definition lines
-            for (const SymbolPtr& symbol : symbols)
+        // symbol definition lines
+        if (threadCount != 0)
+        {
+            for (int id = 1; id < symbolTable.count(); id++)
             {
-                if (symbol)
-                {
-                    fileProfile[symbol->file].defLineToSymbol[symbol->line] = symbol;
-                }
+                const Symbol& symbol = symbolTable[id];
+                fileProfile[symbolTable.getString(symbol.file)].defLineToSymbol[symbol.line] = id;
             }
         }
     }
 
+    if (hiddenCount != nullptr)
+    {
+        *hiddenCount = hidden;
+    }
     return sampleCount;
 }
@@ -1,18 +1,77 @@
 #pragma once
 
+enum
+{
+    SYMBOL_UNRESOLVED = 1 << 0,
+    SYMBOL_INLINE = 1 << 1,
+    SYMBOL_PENDING = 1 << 2, // sampled before symbols of its module were loaded
+};
+
+// symbols are referenced by dense ids (0 is no symbol), strings are ids into owning SymbolTable
 struct Symbol
 {
-    QString name;
-    QString file;
-    uint64_t address;
+    uint64_t address; // in first load of module, offsets in samples are relative to it
     uint32_t size;
+    uint32_t name;
+    uint32_t file;
+    uint32_t module;
     uint32_t line;
     uint32_t lineLast;
+    uint32_t flags;
+};
+
+class SymbolTable
+{
+public:
+    SymbolTable();
+
+    uint32_t addString(const QString& string);
+    const QString& getString(uint32_t id) const;
+    int stringCount() const;
+
+    uint32_t addSymbol(const Symbol& symbol);
+    int count() const;
+
+    Symbol& operator [] (uint32_t id);
+    const Symbol& operator [] (uint32_t id) const;
+
+    const QString& getName(uint32_t id) const;
+    const QString& getFile(uint32_t id) const;
+    const QString& getModule(uint32_t id) const;
+
+    // names are stored mangled, demangled only when displayed or searched
+    const QString& getDisplayName(uint32_t id) const;
+
+private:
+    QVector<QString> mStrings;
+    QHash<QString, uint32_t> mStringIds;
+    QVector<Symbol> mSymbols;
+
+    // indexed by string id of name
+    mutable QHash<uint32_t, QString> mDisplayNames;
+};
+
+typedef QSharedPointer<SymbolTable> SymbolTablePtr;
+
+/*****/
 
-    QString module;
+// frames of each sample go from leaf to root, samples are terminated by entry with symbol 0
+// offset of terminating entry is count of identical samples minus one, for imported stacks with counts
+struct CallStackEntry
+{
+    uint32_t symbol = 0;
+    uint32_t line = 0;
+    uint32_t offset = 0; // from symbol address
 };
 
-typedef QSharedPointer<Symbol> SymbolPtr;
+// number of samples that call stack terminated by entry stands for
+inline uint32_t SampleWeight(const CallStackEntry& end)
+{
+    return end.offset + 1;
+}
+
+typedef QVector<CallStackEntry> ThreadCallStack;
+typedef QVector<ThreadCallStack> CallStack;
 
 /*****/
 
@@ -22,32 +81,35 @@ struct FlatSymbol
     uint32_t total = 0;
 };
 
-typedef QHash<SymbolPtr, FlatSymbol> FlatSymbols;
+// indexed by symbol id
+typedef QVector<FlatSymbol> FlatSymbols;
 typedef QPair<QString, FlatSymbols> FlatThread;
 typedef QVector<FlatThread> FlatThreads;
 
 /*****/
 
-struct CallGraphSymbol;
-typedef QHash<QPair<SymbolPtr, uint32_t>, CallGraphSymbol> CallGraphSymbols;
-
-struct CallGraphSymbol
+// whole tree is stored in one array, node 0 is root, childs are linked list through next
+struct CallGraphNode
 {
+    uint32_t symbol = 0;
+    uint32_t line = 0;
     uint32_t self = 0;
     uint32_t total = 0;
-    CallGraphSymbols childs;
+    uint32_t child = 0;
+    uint32_t next = 0;
 };
 
-typedef QPair<QString, CallGraphSymbol> CallGraphThread;
+typedef QVector<CallGraphNode> CallGraph;
+typedef QPair<QString, CallGraph> CallGraphThread;
 typedef QVector<CallGraphThread> CallGraphThreads;
 
 /*****/
 
-typedef QMap<uint32_t, SymbolPtr> DefinitionLineToSymbol;
+typedef QMap<uint32_t, uint32_t> DefinitionLineToSymbol;
 struct FileSamples
 {
     DefinitionLineToSymbol defLineToSymbol;
-    QHash<uint32_t, SymbolPtr> lineToSymbol;
+    QHash<uint32_t, uint32_t> lineToSymbol;
     QHash<uint32_t, uint32_t> perLine;
     QMap<uint32_t, uint32_t> perAddress;
 };
@@ -56,7 +118,37 @@ typedef QHash<QString, FileSamples> FileProfile;
 
 /*****/
 
-uint32_t CreateProfile(uint32_t pointerSize, bool needDllExports, const QByteArray& data,
+struct SampleStats
+{
+    uint32_t lost = 0;       // samples without call stack
+    uint32_t unresolved = 0; // samples with leaf frame without symbol
+    uint32_t hidden = 0;     // samples without any frame in file with source, left out unless all symbols are shown
+};
+
+// threads are stored in order they were created
+QString GetThreadName(uint32_t index);
+
+struct ProfileData;
+
+uint32_t CreateProfile(const ProfileData& profile, bool withEmptyFiles,
+    SymbolTable& symbolTable,
+    FlatThreads& flatThreads,
+    CallGraphThreads& callGraphThreads,
+    FileProfile& fileProfile,
+    SampleStats& stats);
+
+// calculates everything that is shown from call stacks of all threads, returns sample count
+uint32_t AggregateProfile(const SymbolTable& symbolTable, const CallStack& threadCallStacks, bool withEmptyFiles,
     FlatThreads& flatThreads,
     CallGraphThreads& callGraphThreads,
-    FileProfile& fileProfile);
+    FileProfile& fileProfile,
+    uint32_t* hiddenCount = nullptr);
+
+// result of AggregateProfile, as it is stored in .profiler file
+struct ProfileAggregates
+{
+    uint32_t sampleCount = 0;
+    FlatThreads flatThreads;
+    CallGraphThreads callGraphThreads;
+    FileProfile fileProfile;
+};
@@ -169,6 +169,35 @@ QString GetSettingsFile()
     return QDir(qApp->applicationDirPath()).filePath("config.ini");
 }
 
+QString GetSymbolCacheFolder()
+{
+    return QDir(qApp->applicationDirPath()).filePath("symbols/cache");
+}
+
+QString GetSymbolDownloadFolder()
+{
+    return QDir(qApp->applicationDirPath()).filePath("symbols");
+}
+
+QString GetSymbolStore()
+{
+    QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+    return settings.value("Preferences/SymbolStore", "https://msdl.microsoft.com/download/symbols").toString();
+}
+
+QString GetJitMapFolder()
+{
+    QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+    QString folder = settings.value("Preferences/JitMapFolder").toString();
+    return folder.isEmpty() ? QDir::tempPath() : folder;
+}
+
+double GetVariationThreshold()
+{
+    QSettings settings(GetSettingsFile(), QSettings::IniFormat);
+    return settings.value("Preferences/VariationThreshold", 10.0).toDouble();
+}
+
 void DetectVSLocations(QSettings& settings)
 {
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
@@ -26,4 +26,9 @@ void OpenInExplorer(const QString& file);
 void OpenInEditor(const QString& file);
 
 QString GetSettingsFile();
+QString GetSymbolCacheFolder();
+QString GetSymbolDownloadFolder();
+QString GetSymbolStore();
+QString GetJitMapFolder(); // where JIT runtimes write perf-PID.map & jit-PID.dump files
+double GetVariationThreshold(); // in percent of mean share
 void DetectVSLocations(QSettings& settings);
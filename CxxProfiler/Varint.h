@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Precompiled.h"
+
+// Variable length integers (LEB128), 7 bits per byte with high bit set on all
+// bytes except last. Signed values are zigzag encoded first, so small negative
+// deltas stay small too.
+
+inline void AppendVarint(QByteArray& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+inline uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void AppendVarintString(QByteArray& out, const QString& string)
+{
+    QByteArray utf8 = string.toUtf8();
+    AppendVarint(out, utf8.size());
+    out.append(utf8);
+}
+
+// Reads values from memory, after any out of bounds or malformed value reader
+// becomes invalid and returns only zeros.
+class VarintReader
+{
+public:
+    VarintReader(const uchar* data, size_t size)
+        : mData(data)
+        , mEnd(data + size)
+        , mValid(true)
+    {
+    }
+
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    bool atEnd() const
+    {
+        return mData == mEnd;
+    }
+
+    uint64_t read()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64 && mData != mEnd; shift += 7)
+        {
+            uchar byte = *mData++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        return invalid();
+    }
+
+    uint32_t read32()
+    {
+        uint64_t value = read();
+        if (value > 0xffffffff)
+        {
+            return invalid();
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    int64_t readSigned()
+    {
+        return UnZigZag(read());
+    }
+
+    QString readString()
+    {
+        uint64_t size = read();
+        if (size > static_cast<uint64_t>(mEnd - mData))
+        {
+            invalid();
+            return QString();
+        }
+
+        QString string = QString::fromUtf8(reinterpret_cast<const char*>(mData), static_cast<int>(size));
+        mData += size;
+        return string;
+    }
+
+private:
+    const uchar* mData;
+    const uchar* mEnd;
+    bool mValid;
+
+    uint32_t invalid()
+    {
+        mValid = false;
+        mData = mEnd;
+        return 0;
+    }
+};
@@ -3,5 +3,5 @@
 namespace
 {
     const char CXX_PROFILER_FILE_ID[4] = { 'C', 'X', 'X', 'P' };
-    const uint32_t CXX_PROFILER_FILE_VERSION = 1;
+    const uint32_t CXX_PROFILER_FILE_VERSION = 2; // version 1 files are still readable
 }